@@ -0,0 +1,276 @@
+#include <cmath>
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QHash>
+
+#include "evalcache.h"
+#include "analysisjob.h"
+
+analysis_job::analysis_job (go_game_ptr gr, int n_seconds, int n_visits, int n_lines,
+			    engine_komi k, bool comments, bool early_stop)
+	: m_game (gr), m_n_seconds (n_seconds), m_n_visits (n_visits), m_n_lines (n_lines),
+	  m_komi_type (k), m_comments (comments), m_early_stop (early_stop)
+{
+	std::vector<game_state *> *q = &m_queue;
+	std::function<bool (game_state *)> f = [this, &q] (game_state *st) -> bool
+		{
+			eval ev = st->best_eval ();
+			if (st->has_figure () && ev.visits > 0)
+				return false;
+			/* Ignore score and pass nodes on the grounds that they should be identical to the
+			   preceding one.  */
+			if (st->was_score_p () || st->was_pass_p ())
+				return true;
+			q->push_back (st);
+			return true;
+		};
+	/* This produces the nodes in the reverse order of the game.  We rely on this
+	   when calculating win rate changes.  */
+	m_game->get_root ()->walk_tree (f);
+	find_duplicates ();
+	if (k == engine_komi::both)
+		m_queue_flipped = m_queue;
+	m_initial_size = m_queue.size () + m_queue_flipped.size ();
+}
+
+/* Remove positions from the queue that are identical, up to rotation and reflection,
+   to one that is analyzed earlier, and remember them so that the result can be
+   copied.  Joseki files in particular contain many such transpositions.  */
+void analysis_job::find_duplicates ()
+{
+	QHash<QString, game_state *> seen;
+	std::vector<game_state *> unique;
+	/* The queue is processed from the back.  */
+	for (auto it = m_queue.rbegin (); it != m_queue.rend (); ++it) {
+		game_state *st = *it;
+		eval_cache::key k = eval_cache::make_key (st, 0, "", "");
+		auto found = seen.constFind (k.hash);
+		if (found == seen.constEnd ()) {
+			seen.insert (k.hash, st);
+			m_duplicates[st].sym = k.sym;
+			unique.push_back (st);
+		} else
+			m_duplicates[*found].members.push_back ({ st, k.sym });
+	}
+	std::reverse (unique.begin (), unique.end ());
+	m_queue = std::move (unique);
+}
+
+/* Return the next position to be analyzed, and remove it from the queue if POP.
+   ENGINE_KOMI_FIXED says whether the engine has a fixed komi; if not, there is no
+   point in analyzing flipped positions.  */
+game_state *analysis_job::select_request (bool pop, bool engine_komi_fixed)
+{
+	if (m_queue_flipped.size () > 0 && !engine_komi_fixed) {
+		m_initial_size -= m_queue_flipped.size ();
+		m_queue_flipped.clear ();
+	}
+	if (m_queue.size () == 0) {
+		m_komi_type = engine_komi::do_swap;
+		if (m_queue_flipped.size () == 0)
+			return nullptr;
+		game_state *st = m_queue_flipped.back ();
+		if (pop)
+			m_queue_flipped.pop_back ();
+		return st;
+	}
+
+	game_state *st = m_queue.back ();
+	if (pop)
+		m_queue.pop_back ();
+	return st;
+}
+
+/* Decide whether the next request should be made with colors swapped, given the
+   fixed komi of the engine (or an empty string if it has none).  */
+bool analysis_job::flip_request (const QString &engine_komi)
+{
+	bool flip = m_komi_type == engine_komi::do_swap;
+	if (m_komi_type == engine_komi::maybe_swap && !engine_komi.isEmpty ()) {
+		bool ok;
+		double k = engine_komi.toFloat (&ok);
+		double gm_k = QString::fromStdString(m_game->komi ()).toDouble();
+		if (ok && std::abs (k - gm_k) > std::abs (k + gm_k))
+			flip = true;
+	}
+	return flip;
+}
+
+void analysis_job::start_position ()
+{
+	m_pos_timer.start ();
+	m_last_wr = -1;
+	m_stable_count = 0;
+}
+
+/* Parameters for early stopping.  We move on once the top choice has this share of
+   all visits, or once the winrate has changed by less than the given amount over a
+   number of consecutive updates.  In either case, we require a minimum number of
+   visits first.  */
+static const double early_stop_share = 0.85;
+static const double early_stop_wr_delta = 0.005;
+static const int early_stop_n_stable = 4;
+static const int early_stop_min_visits = 100;
+
+/* Decide whether we have searched the current position for long enough.  The time
+   limit always applies, the visit target and convergence tests only if they were
+   requested for the job.  */
+bool analysis_job::position_done (int total_visits, int top_visits, double wr)
+{
+	if (m_pos_timer.elapsed () >= m_n_seconds * 1000)
+		return true;
+	if (m_n_visits > 0 && total_visits >= m_n_visits)
+		return true;
+	if (!m_early_stop)
+		return false;
+
+	if (m_last_wr >= 0 && std::abs (wr - m_last_wr) < early_stop_wr_delta)
+		m_stable_count++;
+	else
+		m_stable_count = 0;
+	m_last_wr = wr;
+
+	int min_visits = m_n_visits > 0 ? m_n_visits / 4 : early_stop_min_visits;
+	if (total_visits < min_visits)
+		return false;
+	if (top_visits >= total_visits * early_stop_share)
+		return true;
+	return m_stable_count >= early_stop_n_stable;
+}
+
+inline std::string s_tr (const char *s)
+{
+	return QObject::tr (s).toStdString ();
+}
+
+static QString tr (const char *s)
+{
+	return QCoreApplication::translate ("AnalyzeDialog", s);
+}
+
+/* Take the results of the analysis from EVAL_STATE and add them to the position
+   that was analyzed, which is removed from the queue and returned.  The variations
+   are moved out of EVAL_STATE.  */
+game_state *analysis_job::add_result (game_state *eval_state, int total_visits, bool have_score, bool engine_komi_fixed)
+{
+	qint64 msecs = m_pos_timer.elapsed ();
+	m_done++;
+	m_total_visits += total_visits;
+	m_total_msecs += msecs;
+
+	game_state *st = select_request (true, engine_komi_fixed);
+	auto variations = eval_state->take_children ();
+
+	auto dups = m_duplicates.find (st);
+	if (dups != m_duplicates.end ()) {
+		int size = st->get_board ().size_x ();
+		for (auto &d: dups->second.members) {
+			/* Build the variations on a detached copy of the position, so that they
+			   can be added in the same way as the original ones.  */
+			game_state tmp (d.st->get_board (), d.st->to_move ());
+			for (auto v: variations) {
+				game_state *cur = &tmp;
+				for (game_state *m = v; m != nullptr && m->was_move_p (); m = m->next_primary_move ()) {
+					int x = m->get_move_x ();
+					int y = m->get_move_y ();
+					transform_coords (dups->second.sym, size, x, y);
+					inverse_transform_coords (d.sym, size, x, y);
+					game_state *next = cur->add_child_move (x, y);
+					if (next == nullptr)
+						break;
+					next->update_eval (*m);
+					cur = next;
+				}
+			}
+			add_variations (d.st, *eval_state, tmp.take_children (), total_visits, msecs, have_score);
+		}
+	}
+	add_variations (st, *eval_state, std::move (variations), total_visits, msecs, have_score);
+	return st;
+}
+
+/* Add the evaluation found in EVAL_STATE, and the VARIATIONS produced for it, to ST.
+   This takes ownership of the variations.  */
+void analysis_job::add_variations (game_state *st, const game_state &eval_state, std::vector<game_state *> variations,
+				   int total_visits, qint64 msecs, bool have_score)
+{
+	st->update_eval (eval_state);
+	if (m_comments && variations.size () > 0) {
+		game_state *best = variations[0];
+		eval e = best->best_eval ();
+		if (e.visits > 0) {
+			std::string comm = st->comment ();
+			if (comm.length () > 0) {
+				if (comm.back () != '\n')
+					comm.push_back ('\n');
+				comm += "----------------\n";
+			}
+			auto cname = st->get_board ().coords_name (best->get_move_x (), best->get_move_y (), false);
+			comm += s_tr ("Engine top choice: ") + cname.first + cname.second;
+			comm += s_tr (", ") + std::to_string (e.visits) + s_tr (" visits") + s_tr (", winrate B: ") + komi_str (e.wr_black * 100) + "%";
+			if (have_score) {
+				double sval = e.score_mean;
+				if (sval < 0)
+					sval = -sval, comm += s_tr ("\nScore: W+");
+				else
+					comm += s_tr ("\nScore: B+");
+				comm += komi_str ((long)(sval * 100) / 100.);
+				comm += s_tr (" (stddev ") + komi_str ((long)(e.score_stddev * 100) / 100.) + s_tr (")");
+			}
+			comm += "\n";
+			game_state *next = st->next_primary_move ();
+			if (next && next->was_move_p ()) {
+				auto nextcname = st->get_board ().coords_name (next->get_move_x (), next->get_move_y (), false);
+				comm += s_tr ("Game move: ") + nextcname.first + nextcname.second;
+				if (cname != nextcname) {
+					comm += s_tr (", ");
+					for (size_t cnt = 1; cnt < variations.size (); cnt++) {
+						if (variations[cnt]->get_move_x () == next->get_move_x ()
+						    && variations[cnt]->get_move_y () == next->get_move_y ()) {
+							comm += s_tr ("choice #") + std::to_string (cnt + 1);
+							goto found;
+						}
+					}
+					comm += "not considered";
+					found:
+
+					eval e2 = next->eval_from (e.id, true);
+					if (e2.visits > 0) {
+						double diff = e2.wr_black - e.wr_black;
+						std::string diffstr = komi_str (diff * 100);
+						if (diff > 0)
+							diffstr = "+" + diffstr;
+						comm += s_tr (", winrate B: ") + komi_str (e2.wr_black * 100) + "% (" + diffstr + ")";
+					}
+				}
+				comm += "\n";
+			}
+			comm += s_tr ("Analysis: ") + e.id.engine;
+			if (e.id.komi_set)
+				comm += s_tr (" @") + komi_str (e.id.komi) + s_tr (" komi");
+			comm += s_tr (", ") + std::to_string (total_visits) + s_tr (" visits in ");
+			comm += QString::number (msecs / 1000., 'f', 1).toStdString () + s_tr (" seconds");
+			comm += "\n";
+			st->set_comment (comm);
+		}
+	}
+	int count = 0;
+	for (auto it: variations) {
+		if (count >= m_n_lines) {
+			delete it;
+			continue;
+		}
+		eval ev = it->best_eval ();
+		double wr = ev.wr_black;
+		QString cnt = QString::number (count + 1);
+		QString wrb = QString::number (wr * 100);
+		QString wrw = QString::number ((1 - wr) * 100);
+		QString vis = QString::number (ev.visits);
+		QString title = tr ("PV ") + cnt + ": " + tr ("W Win ") + wrw + "%, " + tr ("B Win ") + wrb + "% " + tr ("at ") + vis + tr (" visits.");
+		it->set_figure (257, title.toStdString ());
+		st->add_child_tree (it);
+		m_game->set_modified ();
+		count++;
+	}
+}
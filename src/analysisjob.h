@@ -0,0 +1,79 @@
+/*
+ * analysisjob.h
+ */
+
+#ifndef ANALYSISJOB_H
+#define ANALYSISJOB_H
+
+#include <vector>
+#include <unordered_map>
+
+#include <QString>
+#include <QElapsedTimer>
+
+#include "goboard.h"
+#include "gogame.h"
+
+enum class engine_komi { dflt, maybe_swap, do_swap, both };
+
+/* The parts of a batch analysis job that do not depend on a user interface: the queue
+   of positions to analyze, the decision when to move on to the next one, and adding
+   the engine's results to the game record.  Shared between the batch analysis dialog
+   and the command line batch mode.  */
+struct analysis_job
+{
+	go_game_ptr m_game;
+	int m_n_seconds;
+	/* Visit target per position, or 0 to rely only on the time limit.  */
+	int m_n_visits;
+	int m_n_lines;
+	engine_komi m_komi_type;
+	bool m_comments;
+	bool m_early_stop;
+
+	std::vector<game_state *> m_queue;
+	std::vector<game_state *> m_queue_flipped;
+	size_t m_initial_size;
+
+	/* Positions which were removed from the queue because they are a rotation or
+	   reflection of a queued one, keyed by the position that is analyzed in their
+	   place.  SYM is the symmetry that maps each to canonical orientation.  */
+	struct duplicate
+	{
+		game_state *st;
+		int sym;
+	};
+	struct dup_group
+	{
+		int sym;
+		std::vector<duplicate> members;
+	};
+	std::unordered_map<game_state *, dup_group> m_duplicates;
+	size_t m_done = 0;
+
+	/* Statistics about the work actually done, summed over all analyzed positions.  */
+	long m_total_visits = 0;
+	qint64 m_total_msecs = 0;
+
+	/* Measures the time spent on the current position.  */
+	QElapsedTimer m_pos_timer;
+	/* Used to detect convergence of the winrate for early stopping.  */
+	double m_last_wr;
+	int m_stable_count;
+
+	analysis_job (go_game_ptr gr, int n_seconds, int n_visits, int n_lines,
+		      engine_komi, bool comments, bool early_stop);
+
+	game_state *select_request (bool pop, bool engine_komi_fixed);
+	bool flip_request (const QString &engine_komi);
+	void start_position ();
+	bool position_done (int total_visits, int top_visits, double wr);
+	game_state *add_result (game_state *eval_state, int total_visits, bool have_score, bool engine_komi_fixed);
+
+private:
+	void find_duplicates ();
+	void add_variations (game_state *, const game_state &eval_state, std::vector<game_state *> variations,
+			     int total_visits, qint64 msecs, bool have_score);
+};
+
+#endif
@@ -18,8 +18,13 @@ AnalyzeDialog::AnalyzeDialog (QWidget *parent, const QString &filename)
 	} else
 		m_last_dir = setting->readEntry ("LAST_DIR");
 	secondsEdit->setValidator (&m_seconds_vald);
+	visitsEdit->setValidator (&m_visits_vald);
 	maxlinesEdit->setValidator (&m_lines_vald);
 
+	/* We decide when to move on by looking at visit counts and elapsed time,
+	   so ask for updates more often than once per second.  */
+	m_analysis_interval = 25;
+
 	const QStyle *style = qgo_app->style ();
 	int iconsz = style->pixelMetric (QStyle::PixelMetric::PM_ToolBarIconSize);
 
@@ -127,32 +132,10 @@ void AnalyzeDialog::analyzer_state_changed ()
 	boardsizeSpinBox->setEnabled (!any_jobs && s == analyzer::disconnected);
 }
 
-AnalyzeDialog::job::job (AnalyzeDialog *dlg, QString &title, go_game_ptr gr, int n_seconds, int n_lines,
-			 engine_komi k, bool comments)
-	: m_dlg (dlg), m_title (title), m_game (gr), m_n_seconds (n_seconds), m_n_lines (n_lines), m_komi_type (k),
-	  m_comments (comments)
+AnalyzeDialog::job::job (AnalyzeDialog *dlg, QString &title, go_game_ptr gr, int n_seconds, int n_visits, int n_lines,
+			 engine_komi k, bool comments, bool early_stop)
+	: analysis_job (gr, n_seconds, n_visits, n_lines, k, comments, early_stop), m_dlg (dlg), m_title (title)
 {
-	std::vector<game_state *> *q = &m_queue;
-	std::function<bool (game_state *)> f = [this, &q] (game_state *st) -> bool
-		{
-			eval ev = st->best_eval ();
-			if (st->has_figure () && ev.visits > 0)
-				return false;
-			/* Ignore score and pass nodes on the grounds that they should be identical to the
-			   preceding one.  */
-			if (st->was_score_p () || st->was_pass_p ())
-				return true;
-			q->push_back (st);
-			return true;
-		};
-	/* This produces the nodes in the reverse order of the game.  We rely on this
-	   when calculating win rate changes.  */
-	m_game->get_root ()->walk_tree (f);
-	if (k == engine_komi::both) {
-		q = &m_queue_flipped;
-		m_game->get_root ()->walk_tree (f);
-	}
-	m_initial_size = m_queue.size () + m_queue_flipped.size ();
 }
 
 AnalyzeDialog::job::~job ()
@@ -163,24 +146,7 @@ AnalyzeDialog::job::~job ()
 
 game_state *AnalyzeDialog::job::select_request (bool pop)
 {
-	if (m_queue_flipped.size () > 0 && m_dlg->m_current_komi.isEmpty ()) {
-		m_initial_size -= m_queue_flipped.size ();
-		m_queue_flipped.clear ();
-	}
-	if (m_queue.size () == 0) {
-		m_komi_type = engine_komi::do_swap;
-		if (m_queue_flipped.size () == 0)
-			return nullptr;
-		game_state *st = m_queue_flipped.back ();
-		if (pop)
-			m_queue_flipped.pop_back ();
-		return st;
-	}
-
-	game_state *st = m_queue.back ();
-	if (pop)
-		m_queue.pop_back ();
-	return st;
+	return analysis_job::select_request (pop, !m_dlg->m_current_komi.isEmpty ());
 }
 
 void AnalyzeDialog::job::show_window (bool done)
@@ -210,6 +176,12 @@ void AnalyzeDialog::insert_job (display &q, QListView *view, job *j)
 	item->setDropEnabled (false);
 	item->setEditable (false);
 	item->setData (idx, Qt::UserRole + 1);
+	if (j->m_done > 0) {
+		double secs = j->m_total_msecs / 1000.;
+		item->setToolTip (tr ("%1 positions, %2 visits in %3 seconds (%4 visits per position)")
+				  .arg (j->m_done).arg (j->m_total_visits).arg (secs, 0, 'f', 1)
+				  .arg (j->m_total_visits / (long)j->m_done));
+	}
 
 	j->m_display = &q;
 	q.jobs.push_back (j);
@@ -297,21 +269,12 @@ void AnalyzeDialog::queue_next ()
 		job *j = m_jobs.map[jidx];
 		game_state *st = j->select_request (false);
 		if (st != nullptr && st->get_board ().size_x () == boardsizeSpinBox->value ()) {
-			m_seconds_count = 0;
+			j->start_position ();
 			m_requester = j;
 			if (analyzer_state () == analyzer::paused)
 				pause_analyzer (false, j->m_game, st);
-			else {
-				bool flip = j->m_komi_type == engine_komi::do_swap;
-				if (j->m_komi_type == engine_komi::maybe_swap && !m_current_komi.isEmpty ()) {
-					bool ok;
-					double k = m_current_komi.toFloat (&ok);
-					double gm_k = QString::fromStdString(j->m_game->komi ()).toDouble();
-					if (ok && std::abs (k - gm_k) > std::abs (k + gm_k))
-						flip = true;
-				}
-				request_analysis (j->m_game, st, flip);
-			}
+			else
+				request_analysis (j->m_game, st, j->flip_request (m_current_komi), j->m_n_visits);
 			return;
 		}
 	}
@@ -327,12 +290,7 @@ void AnalyzeDialog::notice_analyzer_id (const analyzer_id &id, bool have_score)
 		j->m_win->update_analyzer_ids (id, have_score);
 }
 
-inline std::string s_tr (const char *s)
-{
-	return QObject::tr (s).toStdString ();
-}
-
-void AnalyzeDialog::eval_received (const QString &, int, bool have_score)
+void AnalyzeDialog::eval_received (const QString &, int top_visits, bool have_score)
 {
 	job *j = m_requester;
 	if (j == nullptr) {
@@ -340,91 +298,20 @@ void AnalyzeDialog::eval_received (const QString &, int, bool have_score)
 		queue_next ();
 		return;
 	}
-	if (++m_seconds_count < j->m_n_seconds)
+	int total_visits = 0;
+	for (auto it: m_eval_state->children ())
+		total_visits += it->best_eval ().visits;
+	if (!m_cached_result && !j->position_done (total_visits, top_visits, m_primary_eval))
 		return;
-	j->m_done++;
-	update_progress ();
 
-	game_state *st = j->select_request (true);
-	st->update_eval (*m_eval_state);
-	auto variations = m_eval_state->take_children ();
-	if (j->m_comments && variations.size () > 0) {
-		game_state *best = variations[0];
-		eval e = best->best_eval ();
-		if (e.visits > 0) {
-			std::string comm = st->comment ();
-			if (comm.length () > 0) {
-				if (comm.back () != '\n')
-					comm.push_back ('\n');
-				comm += "----------------\n";
-			}
-			auto cname = st->get_board ().coords_name (best->get_move_x (), best->get_move_y (), false);
-			comm += s_tr ("Engine top choice: ") + cname.first + cname.second;
-			comm += s_tr (", ") + std::to_string (e.visits) + s_tr (" visits") + s_tr (", winrate B: ") + komi_str (e.wr_black * 100) + "%";
-			if (have_score) {
-				double sval = e.score_mean;
-				if (sval < 0)
-					sval = -sval, comm += s_tr ("\nScore: W+");
-				else
-					comm += s_tr ("\nScore: B+");
-				comm += komi_str ((long)(sval * 100) / 100.);
-				comm += s_tr (" (stddev ") + komi_str ((long)(e.score_stddev * 100) / 100.) + s_tr (")");
-			}
-			comm += "\n";
-			game_state *next = st->next_primary_move ();
-			if (next && next->was_move_p ()) {
-				auto nextcname = st->get_board ().coords_name (next->get_move_x (), next->get_move_y (), false);
-				comm += s_tr ("Game move: ") + nextcname.first + nextcname.second;
-				if (cname != nextcname) {
-					comm += s_tr (", ");
-					for (size_t cnt = 1; cnt < variations.size (); cnt++) {
-						if (variations[cnt]->get_move_x () == next->get_move_x ()
-						    && variations[cnt]->get_move_y () == next->get_move_y ()) {
-							comm += s_tr ("choice #") + std::to_string (cnt + 1);
-							goto found;
-						}
-					}
-					comm += "not considered";
-					found:
-
-					eval e2 = next->eval_from (e.id, true);
-					if (e2.visits > 0) {
-						double diff = e2.wr_black - e.wr_black;
-						std::string diffstr = komi_str (diff * 100);
-						if (diff > 0)
-							diffstr = "+" + diffstr;
-						comm += s_tr (", winrate B: ") + komi_str (e2.wr_black * 100) + "% (" + diffstr + ")";
-					}
-				}
-				comm += "\n";
-			}
-			comm += s_tr ("Analysis: ") + e.id.engine;
-			if (e.id.komi_set)
-				comm += s_tr (" @") + komi_str (e.id.komi) + s_tr (" komi");
-			comm += "\n";
-			st->set_comment (comm);
-		}
-	}
-	int count = 0;
-	for (auto it: variations) {
-		eval ev = it->best_eval ();
-		double wr = ev.wr_black;
-		QString cnt = QString::number (count + 1);
-		QString wrb = QString::number (wr * 100);
-		QString wrw = QString::number ((1 - wr) * 100);
-		QString vis = QString::number (ev.visits);
-		QString title = tr ("PV ") + cnt + ": " + tr ("W Win ") + wrw + "%, " + tr ("B Win ") + wrb + "% " + tr ("at ") + vis + tr (" visits.");
-		it->set_figure (257, title.toStdString ());
-		st->add_child_tree (it);
-		j->m_game->set_modified ();
-		if (j->m_win) {
-			j->m_win->update_game_tree ();
-			j->m_win->update_figures ();
-			j->m_win->update_game_record ();
-		}
-		count++;
-		if (count >= j->m_n_lines)
-			break;
+	/* Must happen before the job takes the variations out of the evaluation state.  */
+	store_cached_eval ();
+	j->add_result (m_eval_state, total_visits, have_score, !m_current_komi.isEmpty ());
+	update_progress ();
+	if (j->m_win) {
+		j->m_win->update_game_tree ();
+		j->m_win->update_figures ();
+		j->m_win->update_game_record ();
 	}
 
 	if (j->select_request (false) == nullptr) {
@@ -567,8 +454,9 @@ void AnalyzeDialog::start_job ()
 	int komi_val = komiComboBox->currentIndex ();
 
 	engine_komi k = komi_val == 2 ? engine_komi::both : komi_val == 1 ? engine_komi::maybe_swap : engine_komi::dflt;
-	m_all_jobs.emplace_front (this, f, gr, secondsEdit->text ().toInt (), maxlinesEdit->text ().toInt (), k,
-				  commentsCheckBox->isChecked ());
+	m_all_jobs.emplace_front (this, f, gr, secondsEdit->text ().toInt (), visitsEdit->text ().toInt (),
+				  maxlinesEdit->text ().toInt (), k,
+				  commentsCheckBox->isChecked (), earlyStopCheckBox->isChecked ());
 	job *j = &m_all_jobs.front ();
 	insert_job (m_jobs, jobView, j);
 
@@ -14,6 +14,7 @@
 #include "goboard.h"
 #include "gogame.h"
 #include "qgtp.h"
+#include "analysisjob.h"
 
 #include "ui_analyze_gui.h"
 
@@ -40,40 +41,29 @@ class AnalyzeDialog : public QMainWindow, public Ui::AnalyzeDialog, public GTP_E
 	int m_job_count = 0;
 
 	QString m_current_komi;
-	enum class engine_komi { dflt, maybe_swap, do_swap, both };
 
-	struct job
+	struct job : public analysis_job
 	{
 		AnalyzeDialog *m_dlg;
 		QString m_title;
-		go_game_ptr m_game;
 		MainWindow *m_win {};
 		/* We connect to the window's close event, and keep this connection
 		   around so we can delete it on close.  */
 		QMetaObject::Connection m_connection;
-		int m_n_seconds;
-		int m_n_lines;
-		engine_komi m_komi_type;
-		bool m_comments;
-
-		std::vector<game_state *> m_queue;
-		std::vector<game_state *> m_queue_flipped;
-		size_t m_initial_size;
-		size_t m_done = 0;
 
 		display *m_display;
 		int m_idx;
 
-		job (AnalyzeDialog *dlg, QString &title, go_game_ptr gr, int n_seconds, int n_lines,
-		     engine_komi, bool comments);
+		job (AnalyzeDialog *dlg, QString &title, go_game_ptr gr, int n_seconds, int n_visits, int n_lines,
+		     engine_komi, bool comments, bool early_stop);
 		~job ();
 		game_state *select_request (bool pop);
 		void show_window (bool done);
 	};
 
 	job *m_requester;
-	int m_seconds_count;
 	QIntValidator m_seconds_vald { 1, 86400 };
+	QIntValidator m_visits_vald { 0, 10000000 };
 	QIntValidator m_lines_vald { 1, 100 };
 
 	QString m_last_dir;
@@ -0,0 +1,338 @@
+/*
+ * batchanalysis.cpp
+ */
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include "gogame.h"
+#include "ui_helpers.h"
+#include "batchanalysis.h"
+
+static const char output_suffix[] = ".analyzed.sgf";
+
+/* One engine process, working through files taken from the shared list of pending
+   files until there are none left.  */
+struct BatchAnalyzer::worker : public GTP_Eval_Controller
+{
+	BatchAnalyzer *m_batch;
+	batch_input m_file;
+	std::unique_ptr<analysis_job> m_job;
+	bool m_running = true;
+
+	worker (BatchAnalyzer *b) : GTP_Eval_Controller (nullptr), m_batch (b)
+	{
+		m_analysis_interval = 25;
+	}
+	~worker () { }
+
+	void start ()
+	{
+		start_analyzer (m_batch->m_engine, m_batch->m_boardsize, 7.5, false);
+	}
+	bool engine_komi_fixed () { return !m_batch->m_engine.komi.isEmpty (); }
+
+	bool next_file ();
+	void next_position ();
+	bool write_result ();
+	void stop ();
+
+	virtual void eval_received (const QString &, int, bool) override;
+	virtual void gtp_startup_success (GTP_Process *) override;
+	virtual void gtp_failure (GTP_Process *, const QString &) override;
+	virtual void gtp_exited (GTP_Process *) override;
+};
+
+/* Load the next file that is suitable for analysis.  Returns false if there are
+   no more files.  */
+bool BatchAnalyzer::worker::next_file ()
+{
+	m_job = nullptr;
+	while (m_batch->take_file (m_file)) {
+		go_game_ptr gr = record_from_file (m_file.path, nullptr);
+		if (gr == nullptr) {
+			QTextStream (stderr) << m_file.path << ": " << QObject::tr ("could not load SGF file") << "\n";
+			m_batch->file_done (this, false);
+			continue;
+		}
+		if (gr->get_root ()->get_board ().size_x () != m_batch->m_boardsize) {
+			QTextStream (stderr) << m_file.path << ": " << QObject::tr ("board size not supported by the engine, skipped") << "\n";
+			m_batch->m_files_skipped++;
+			continue;
+		}
+		const batch_options &o = m_batch->m_opts;
+		m_job.reset (new analysis_job (gr, o.n_seconds, o.n_visits, o.n_lines,
+					       o.komi_type, o.comments, o.early_stop));
+		return true;
+	}
+	return false;
+}
+
+/* Send the next position of the current job to the engine, moving on to the next
+   file whenever one is complete.  */
+void BatchAnalyzer::worker::next_position ()
+{
+	while (m_job != nullptr || next_file ()) {
+		game_state *st = m_job->select_request (false, engine_komi_fixed ());
+		if (st != nullptr) {
+			m_job->start_position ();
+			request_analysis (m_job->m_game, st, m_job->flip_request (m_batch->m_engine.komi), m_job->m_n_visits);
+			return;
+		}
+		m_batch->file_done (this, write_result ());
+		m_job = nullptr;
+	}
+	stop ();
+}
+
+/* Write the analyzed game.  QSaveFile ensures that an output file only exists once
+   it is complete, which is what makes it safe to resume an interrupted run.  */
+bool BatchAnalyzer::worker::write_result ()
+{
+	QString filename = m_batch->output_filename (m_file);
+	QDir ().mkpath (QFileInfo (filename).absolutePath ());
+	QSaveFile of (filename);
+	if (!of.open (QIODevice::WriteOnly)) {
+		QTextStream (stderr) << filename << ": " << QObject::tr ("cannot open file for writing") << "\n";
+		return false;
+	}
+	QByteArray bytes = QByteArray::fromStdString (m_job->m_game->to_sgf ());
+	if (of.write (bytes) != bytes.length () || !of.commit ()) {
+		QTextStream (stderr) << filename << ": " << QObject::tr ("failed to write file") << "\n";
+		return false;
+	}
+	return true;
+}
+
+void BatchAnalyzer::worker::stop ()
+{
+	if (!m_running)
+		return;
+	m_running = false;
+	stop_analyzer ();
+	m_batch->worker_stopped ();
+}
+
+void BatchAnalyzer::worker::eval_received (const QString &, int top_visits, bool have_score)
+{
+	if (m_job == nullptr)
+		return;
+
+	int total_visits = 0;
+	for (auto it: m_eval_state->children ())
+		total_visits += it->best_eval ().visits;
+	if (!m_cached_result && !m_job->position_done (total_visits, top_visits, m_primary_eval))
+		return;
+
+	/* Must happen before the job takes the variations out of the evaluation state.  */
+	store_cached_eval ();
+	m_job->add_result (m_eval_state, total_visits, have_score, engine_komi_fixed ());
+	m_batch->m_positions++;
+	m_batch->m_visits += total_visits;
+
+	next_position ();
+}
+
+void BatchAnalyzer::worker::gtp_startup_success (GTP_Process *)
+{
+	next_position ();
+}
+
+void BatchAnalyzer::worker::gtp_failure (GTP_Process *, const QString &err)
+{
+	QTextStream (stderr) << m_batch->m_engine.title << ": " << err << "\n";
+	if (!m_running)
+		return;
+	/* Nothing more will be asked of the engine, so give up on it rather than wait
+	   forever; as in gtp_exited, the file in progress is left for a resumed run.  */
+	clear_eval_data ();
+	if (m_job != nullptr)
+		m_batch->file_done (this, false);
+	m_job = nullptr;
+	m_running = false;
+	stop_analyzer ();
+	m_batch->worker_stopped ();
+}
+
+void BatchAnalyzer::worker::gtp_exited (GTP_Process *)
+{
+	if (!m_running)
+		return;
+	clear_eval_data ();
+	QTextStream (stderr) << m_batch->m_engine.title << ": " << QObject::tr ("GTP process exited unexpectedly.") << "\n";
+	/* No output is written for the file in progress, so it will be picked up again
+	   when the run is resumed.  */
+	if (m_job != nullptr)
+		m_batch->file_done (this, false);
+	m_job = nullptr;
+	m_running = false;
+	m_batch->worker_stopped ();
+}
+
+BatchAnalyzer::BatchAnalyzer (const Engine &e, const QList<batch_input> &files, const batch_options &opts)
+	: m_engine (e), m_boardsize (e.boardsize.toInt ()), m_opts (opts)
+{
+	for (auto &f: files) {
+		if (f.path.endsWith (output_suffix))
+			continue;
+		if (QFileInfo::exists (output_filename (f))) {
+			m_files_skipped++;
+			continue;
+		}
+		m_pending.append (f);
+	}
+	m_n_files = m_pending.size ();
+	connect (&m_stats_timer, &QTimer::timeout, [this] () { print_stats (false); });
+}
+
+BatchAnalyzer::~BatchAnalyzer ()
+{
+}
+
+QString BatchAnalyzer::output_filename (const batch_input &f)
+{
+	QFileInfo fi (f.path);
+	if (m_opts.output_dir.isEmpty ())
+		return fi.dir ().filePath (fi.completeBaseName () + output_suffix);
+	QFileInfo rel (f.relative);
+	QString dir = QDir (m_opts.output_dir).filePath (rel.path ());
+	return QDir (dir).filePath (rel.completeBaseName () + output_suffix);
+}
+
+bool BatchAnalyzer::take_file (batch_input &f)
+{
+	if (m_pending.isEmpty ())
+		return false;
+	f = m_pending.takeFirst ();
+	return true;
+}
+
+void BatchAnalyzer::file_done (worker *w, bool ok)
+{
+	QTextStream out (stdout);
+	if (ok) {
+		m_files_done++;
+		out << "[" << m_files_done + m_files_failed << "/" << m_n_files << "] "
+		    << w->m_file.path << ": " << w->m_job->m_done << QObject::tr (" positions, ")
+		    << w->m_job->m_total_visits << QObject::tr (" visits in ")
+		    << QString::number (w->m_job->m_total_msecs / 1000., 'f', 1) << QObject::tr (" seconds") << "\n";
+	} else {
+		m_files_failed++;
+		out << "[" << m_files_done + m_files_failed << "/" << m_n_files << "] "
+		    << w->m_file.path << ": " << QObject::tr ("failed") << "\n";
+	}
+}
+
+void BatchAnalyzer::worker_stopped ()
+{
+	for (auto &w: m_workers)
+		if (w->m_running)
+			return;
+	m_stats_timer.stop ();
+	print_stats (true);
+	qApp->exit (m_files_failed > 0 || !m_pending.isEmpty () ? 1 : 0);
+}
+
+void BatchAnalyzer::print_stats (bool final)
+{
+	double secs = m_timer.elapsed () / 1000.;
+	QTextStream out (stdout);
+	out << (final ? QObject::tr ("Finished: ") : QObject::tr ("Progress: "))
+	    << m_files_done << QObject::tr (" files done, ") << m_files_failed << QObject::tr (" failed, ")
+	    << m_files_skipped << QObject::tr (" skipped, ") << m_positions << QObject::tr (" positions in ")
+	    << QString::number (secs, 'f', 1) << QObject::tr (" seconds");
+	if (secs > 0)
+		out << " (" << QString::number (m_positions / secs, 'f', 2) << QObject::tr (" positions/s, ")
+		    << QString::number (m_visits / secs, 'f', 0) << QObject::tr (" visits/s)");
+	out << "\n";
+}
+
+/* Start the engines.  Returns false if there is nothing to do.  */
+bool BatchAnalyzer::start ()
+{
+	m_timer.start ();
+	if (m_pending.isEmpty ()) {
+		print_stats (true);
+		return false;
+	}
+	m_stats_timer.start (60 * 1000);
+	int n = std::max (1, std::min (m_opts.n_jobs, m_pending.size ()));
+	for (int i = 0; i < n; i++)
+		m_workers.emplace_back (new worker (this));
+	for (auto &w: m_workers)
+		w->start ();
+	return true;
+}
+
+/* Expand directories among PATHS into the SGF files found in them, recursively.  */
+QList<batch_input> BatchAnalyzer::collect_files (const QStringList &paths)
+{
+	QList<batch_input> result;
+	for (auto &p: paths) {
+		QFileInfo fi (p);
+		if (!fi.isDir ()) {
+			result.append (batch_input { p, fi.fileName () });
+			continue;
+		}
+		QDir base (p);
+		QStringList found;
+		QDirIterator it (p, QStringList () << "*.sgf" << "*.SGF", QDir::Files, QDirIterator::Subdirectories);
+		while (it.hasNext ())
+			found << it.next ();
+		found.sort ();
+		for (auto &f: found)
+			result.append (batch_input { f, base.relativeFilePath (f) });
+	}
+	return result;
+}
+
+/* Find the engine to use.  NAME is either the title of one of the engines configured
+   in the preferences, or a file with lines of the form "key=value", for the keys
+   title, path, args, komi and boardsize.  */
+bool BatchAnalyzer::read_engine (const QString &name, Engine &e)
+{
+	QFileInfo fi (name);
+	if (!fi.isFile ()) {
+		for (auto &it: setting->m_engines)
+			if (it.title == name) {
+				e = it;
+				return true;
+			}
+		return false;
+	}
+
+	QFile f (name);
+	if (!f.open (QIODevice::ReadOnly | QIODevice::Text))
+		return false;
+	e = Engine (fi.completeBaseName (), "", "", "", true, "19");
+	QTextStream in (&f);
+	while (!in.atEnd ()) {
+		QString line = in.readLine ().trimmed ();
+		if (line.isEmpty () || line.startsWith ('#'))
+			continue;
+		int eq = line.indexOf ('=');
+		if (eq < 0)
+			return false;
+		QString key = line.left (eq).trimmed ();
+		QString val = line.mid (eq + 1).trimmed ();
+		if (key == "title")
+			e.title = val;
+		else if (key == "path")
+			e.path = val;
+		else if (key == "args")
+			e.args = val;
+		else if (key == "komi")
+			e.komi = val;
+		else if (key == "boardsize")
+			e.boardsize = val;
+		else
+			return false;
+	}
+	return !e.path.isEmpty ();
+}
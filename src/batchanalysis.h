@@ -0,0 +1,86 @@
+/*
+ * batchanalysis.h
+ */
+
+#ifndef BATCHANALYSIS_H
+#define BATCHANALYSIS_H
+
+#include <memory>
+#include <vector>
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "setting.h"
+#include "qgtp.h"
+#include "analysisjob.h"
+
+/* Parameters for a batch analysis run from the command line.  */
+struct batch_options
+{
+	int n_jobs = 1;
+	int n_seconds = 5;
+	int n_visits = 0;
+	int n_lines = 10;
+	bool early_stop = false;
+	bool comments = true;
+	engine_komi komi_type = engine_komi::maybe_swap;
+	/* Directory for the results, or empty to write them next to the input.  */
+	QString output_dir;
+};
+
+/* A file found on the command line, together with its path relative to the argument
+   it was found under, so that the directory structure can be mirrored in the output
+   directory.  */
+struct batch_input
+{
+	QString path;
+	QString relative;
+};
+
+/* Runs batch analysis without a user interface, for use from scripts and cron jobs.
+   A number of engine processes work on the list of files in parallel, each file is
+   written out atomically once it is complete.  Files whose output already exists
+   are skipped, so an interrupted run can simply be restarted.  */
+class BatchAnalyzer : public QObject
+{
+	Q_OBJECT
+
+	struct worker;
+	friend struct worker;
+
+	Engine m_engine;
+	int m_boardsize;
+	batch_options m_opts;
+
+	QList<batch_input> m_pending;
+	std::vector<std::unique_ptr<worker>> m_workers;
+	int m_n_files;
+
+	int m_files_done = 0;
+	int m_files_failed = 0;
+	int m_files_skipped = 0;
+	long m_positions = 0;
+	long m_visits = 0;
+	QElapsedTimer m_timer;
+	QTimer m_stats_timer;
+
+	QString output_filename (const batch_input &);
+	bool take_file (batch_input &);
+	void file_done (worker *, bool ok);
+	void worker_stopped ();
+	void print_stats (bool final);
+
+public:
+	BatchAnalyzer (const Engine &, const QList<batch_input> &files, const batch_options &);
+	~BatchAnalyzer ();
+
+	bool start ();
+	static QList<batch_input> collect_files (const QStringList &paths);
+	static bool read_engine (const QString &name, Engine &);
+};
+
+#endif
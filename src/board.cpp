@@ -2,6 +2,7 @@
 * board.cpp
 */
 #include <vector>
+#include <list>
 #include <fstream>
 #include <cmath>
 
@@ -17,7 +18,9 @@
 #include <QMouseEvent>
 #include <QEvent>
 #include <QWheelEvent>
+#include <QShowEvent>
 #include <QFontMetrics>
+#include <QHash>
 
 #include "config.h"
 #include "setting.h"
@@ -28,6 +31,7 @@
 #include "clientwin.h"
 #include "miscdialogs.h"
 #include "svgbuilder.h"
+#include "markpainter.h"
 #include "ui_helpers.h"
 
 BoardView::BoardView(QWidget *parent)
@@ -45,15 +49,14 @@ BoardView::BoardView(QWidget *parent)
 
 	setStyleSheet( "QGraphicsView { border-style: none; }" );
 
-	// Create an ImageHandler instance.
-	imageHandler = new ImageHandler();
-	CHECK_PTR(imageHandler);
-
 	// Init the canvas
 	canvas = new QGraphicsScene (0, 0, BOARD_X, BOARD_Y, this);
 	setScene (canvas);
 
-	imageHandler->init(10);
+	/* Placeholder images until the view gets its real size.  */
+	m_stones = StoneAtlas::instance ()->stones (9);
+	connect (StoneAtlas::instance (), &StoneAtlas::stones_ready, this,
+		 [this] () { if (m_stones->provisional) update_stones (m_stones->size); });
 
 #if defined(Q_OS_WIN)
 	resizeDelayFlag = false;
@@ -81,7 +84,6 @@ BoardView::~BoardView()
 	canvas->removeItem (&m_stone_layer);
 	clear_graphics_elts ();
 	delete canvas;
-	delete imageHandler;
 }
 
 
@@ -92,6 +94,9 @@ Board::Board (QWidget *parent)
 	curX = curY = -1;
 
 	navIntersectionStatus = false;
+
+	m_update_timer.setSingleShot (true);
+	connect (&m_update_timer, &QTimer::timeout, [this] () { flush_updates (); });
 }
 
 Board::~Board ()
@@ -124,7 +129,7 @@ void BoardView::calculateSize ()
 	if (square_size == 0)
 		  square_size = 1;
 
-	imageHandler->rescale (square_size);
+	m_stones = StoneAtlas::instance ()->stones ((int)square_size + 1);
 
 	int board_pixel_size_x = square_size * (shown_size_x - 1);
 	int board_pixel_size_y = square_size * (shown_size_y - 1);
@@ -143,6 +148,19 @@ void BoardView::calculateSize ()
 			      board_pixel_size_x, board_pixel_size_y);
 }
 
+/* Called when the stone atlas has finished rendering a size, to replace provisional
+   stone images with proper ones.  */
+void BoardView::update_stones (int size)
+{
+	std::shared_ptr<const stone_pixmaps> s = StoneAtlas::instance ()->stones (size);
+	if (s == m_stones)
+		return;
+	m_stones = s;
+	invalidate_rendering ();
+	if (m_displayed != nullptr)
+		sync_appearance ();
+}
+
 void BoardView::resizeBoard (int w, int h)
 {
 	if (w < 30 || h < 30)
@@ -176,6 +194,79 @@ void BoardView::resizeEvent(QResizeEvent*)
 #endif
 }
 
+/* A cache of composed background images, shared by all board views.  Dialogs
+   showing several small boards, and resizes going back and forth, would otherwise
+   paint identical images over and over.  The cache is limited by the memory the
+   images occupy, and drops the least recently used ones first.  */
+class background_cache
+{
+	struct entry
+	{
+		QString key;
+		QImage image;
+	};
+	/* Most recently used first.  */
+	std::list<entry> m_lru;
+	QHash<QString, std::list<entry>::iterator> m_index;
+	qint64 m_bytes = 0;
+	qint64 m_limit;
+
+	static qint64 image_bytes (const QImage &img) { return qint64 (img.bytesPerLine ()) * img.height (); }
+
+public:
+	background_cache (qint64 limit) : m_limit (limit) { }
+	bool find (const QString &key, QImage &img)
+	{
+		auto it = m_index.find (key);
+		if (it == m_index.end ())
+			return false;
+		m_lru.splice (m_lru.begin (), m_lru, *it);
+		img = m_lru.front ().image;
+		return true;
+	}
+	void insert (const QString &key, const QImage &img)
+	{
+		m_lru.push_front (entry { key, img });
+		m_index.insert (key, m_lru.begin ());
+		m_bytes += image_bytes (img);
+		/* Always keep the newest entry, even if it exceeds the limit by itself.  */
+		while (m_bytes > m_limit && m_lru.size () > 1) {
+			entry &last = m_lru.back ();
+			m_bytes -= image_bytes (last.image);
+			m_index.remove (last.key);
+			m_lru.pop_back ();
+		}
+	}
+};
+
+static background_cache bg_cache (64 * 1024 * 1024);
+
+/* Everything that affects the image produced by background_image.  */
+QString BoardView::background_key ()
+{
+	QStringList l;
+	l << QString::number (canvas->width ()) << QString::number (canvas->height ())
+	  << QString::number (m_wood_rect.x ()) << QString::number (m_wood_rect.y ())
+	  << QString::number (m_wood_rect.width ()) << QString::number (m_wood_rect.height ())
+	  << QString::number (setting->wood_image ()->cacheKey ())
+	  << QString::number (setting->table_image ()->cacheKey ())
+	  << QString::number (setting->readBoolEntry ("SKIN_SCALE_WOOD"));
+	if (m_show_coords && m_displayed != nullptr) {
+		const go_board &b = m_displayed->get_board ();
+		l << "coords" << QString::number (square_size)
+		  << QString::number (m_board_rect.x ()) << QString::number (m_board_rect.y ())
+		  << QString::number (setting->readIntEntry ("COORDS_SIZE")) << setting->fontMarks.toString ()
+		  << QString::number (m_sgf_coords)
+		  << QString::number (b.size_x ()) << QString::number (b.size_y ())
+		  << QString::number (m_dims.width ()) << QString::number (m_dims.height ())
+		  << QString::number (m_crop.x1) << QString::number (m_crop.y1)
+		  << QString::number (m_crop.x2) << QString::number (m_crop.y2)
+		  << QString::number (m_shift_x) << QString::number (m_shift_y)
+		  << QString::number (n_dups_h ()) << QString::number (n_dups_v ());
+	}
+	return l.join ('|');
+}
+
 QImage BoardView::background_image ()
 {
 	int w = canvas->width ();
@@ -184,6 +275,11 @@ QImage BoardView::background_image ()
 	m_wood = *setting->wood_image ();
 	m_table = *setting->table_image ();
 
+	QString key = background_key ();
+	QImage cached;
+	if (bg_cache.find (key, cached))
+		return cached;
+
 	// Create pixmap of appropriate size
 	//QPixmap all(w, h);
 	QImage image (w, h, QImage::Format_RGB32);
@@ -311,6 +407,7 @@ QImage BoardView::background_image ()
 	}
 
 	painter.end ();
+	bg_cache.insert (key, image);
 	return image;
 }
 
@@ -442,7 +539,8 @@ static QString convert_letter_mark (mextra extra)
 		return QString ('a' + extra - 26);
 }
 
-/* Render a mark in SVG at center position CX/CY in a square with a side length of FACTOR.
+/* Render a mark at center position CX/CY in a square with a side length of FACTOR.
+   SVG is either an svg_builder for export, or a mark_painter for the screen.
    M and ME represent the mark as present in the board.  SC is the color of the stone that
    has been rendered before, or NONE.  COUNT_VAL, if nonzero, together with MAX_NUMBER represents
    the move number to be displayed.  VAR_M and VAR_ME represent a variation mark, typically
@@ -450,10 +548,11 @@ static QString convert_letter_mark (mextra extra)
 
    WHITE_BACKGROUND is true if we are doing this for svg export, it changes the display a
    little bit.  */
-static bool add_mark_svg (svg_builder &svg, double cx, double cy, double factor,
-			  mark m, mextra me, const std::string &mstr, mark var_m, mextra var_me,
-			  stone_color sc, int count_val, int max_number,
-			  bool was_last_move, bool white_background, const QFontInfo &fi)
+template<class T>
+static bool add_mark (T &svg, double cx, double cy, double factor,
+		      mark m, mextra me, const std::string &mstr, mark var_m, mextra var_me,
+		      stone_color sc, int count_val, int max_number,
+		      bool was_last_move, bool white_background, const QFontInfo &fi)
 {
 	QString mark_col = sc == black ? "white" : "black";
 	if (sc == none && white_background && (count_val != 0 || m != mark::none || var_m != mark::none)) {
@@ -697,9 +796,9 @@ QByteArray BoardView::render_svg (bool do_number, bool coords)
 					       c == black ? "black" : "white",
 					       c == black ? "none" : "black");
 			}
-			add_mark_svg (svg, center_x, center_y, factor,
-				      m, extra, m == mark::text ? b.mark_text_at (rx, ry) : "",
-				      mark::none, 0, c, v, max_number, false, true, fi);
+			add_mark (svg, center_x, center_y, factor,
+				  m, extra, m == mark::text ? b.mark_text_at (rx, ry) : "",
+				  mark::none, 0, c, v, max_number, false, true, fi);
 		}
 	}
 
@@ -1025,7 +1124,7 @@ void BoardView::draw_grid (QPainter &painter, bit_array &grid_hidden, int bm_lin
 const QPixmap &BoardView::choose_stone_pixmap (stone_color c, stone_type type, int bp)
 {
 	if (type == stone_type::live) {
-		const QList<QPixmap> *l = imageHandler->getStonePixmaps ();
+		const QList<QPixmap> *l = &m_stones->stones;
 		int cnt = l->count ();
 		if (c == black)
 			return (*l)[bp % (cnt/2)];
@@ -1034,7 +1133,7 @@ const QPixmap &BoardView::choose_stone_pixmap (stone_color c, stone_type type, i
 		else
 			return (*l)[cnt/2 + bp % (cnt/2)];
 	} else {
-		const QList<QPixmap> *l = imageHandler->getGhostPixmaps ();
+		const QList<QPixmap> *l = &m_stones->ghosts;
 		if (c == black)
 			return (*l)[0];
 		else
@@ -1141,7 +1240,7 @@ int Board::extract_analysis (go_board &b)
 	return collect_moves (b, first, last, true);
 }
 
-Board::ram_result Board::render_analysis_marks (svg_builder &svg, double svg_factor, double cx, double cy, const QFontInfo &fi,
+Board::ram_result Board::render_analysis_marks (mark_painter &marks, double svg_factor, double cx, double cy, const QFontInfo &fi,
 						int x, int y, bool child_mark, int v, int max_number)
 {
 	if (!have_analysis ())
@@ -1156,7 +1255,7 @@ Board::ram_result Board::render_analysis_marks (svg_builder &svg, double svg_fac
 	game_state *pv = analysis_at (x, y, pv_idx, primary);
 	if (pv == nullptr || v > 0 || (max_number > 0 && hideother)) {
 		if (child_mark) {
-			svg.circle_at (cx, cy, svg_factor * 0.45, "none", "white", "1");
+			marks.circle_at (cx, cy, svg_factor * 0.45, "none", "white", "1");
 			return ram_result::nohide;
 		}
 		return ram_result::none;
@@ -1182,11 +1281,11 @@ Board::ram_result Board::render_analysis_marks (svg_builder &svg, double svg_fac
 		QColor col = QColor::fromHsv (angle, 255, 200);
 		wr_col = col.name ();
 	}
-	svg.circle_at (cx, cy, svg_factor * 0.45, wr_col, child_mark ? "white" : "black", "1");
+	marks.circle_at (cx, cy, svg_factor * 0.45, wr_col, child_mark ? "white" : "black", "1");
 
 	if (analysis_vartype == 0) {
 		QChar c = pv_idx >= 26 ? 'a' + pv_idx - 26 : 'A' + pv_idx;
-		svg.text_at (cx, cy, svg_factor, 0, c,
+		marks.text_at (cx, cy, svg_factor, 0, c,
 			     "black", fi);
 	} else {
 		double shown_val = wrdiff;
@@ -1198,7 +1297,7 @@ Board::ram_result Board::render_analysis_marks (svg_builder &svg, double svg_fac
 		} else if (to_move == wr_swap_col)
 			shown_val = -shown_val;
 
-		svg.text_at (cx, cy, svg_factor, 4,
+		marks.text_at (cx, cy, svg_factor, 4,
 			     QString::number (shown_val * 100, 'f', 1),
 			     "black", fi);
 	}
@@ -1257,8 +1356,8 @@ QPixmap BoardView::draw_position (int default_vars_type)
 		max_number = collect_moves (mn_board, first, m_displayed, false);
 	}
 
-	/* Handle marks first.  They go into an svgbuilder which we'll render at the end,
-	   but we also use this to decide which parts of the grid to hide for better
+	/* Handle marks first.  They are collected in a mark_painter which we'll render at
+	   the end, but we also use this to decide which parts of the grid to hide for better
 	   readability.  */
 	m_used_letters.clear ();
 	m_used_numbers.clear ();
@@ -1272,23 +1371,28 @@ QPixmap BoardView::draw_position (int default_vars_type)
 	int dups_x = n_dups_h ();
 	int dups_y = n_dups_v ();
 	int bm_linewidth = visx + 2 * dups_x;
-	/* The factor is the size of a square in svg, it gets scaled later.  It should have
-	   an optically pleasant relation with the stroke width (2 for marks).  */
+	/* The factor is the size of a square in mark coordinates, it gets scaled later.  It
+	   should have an optically pleasant relation with the stroke width (2 for marks).  */
 	double svg_factor = 30;
 	QFontInfo fi (setting->fontMarks);
-	svg_builder svg (svg_factor * (visx + 2 * dups_x), svg_factor * (visy + 2 * dups_y));
+	mark_painter marks (fi);
 
 	bit_array grid_hidden (bm_linewidth * (visy + 2 * dups_y));
+	std::vector<rendered_point> points (bm_linewidth * (visy + 2 * dups_y));
 	for (int tx = 0; tx < visx + 2 * dups_x; tx++)
 		for (int ty = 0; ty < visy + 2 * dups_y; ty++) {
 			int x = (tx + shiftx + (szx - dups_x)) % szx;
 			int y = (ty + shifty + (szy - dups_y)) % szy;
+			rendered_point &pt = points[tx + ty * bm_linewidth];
 			if (visible != nullptr && !visible->test_bit (b.bitpos (x, y))) {
 				grid_hidden.set_bit (tx + ty * bm_linewidth);
+				pt.grid_hidden = true;
 				continue;
 			}
 			auto stone_display = stone_to_display (mn_board, visible, to_move, x, y, vars, var_type);
 			stone_color sc = stone_display.first;
+			pt.sc = sc;
+			pt.type = stone_display.second;
 			mark mark_at_pos = b.mark_at (x, y);
 			mextra extra = b.mark_extra_at (x, y);
 			bool was_last_move = false;
@@ -1313,48 +1417,89 @@ QPixmap BoardView::draw_position (int default_vars_type)
 
 			int v = mn_board.mark_at (x, y) == mark::num ? mn_board.mark_extra_at (x, y) : 0;
 
+			int marks_start = marks.length ();
 			bool added = false;
 			bool an_child_mark = analysis_children && v == 0 && max_number == 0 && child_vars.stone_at (x, y) == to_move;
-			ram_result rs = render_analysis_marks (svg, svg_factor, cx, cy, fi,
+			ram_result rs = render_analysis_marks (marks, svg_factor, cx, cy, fi,
 							       x, y, an_child_mark, v, max_number);
 			if (rs == ram_result::none) {
 				if (max_number > 0 && v <= max_number - setting->readIntEntry("MOVE_COUNT_MOVE_NUMBER"))
 					v = 0;
-				added = add_mark_svg (svg, cx, cy, svg_factor,
-						      mark_at_pos, extra,
-						      mark_at_pos == mark::text ? b.mark_text_at (x, y) : "",
-						      var_mark, var_me,
-						      sc, v, max_number, was_last_move, false, fi);
+				added = add_mark (marks, cx, cy, svg_factor,
+						  mark_at_pos, extra,
+						  mark_at_pos == mark::text ? b.mark_text_at (x, y) : "",
+						  var_mark, var_me,
+						  sc, v, max_number, was_last_move, false, fi);
 			} else
 				added = rs == ram_result::hide;
 
-			if (added)
+			if (added) {
 				grid_hidden.set_bit (tx + ty * bm_linewidth);
+				pt.grid_hidden = true;
+			}
+			pt.marks = marks.items_from (marks_start);
 		}
 
-	/* Now we're ready to draw the grid.  */
-	QPixmap image (m_wood_rect.size ());
-	image.fill (Qt::transparent);
+	/* Decide what needs to be drawn: everything if the layout changed, otherwise
+	   only the surroundings of points that look different than last time.  */
+	render_layout layout;
+	layout.wood = m_wood_rect;
+	layout.board = m_board_rect;
+	layout.square_size = square_size;
+	layout.crop = m_crop;
+	layout.shift_x = m_shift_x;
+	layout.shift_y = m_shift_y;
+	layout.dups_x = dups_x;
+	layout.dups_y = dups_y;
+	layout.hoshis = m_show_hoshis;
+
+	bool full = (!m_rendered_valid || !(layout == m_rendered_layout)
+		     || m_rendered_points.size () != points.size ()
+		     || m_rendered_image.size () != m_wood_rect.size ());
+	QRegion dirty;
+	if (!full) {
+		for (int tx = 0; tx < visx + 2 * dups_x; tx++)
+			for (int ty = 0; ty < visy + 2 * dups_y; ty++) {
+				int idx = tx + ty * bm_linewidth;
+				if (points[idx] != m_rendered_points[idx])
+					dirty += point_rect (tx, ty);
+			}
+		if (dirty.isEmpty ())
+			return m_rendered_image;
+	} else {
+		m_rendered_image = QPixmap (m_wood_rect.size ());
+		m_rendered_image.fill (Qt::transparent);
+	}
+
 	QPainter painter;
-	painter.begin (&image);
+	painter.begin (&m_rendered_image);
+	if (!full) {
+		painter.setClipRegion (dirty);
+		painter.setCompositionMode (QPainter::CompositionMode_Source);
+		painter.fillRect (dirty.boundingRect (), Qt::transparent);
+		painter.setCompositionMode (QPainter::CompositionMode_SourceOver);
+	}
 
+	/* Now we're ready to draw the grid.  */
 	draw_grid (painter, grid_hidden, bm_linewidth);
 
-	/* Now, draw stones.  Do this in two passes, with shadows first.  */
+	/* Now, draw stones.  Do this in two passes, with shadows first.  Stones and
+	   shadows extend past their own square, so everything overlapping the dirty
+	   area must be drawn again.  */
+	auto needs_drawing = [&] (int tx, int ty) -> bool
+		{
+			return full || dirty.intersects (point_rect (tx, ty));
+		};
 	painter.setPen (Qt::NoPen);
 	int shadow_offx = m_board_rect.left () - m_wood_rect.left () - square_size / 2 - square_size / 8;
 	int shadow_offy = m_board_rect.top () - m_wood_rect.top () - square_size / 2 + square_size / 8;
 	for (int tx = 0; tx < visx + 2 * dups_x; tx++)
 		for (int ty = 0; ty < visy + 2 * dups_y; ty++) {
-			int x = (tx + shiftx + (szx - dups_x)) % szx;
-			int y = (ty + shifty + (szy - dups_y)) % szy;
-			auto stone_display = stone_to_display (mn_board, visible, to_move, x, y, vars, var_type);
-			stone_color sc = stone_display.first;
-			stone_type type = stone_display.second;
-			if (sc != none && type == stone_type::live) {
+			const rendered_point &pt = points[tx + ty * bm_linewidth];
+			if (pt.sc != none && pt.type == stone_type::live && needs_drawing (tx, ty)) {
 				painter.drawPixmap (shadow_offx + tx * square_size,
 						    shadow_offy + ty * square_size,
-						    imageHandler->getStonePixmaps ()->last ());
+						    m_stones->stones.last ());
 			}
 		}
 
@@ -1362,36 +1507,52 @@ QPixmap BoardView::draw_position (int default_vars_type)
 	int stone_offy = m_board_rect.top () - m_wood_rect.top () - square_size / 2;
 	for (int tx = 0; tx < visx + 2 * dups_x; tx++)
 		for (int ty = 0; ty < visy + 2 * dups_y; ty++) {
-			int x = (tx + shiftx + (szx - dups_x)) % szx;
-			int y = (ty + shifty + (szy - dups_y)) % szy;
-			auto stone_display = stone_to_display (mn_board, visible, to_move, x, y, vars, var_type);
-			stone_color sc = stone_display.first;
-			stone_type type = stone_display.second;
-			if (sc != none) {
+			const rendered_point &pt = points[tx + ty * bm_linewidth];
+			if (pt.sc != none && needs_drawing (tx, ty)) {
+				int x = (tx + shiftx + (szx - dups_x)) % szx;
+				int y = (ty + shifty + (szy - dups_y)) % szy;
 				int bp = b.bitpos (x, y);
 				painter.drawPixmap (stone_offx + tx * square_size,
 						    stone_offy + ty * square_size,
-						    choose_stone_pixmap (sc, type, bp));
+						    choose_stone_pixmap (pt.sc, pt.type, bp));
 			}
 		}
 
 	/* Now render the marks on top of all that.  */
-	QTransform transform;
-	transform.translate (m_board_rect.x () - m_wood_rect.x () - square_size / 2,
+	QPointF mark_origin (m_board_rect.x () - m_wood_rect.x () - square_size / 2,
 			     m_board_rect.y () - m_wood_rect.y () - square_size / 2);
-	transform.scale (((double)m_board_rect.width () + square_size) / m_wood_rect.width (),
-			 ((double)m_board_rect.height () + square_size) / m_wood_rect.height ());
-	painter.setWorldTransform (transform);
-	QSvgRenderer renderer (svg);
-	renderer.render (&painter);
+	double mark_scale = square_size / svg_factor;
+	for (int tx = 0; tx < visx + 2 * dups_x; tx++)
+		for (int ty = 0; ty < visy + 2 * dups_y; ty++) {
+			const rendered_point &pt = points[tx + ty * bm_linewidth];
+			if (!pt.marks.empty () && needs_drawing (tx, ty))
+				marks.paint (painter, pt.marks, mark_origin, mark_scale);
+		}
 
 	painter.end ();
-	return image;
+
+	m_rendered_points = std::move (points);
+	m_rendered_layout = layout;
+	m_rendered_valid = true;
+	return m_rendered_image;
+}
+
+/* The area of the image that can be affected by what is drawn at the point with
+   visual coordinates TX/TY: the stone, its shadow and any marks.  */
+QRect BoardView::point_rect (int tx, int ty)
+{
+	int cx = m_board_rect.left () - m_wood_rect.left () + tx * square_size;
+	int cy = m_board_rect.top () - m_wood_rect.top () + ty * square_size;
+	int half = square_size * 3 / 4 + 2;
+	return QRect (cx - half, cy - half, 2 * half, 2 * half);
 }
 
 /* The central function for synchronizing visual appearance with the abstract board data.  */
 void BoardView::sync_appearance (bool)
 {
+	/* Drop the layer's reference first, so that draw_position can paint into the
+	   retained image without making a copy of it.  */
+	m_stone_layer.setPixmap (QPixmap ());
 	QPixmap stones = draw_position (m_vars_type);
 	m_stone_layer.setPixmap (stones);
 	m_stone_layer.setPos (m_wood_rect.x (), m_wood_rect.y ());
@@ -1400,8 +1561,21 @@ void BoardView::sync_appearance (bool)
 void Board::sync_appearance (bool board_only)
 {
 	if (!board_only) {
+		/* A new position; any evaluation still waiting to be shown is for the
+		   old one.  */
+		m_pending_eval = false;
 		setup_analyzer_position ();
 	}
+	draw_appearance (board_only);
+}
+
+/* Like sync_appearance, but leaves the analyzer alone.  Used for positions it
+   was already told about when they became the displayed one.  */
+void Board::draw_appearance (bool board_only)
+{
+	m_pending_board = false;
+	if (!board_only)
+		m_pending_position = false;
 	BoardView::sync_appearance (board_only);
 	const go_board &b = m_edit_board == nullptr ? m_displayed->get_board () : *m_edit_board;
 	m_board_win->recalc_scores (b);
@@ -1416,9 +1590,36 @@ void Board::set_displayed (game_state *st)
 	move_state (st);
 }
 
+bool Board::drawing_deferred ()
+{
+	QWidget *win = window ();
+	return win->isMinimized () || (m_defer_while_hidden && !win->isVisible ());
+}
+
+/* Positions of observed and played games can arrive in quick succession.  The
+   displayed node and the analyzer follow each one at once, but drawing it, along
+   with the game tree and evaluation graph, is left to flush_updates.  */
 void Board::observed_changed ()
 {
-	BoardView::set_displayed (m_state);
+	m_displayed = m_state;
+	m_pending_eval = false;
+	setup_analyzer_position ();
+	m_pending_position = true;
+	if (!drawing_deferred ())
+		schedule_updates ();
+}
+
+/* Draw a position that arrived while the window was not shown.  */
+void Board::show_deferred_position ()
+{
+	if (m_pending_position)
+		draw_appearance (false);
+}
+
+void Board::showEvent (QShowEvent *e)
+{
+	BoardView::showEvent (e);
+	show_deferred_position ();
 }
 
 void Board::set_analyzer_id (analyzer_id id)
@@ -2020,6 +2221,7 @@ void BoardView::reset_game (go_game_ptr gr)
 	m_displayed = root;
 	m_dims = board_rect (root->get_board ());
 	m_hoshis = calculate_hoshis (root->get_board ());
+	invalidate_rendering ();
 
 	alloc_graphics_elts (true);
 
@@ -2069,6 +2271,7 @@ void Board::reset_game (go_game_ptr gr)
 
 void BoardView::update_prefs ()
 {
+	invalidate_rendering ();
 	clear_graphics_elts ();
 	alloc_graphics_elts (false);
 
@@ -2254,10 +2457,42 @@ void Board::gtp_exited (GTP_Process *)
 
 void Board::eval_received (const QString &move, int visits, bool have_score)
 {
-	m_board_win->update_analyzer_ids (m_id, have_score);
 	m_displayed->update_eval (*m_eval_state);
-	m_board_win->set_eval (move, m_primary_eval, m_displayed->to_move (), visits);
-	sync_appearance ();
+	m_pending_move = move;
+	m_pending_visits = visits;
+	m_pending_have_score = have_score;
+	m_pending_eval = m_pending_board = true;
+	schedule_updates ();
+}
+
+/* Show pending updates now if enough time has passed since the last time,
+   otherwise arrange for them to be shown when it has.  */
+void Board::schedule_updates ()
+{
+	if (m_update_timer.isActive ())
+		return;
+	int interval = setting->values.analysis_update_ms;
+	qint64 elapsed = m_last_update.isValid () ? m_last_update.elapsed () : interval;
+	if (elapsed >= interval)
+		flush_updates ();
+	else
+		m_update_timer.start (interval - elapsed);
+}
+
+void Board::flush_updates ()
+{
+	m_last_update.start ();
+	if (m_pending_eval) {
+		m_pending_eval = false;
+		m_board_win->update_analyzer_ids (m_id, m_pending_have_score);
+		m_board_win->set_eval (m_pending_move, m_primary_eval, m_displayed->to_move (), m_pending_visits);
+	}
+	if (m_pending_position) {
+		/* Drawn by show_deferred_position once the window is shown.  */
+		if (!drawing_deferred ())
+			draw_appearance (false);
+	} else if (m_pending_board)
+		draw_appearance (true);
 }
 
 void Board::start_analysis (const Engine &e)
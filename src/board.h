@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 
 #include <QGraphicsView>
 #include <QDateTime>
@@ -15,20 +16,22 @@
 #include <QResizeEvent>
 #include <QMouseEvent>
 #include <QEvent>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include "defines.h"
 #include "setting.h"
 #include "goboard.h"
 #include "gogame.h"
 #include "qgtp.h"
+#include "markpainter.h"
 
-class ImageHandler;
+struct stone_pixmaps;
 class Mark;
 class Tip;
 class InterfaceHandler;
 class QNewGameDlg;
 class MainWindow;
-class svg_builder;
 class QFontInfo;
 struct Engine;
 
@@ -108,6 +111,51 @@ protected:
 
 	QGraphicsPixmapItem m_stone_layer;
 
+	/* The image produced by draw_position is retained, together with a description
+	   of what was drawn at every intersection.  On the next call, only the areas
+	   around intersections whose contents changed are repainted.  */
+	struct rendered_point
+	{
+		stone_color sc = none;
+		stone_type type = stone_type::live;
+		bool grid_hidden = false;
+		/* The marks drawn at this point.  */
+		mark_painter::item_list marks;
+
+		bool operator== (const rendered_point &other) const
+		{
+			return sc == other.sc && type == other.type && grid_hidden == other.grid_hidden && marks == other.marks;
+		}
+		bool operator!= (const rendered_point &other) const { return !(*this == other); }
+	};
+	/* Everything apart from the intersections' contents that affects the image.  If
+	   any of it changes, the image is redrawn from scratch.  */
+	struct render_layout
+	{
+		QRect wood, board;
+		double square_size = 0;
+		board_rect crop;
+		int shift_x = 0, shift_y = 0;
+		int dups_x = 0, dups_y = 0;
+		bool hoshis = false;
+
+		bool operator== (const render_layout &other) const
+		{
+			return (wood == other.wood && board == other.board
+				&& square_size == other.square_size && crop == other.crop
+				&& shift_x == other.shift_x && shift_y == other.shift_y
+				&& dups_x == other.dups_x && dups_y == other.dups_y && hoshis == other.hoshis);
+		}
+	};
+	QPixmap m_rendered_image;
+	std::vector<rendered_point> m_rendered_points;
+	render_layout m_rendered_layout;
+	bool m_rendered_valid = false;
+	/* Called when something changes that the layout does not capture, such as the
+	   stone images or line widths.  */
+	void invalidate_rendering () { m_rendered_valid = false; }
+	QRect point_rect (int tx, int ty);
+
 	virtual void sync_appearance (bool board_only = true);
 	const QPixmap &choose_stone_pixmap (stone_color, stone_type, int);
 
@@ -122,7 +170,7 @@ protected:
 	virtual stone_color cursor_color (int, int, stone_color) { return none; }
 	virtual int extract_analysis (go_board &) { return 0; }
 	enum class ram_result { none, hide, nohide };
-	virtual ram_result render_analysis_marks (svg_builder &, double, double, double, const QFontInfo &,
+	virtual ram_result render_analysis_marks (mark_painter &, double, double, double, const QFontInfo &,
 						  int, int, bool, int, int)
 	{
 		return ram_result::none;
@@ -178,6 +226,7 @@ protected:
 	virtual void resizeEvent(QResizeEvent*) override;
 
 	void calculateSize ();
+	QString background_key ();
 	void draw_background ();
 	void draw_grid (QPainter &, bit_array &, int);
 
@@ -193,7 +242,9 @@ protected:
 	QPixmap m_wood, m_table;
 	QGraphicsRectItem *coverTop, *coverLeft, *coverRight, *coverBot;
 
-	ImageHandler *imageHandler;
+	/* Shared with other views of the same size; see StoneAtlas.  */
+	std::shared_ptr<const stone_pixmaps> m_stones;
+	void update_stones (int size);
 
 #if defined(Q_OS_WIN)
 	bool resizeDelayFlag;
@@ -230,6 +281,29 @@ class Board : public BoardView, public navigable_observer, public GTP_Eval_Contr
 	   list view.  */
 	analyzer_id m_an_id;
 
+	/* Analysis results and the positions of online games can arrive much faster
+	   than it is useful to redraw.  The board, evaluation bar, game tree and
+	   evaluation graph are updated at most once per ANALYSIS_UPDATE_MS; these
+	   record what still needs to be shown.  */
+	QTimer m_update_timer;
+	QElapsedTimer m_last_update;
+	bool m_pending_board = false;
+	bool m_pending_eval = false;
+	QString m_pending_move;
+	int m_pending_visits = 0;
+	bool m_pending_have_score = false;
+
+	void schedule_updates ();
+	void flush_updates ();
+	void draw_appearance (bool board_only);
+
+	/* Set when the displayed position changed but has not been drawn yet.  While
+	   the window is minimized, or hidden with m_defer_while_hidden set, it is only
+	   drawn when the window is shown again.  */
+	bool m_defer_while_hidden = false;
+	bool m_pending_position = false;
+	bool drawing_deferred ();
+
 	bool show_cursor_p ();
 	void update_shift (int x, int y);
 
@@ -276,6 +350,8 @@ public:
 	bool player_is (stone_color c) { return c == black ? m_player_is_b : m_player_is_w; }
 
 	virtual void observed_changed () override;
+	void set_defer_while_hidden (bool on) { m_defer_while_hidden = on; }
+	void show_deferred_position ();
 
 	/* Virtuals from Gtp_Controller.  */
 	virtual void gtp_startup_success (GTP_Process *) override;
@@ -288,11 +364,12 @@ protected:
 	virtual void mouseMoveEvent(QMouseEvent *e) override;
 	virtual void wheelEvent(QWheelEvent *e) override;
 	virtual void leaveEvent(QEvent*) override;
+	virtual void showEvent(QShowEvent*) override;
 
 	virtual bool have_analysis () override;
 	game_state *analysis_at (int x, int y, int &, double &);
 	virtual stone_color cursor_color (int x, int y, stone_color to_move) override;
-	virtual ram_result render_analysis_marks (svg_builder &, double svg_factor, double cx, double cy, const QFontInfo &,
+	virtual ram_result render_analysis_marks (mark_painter &, double svg_factor, double cx, double cy, const QFontInfo &,
 						  int x, int y, bool child_mark,
 						  int v, int max_number) override;
 	virtual void sync_appearance (bool board_only = true) override;
@@ -16,6 +16,13 @@
 #include <QToolButton>
 #include <QIcon>
 
+#include <algorithm>
+#ifdef COUNT_ALLOCATIONS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#endif
+
 #include "clientwin.h"
 #include "defines.h"
 #include "playertable.h"
@@ -65,6 +72,8 @@ ClientWindow::ClientWindow(QMainWindow *parent)
 	playerListEmpty = true;
 	gamesListSteadyUpdate = false;
 	playerListSteadyUpdate = false;
+	gamesResyncPending = false;
+	playerListFiltered = false;
 	autoAwayMessage = false;
 	watch = ";" + setting->readEntry("WATCH") + ";";
 	exclude = ";" + setting->readEntry("EXCLUDE") + ";";
@@ -199,6 +208,8 @@ ClientWindow::ClientWindow(QMainWindow *parent)
 	connect(parser, &Parser::signal_cancelSeek, this, &ClientWindow::slot_cancelSeek);
 	connect(parser, &Parser::signal_SeekList, this, &ClientWindow::slot_SeekList);
 	connect(parser, &Parser::signal_refresh, this, &ClientWindow::slot_refresh);
+	connect(parser, &Parser::signal_roomnotice, this, &ClientWindow::slot_roomnotice);
+	connect(parser, &Parser::signal_gameseen, this, &ClientWindow::slot_gameseen);
 
 	connect(parser, &Parser::signal_set_observe, qgoif, &qGoIF::set_observe);
 	connect(parser, &Parser::signal_move, qgoif, &qGoIF::slot_move);
@@ -551,15 +562,77 @@ void ClientWindow::slot_last_window_closed ()
 	qApp->quit();
 }
 
+#ifdef COUNT_ALLOCATIONS
+// count all allocations, to see what handling a server line costs during a #replay;
+// enable with DEFINES += COUNT_ALLOCATIONS
+static std::atomic<qint64> alloc_count (0);
+
+void *operator new (size_t sz)
+{
+	alloc_count++;
+	if (void *p = malloc (sz ? sz : 1))
+		return p;
+	throw std::bad_alloc ();
+}
+
+void operator delete (void *p) noexcept
+{
+	free (p);
+}
+#endif
+
+// in the order of enum InfoType
+static const char *const info_type_names[] =
+{
+	"PLAYER", "GAME", "MESSAGE", "YOUHAVEMSG", "SERVERNAME",
+	"ACCOUNT", "STATUS", "IT_OTHER", "CMD", "READY",
+	"NOCLIENTMODE", "TELL", "KIBITZ", "MOVE", "BEEP",
+	"WHO", "STATS", "GAMES", "NONE", "HELP", "CHANNELS", "SHOUT",
+	"PLAYER27", "PLAYER27_START", "PLAYER27_END", "GAME7", "GAME7_START",
+	"PLAYER42", "PLAYER42_START", "PLAYER42_END", "WS"
+};
+
+// adds the time until it goes out of scope to the statistics of the line type
+class Line_Timer
+{
+	std::map<int, line_timing> *m_stats;
+	const InfoType &m_type;
+	QElapsedTimer m_clock;
+#ifdef COUNT_ALLOCATIONS
+	qint64 m_allocs = alloc_count;
+#endif
+public:
+	Line_Timer (std::map<int, line_timing> *stats, const InfoType &type) : m_stats (stats), m_type (type)
+	{
+		if (m_stats != nullptr)
+			m_clock.start ();
+	}
+	~Line_Timer ()
+	{
+		if (m_stats == nullptr)
+			return;
+		qint64 ns = m_clock.nsecsElapsed ();
+		line_timing &t = (*m_stats)[m_type];
+		t.count++;
+		t.total_ns += ns;
+		t.max_ns = std::max (t.max_ns, ns);
+#ifdef COUNT_ALLOCATIONS
+		t.allocs += alloc_count - m_allocs;
+#endif
+	}
+};
+
 // distribute text from telnet session and local commands to tables
 void ClientWindow::sendTextToApp (const QString &txt)
 {
-	static int store_sort_col = -1;
-	static int store_games_sort_col = -1;
 	static bool player7active = false;
 
+	// while replaying, measure parsing and the table and board updates it causes
+	InfoType it_ = NONE;
+	Line_Timer timer (replayActive ? &replayTimings : nullptr, it_);
+
 	// put text to parser
- 	InfoType it_ = parser->put_line (txt);
+ 	it_ = parser->put_line (txt);
 
 	// some statistics
 	setBytesIn (txt.length ()+2);
@@ -568,15 +641,22 @@ void ClientWindow::sendTextToApp (const QString &txt)
 	if (player7active && it_ != GAME7)
 	{
 		player7active = false;
-		ListView_games->setSortingEnabled (true);
-		if (store_games_sort_col != -1)
-			ListView_games->sortItems (store_games_sort_col, Qt::AscendingOrder);
-		store_games_sort_col = -1;
+		gamesResyncPending = false;
+		ListView_games->end_batch ();
 	}
 
 	switch (it_)
 	{
 	case READY:
+		// the answer to the last command is complete
+		if (cmdInFlight != nullptr)
+		{
+			// a games listing without any games ends here rather than after GAME7 lines
+			if (cmdInFlight->get_txt ().startsWith ("games"))
+				gamesResyncPending = false;
+			delete cmdInFlight;
+			cmdInFlight = nullptr;
+		}
 		if (!tn_wait_for_tn_ready && !tn_ready)
 		{
 			QTimer::singleShot (200, this, &ClientWindow::set_tn_ready);
@@ -605,12 +685,13 @@ void ClientWindow::sendTextToApp (const QString &txt)
 
 	case SERVERNAME:
 		slot_message (txt);
-		// clear send buffer
+		// clear send buffer, as far as the send budget allows; stop when
+		// nothing could be sent
 		do
 		{
 			// enable sending
 			set_tn_ready ();
-		} while (sendTextFromApp (nullptr) != 0);
+		} while (!sendBuffer.isEmpty () && !tn_ready);
 
 		// check if tables are sorted
 #if 0 && (QT_VERSION > 0x030006)
@@ -700,9 +781,7 @@ void ClientWindow::sendTextToApp (const QString &txt)
 		// end of 'who'/'user' cmd
 	case PLAYER42_END:
 	case PLAYER27_END:
-		ListView_players->setSortingEnabled (true);
-		if (store_sort_col != -1)
-			ListView_players->sortItems (store_sort_col, Qt::AscendingOrder);
+		ListView_players->end_batch ();
 
 		if (myAccount->get_gsname () == IGS)
 			ListView_players->showOpen (whoOpenCheck->isChecked ());
@@ -712,23 +791,18 @@ void ClientWindow::sendTextToApp (const QString &txt)
 		// skip table if initial table is to be loaded
 	case PLAYER27_START:
 	case PLAYER42_START:
-		store_sort_col = ListView_players->sortColumn ();
-		ListView_players->setSortingEnabled (false);
-
 		if (playerListEmpty)
 			prepare_tables (WHO);
+		// insert the whole list at once
+		ListView_players->begin_batch ();
 		break;
 
 	case GAME7_START:
 		// "emulate" GAME7_END
-		player7active = true;
-		// disable sorting for fast operation; store sort column index
+		// insert the whole list at once
 		// unfortunately there is not GAME7_END cmd, thus, it's emulated
-		if (playerListEmpty) {
-			// only if playerListEmpty, else PLAYERXX_END would not arise
-			store_games_sort_col = ListView_games->sortColumn ();
-			ListView_games->setSortingEnabled (false);
-		}
+		player7active = true;
+		ListView_games->begin_batch ();
 		break;
 
 	case ACCOUNT:
@@ -763,10 +837,100 @@ void ClientWindow::set_tn_ready()
 	sendTextFromApp (nullptr);
 }
 
+// at most this many commands are sent per second; commands for running
+// games are always sent at once, but count against the budget
+#define SEND_BUDGET 4
+
+static int command_priority (const QString &txt, bool localecho)
+{
+	static QRegExp movere ("[A-HJ-Ta-hj-t]\\d{1,2}(\\s+\\d+)?");
+	static const QStringList game_cmds = { "pass", "resign", "undo", "undoplease", "done", "adjourn",
+					       "komi", "handicap", "free", "unfree", "pause", "unpause",
+					       "addtime", "mark" };
+	static const QStringList refresh_cmds = { "who", "user", "userlist", "games", "ayt" };
+	static const QStringList lookup_cmds = { "stats", "rating", "prob", "result", "trail", "stored" };
+
+	QString t = txt.trimmed ();
+	QString first = t.section (' ', 0, 0).toLower ();
+	if (movere.exactMatch (t) || game_cmds.contains (first))
+		return SEND_GAME;
+	// typed by the user
+	if (localecho)
+		return SEND_NORMAL;
+	// "games 12" is part of starting to observe a game, and must not fall
+	// behind the "moves 12" that follows it
+	if ((refresh_cmds.contains (first) && t == first) || lookup_cmds.contains (first))
+		return SEND_BACKGROUND;
+	return SEND_NORMAL;
+}
+
+// add a command to the send buffer behind those of the same or higher
+// priority; a background command that is already waiting is not queued
+// again.  One that is being answered is: its table may have been cleared
+// for the new listing since the answer started
+void ClientWindow::queue_command (const QString &txt, bool localecho)
+{
+	int prio = command_priority (txt, localecho);
+	if (prio == SEND_BACKGROUND) {
+		for (auto s: sendBuffer)
+			if (s->get_txt () == txt)
+				return;
+	}
+
+	int pos = sendBuffer.count ();
+	while (pos > 0 && sendBuffer[pos - 1]->get_priority () > prio)
+		pos--;
+	sendBuffer.insert (pos, new sendBuf (txt, localecho, prio));
+}
+
+// send the first buffered command if the server is ready and the budget
+// allows; otherwise try again when it does
+bool ClientWindow::send_next_command ()
+{
+	if (!tn_ready || sendBuffer.isEmpty ())
+		return false;
+
+	if (!sendClock.isValid ())
+		sendClock.start ();
+	qint64 now = sendClock.elapsed ();
+	while (!sendTimes.empty () && now - sendTimes.front () >= 1000)
+		sendTimes.pop_front ();
+
+	sendBuf *s = sendBuffer.first ();
+	if (sendTimes.size () >= SEND_BUDGET && s->get_priority () != SEND_GAME)
+	{
+		if (!sendRetryPending)
+		{
+			sendRetryPending = true;
+			QTimer::singleShot (1000 - (now - sendTimes.front ()), this, [this] ()
+					    {
+						    sendRetryPending = false;
+						    sendTextFromApp (nullptr);
+					    });
+		}
+		return false;
+	}
+	sendBuffer.removeFirst ();
+	sendTimes.push_back (now);
+
+	telnetConnection->sendTextFromApp(s->get_txt());
+//qDebug("SENDBUFFER send: " + s->get_txt());
+
+	// hold the line if cmd is sent; 'ayt' is autosend cmd
+	if (!s->get_txt().contains("ayt"))
+		resetCounter();
+	if (s->get_localecho())
+		sendTextToApp(CONSOLECMDPREFIX + QString(" ") + s->get_txt());
+	tn_ready = false;
+
+	delete cmdInFlight;
+	cmdInFlight = s;
+	return true;
+}
+
 // send text via telnet session; skipping empty string!
 int ClientWindow::sendTextFromApp(const QString &txt, bool localecho)
 {
-	// implements a simple buffer
 	int valid = txt.length();
 
 	// some statistics
@@ -778,57 +942,44 @@ int ClientWindow::sendTextFromApp(const QString &txt, bool localecho)
 		// skip all commands while not telnet connection
 		sendTextToApp("Command skipped - no telnet connection: " + txt);
 		// reset buffer
+		qDeleteAll (sendBuffer);
 		sendBuffer.clear();
+		sendTimes.clear ();
+		delete cmdInFlight;
+		cmdInFlight = nullptr;
 		return 0;
 	}
 
-	// check if telnet ready
-	if (tn_ready)
-	{
-		if (!sendBuffer.isEmpty ())
-		{
-			sendBuf *s = sendBuffer.takeFirst();
-
-			// send buffer cmd first; then put current cmd to buffer
-			telnetConnection->sendTextFromApp(s->get_txt());
-//qDebug("SENDBUFFER send: " + s->get_txt());
-
-			// hold the line if cmd is sent; 'ayt' is autosend cmd
-			if (s->get_txt().indexOf("ayt") != -1)
-				resetCounter();
-			if (s->get_localecho())
-				sendTextToApp(CONSOLECMDPREFIX + QString(" ") + s->get_txt());
-			tn_ready = false;
+	if (valid)
+		queue_command (txt, localecho);
+	send_next_command ();
 
-			if (valid)
-			{
-				// append current command to send as soon as possible
-				sendBuffer.append(new sendBuf(txt, localecho));
-//qDebug("SENDBUFFER added: " + txt);
-			}
-			delete s;
-		}
-		else if (valid)
-		{
-			// buffer empty -> send direct
-			telnetConnection->sendTextFromApp(txt);
+	return sendBuffer.count();
+}
 
-			if (!txt.contains("ayt"))
-				resetCounter();
-			if (localecho)
-				sendTextToApp(CONSOLECMDPREFIX + QString(" ") + txt);
-			tn_ready = false;
+// a #replay has reached the end of its file
+void ClientWindow::slot_replay_done (qint64 lines, qint64 msecs)
+{
+	replayActive = false;
 
-//qDebug("SENDBUFFER send direct: " + txt);
-		}
-	}
-	else if (valid)
-	{
-//qDebug("SENDBUFFER added: " + txt);
-		sendBuffer.append(new sendBuf(txt, localecho));
+	QString report = QString ("replay: %1 lines in %2 ms, %3 lines/s\n")
+		.arg (lines).arg (msecs).arg (msecs > 0 ? lines * 1000 / msecs : lines);
+	report += "type              count   avg us   max us  allocs/line\n";
+	for (auto &it: replayTimings) {
+		const line_timing &t = it.second;
+		QString allocs = "-";
+#ifdef COUNT_ALLOCATIONS
+		allocs = QString::number (t.allocs / t.count);
+#endif
+		report += QString ("%1 %2 %3 %4 %5\n")
+			.arg (info_type_names[it.first], -14)
+			.arg (t.count, 8)
+			.arg (t.total_ns / t.count / 1000, 8)
+			.arg (t.max_ns / 1000, 8)
+			.arg (allocs, 12);
 	}
-
-	return sendBuffer.count();
+	slot_message (report);
+	replayTimings.clear ();
 }
 
 // show command, send it, and tell parser
@@ -846,7 +997,28 @@ void ClientWindow::sendcommand(const QString &cmd, bool localecho)
 		if (testcmd.length() <= 1)
 		{
 			sendTextToApp("local cmds available:\n"
-				      "#+dbg\t\t#-dbg\n");
+				      "#+dbg\t\t#-dbg\n"
+				      "#record <file>\t#record\n"
+				      "#replay <file> [lines per second]\n");
+			return;
+		}
+
+		// save the session, or play back a saved one and report timings
+		if (testcmd.startsWith("record"))
+		{
+			QString file = testcmd.section(' ', 1, 1);
+			if (!telnetConnection->record(file))
+				sendTextToApp("cannot record to " + file);
+			return;
+		}
+		if (testcmd.startsWith("replay "))
+		{
+			QString file = testcmd.section(' ', 1, 1);
+			int rate = testcmd.section(' ', 2, 2).toInt();
+			replayTimings.clear();
+			replayActive = telnetConnection->replay(file, rate);
+			if (!replayActive)
+				sendTextToApp("cannot replay " + file);
 			return;
 		}
 
@@ -1155,6 +1327,8 @@ void ClientWindow::slot_refresh(int i)
 			if (whoOpenCheck->isChecked())
 				wparam.append(myAccount->get_gsname() == WING ? "O" : "o");
 
+			playerListFiltered = whoBox1->currentIndex() || whoBox2->currentIndex() || whoOpenCheck->isChecked();
+
 			if (myAccount->get_gsname() == IGS)
 				sendcommand(wparam.prepend("userlist "));
 			else
@@ -1213,20 +1387,20 @@ void ClientWindow::slot_pbrefreshplayers(bool)
 
 void ClientWindow::slot_gamesPopup(int i)
 {
-	QString t1 = lv_popupGames->text(1);
-	QString t3 = lv_popupGames->text(3);
+	QString t1 = popup_game.wname;
+	QString t3 = popup_game.bname;
 	QString player_nameW = t1.right(1) == "*" ? t1.left (t1.length() - 1) : t1;
 	QString player_nameB = t3.right(1) == "*" ? t3.left( t3.length() -1 ) : t3;
 
 	switch (i) {
 	case 1:
 		// observe
-		if (lv_popupGames)
+		if (!popup_game.nr.isEmpty())
 		{
 			// set up game for observing
-			//if (qgoif->set_observe(lv_popupGames->text(0)))
+			//if (qgoif->set_observe(popup_game.nr))
 			{
-				QString gameID = lv_popupGames->text(0);
+				QString gameID = popup_game.nr;
 				// if game is set up new -> get moves
 				//   set game to observe
 				sendcommand("observe " + gameID);
@@ -1250,24 +1424,24 @@ void ClientWindow::slot_gamesPopup(int i)
 }
 
 // doubleclick actions...
-void ClientWindow::slot_click_games(QTreeWidgetItem *lv)
+void ClientWindow::slot_click_games(const QString &nr)
 {
 	// do actions if button clicked on item
-	slot_mouse_games(3, lv);
+	slot_mouse_games(3, nr);
 	qDebug("games list double clicked");
 }
 
 void ClientWindow::slot_menu_games(const QPoint &pt)
 {
-	QTreeWidgetItem *item = ListView_games->itemAt (pt);
+	QString nr = ListView_games->game_at (pt);
 	// emulate right button
-	if (item)
-		slot_mouse_games(2, item);
+	if (!nr.isNull ())
+		slot_mouse_games(2, nr);
 	qDebug("games list double clicked");
 }
 
 // mouse click on ListView_games
-void ClientWindow::slot_mouse_games(int button, QTreeWidgetItem *lv)
+void ClientWindow::slot_mouse_games(int button, const QString &nr)
 {
 	static QMenu *puw = nullptr;
 
@@ -1290,25 +1464,20 @@ void ClientWindow::slot_mouse_games(int button, QTreeWidgetItem *lv)
 
 		// right
 		case 2:
-			if (lv)
+			// store selected game
+			if (ListView_games->find_game(nr, popup_game))
 			{
 				//puw->move(pt);
 				//puw->show();
         			puw->popup( QCursor::pos() );
-				// store selected lv
-				lv_popupGames = static_cast<GamesTableItem*>(lv);
 			}
 			break;
 
 		// first menue item if doubleclick
 		case 3:
-			if (lv)
-			{
-				// store selected lv
-				lv_popupGames = static_cast<GamesTableItem*>(lv);
-
+			// store selected game
+			if (ListView_games->find_game(nr, popup_game))
 				slot_gamesPopup(1);
-			}
 			break;
 
 		default:
@@ -1413,10 +1582,9 @@ void ClientWindow::slot_matchrequest(const QString &line, bool myrequest)
 		QString lv_popup_name;
 
 		Player p;
-		if (lv_popupPlayer)
+		if (ListView_players->find_player(popup_player, p))
 		{
-			p = lv_popupPlayer->get_player ();
-			const QString txt1 = lv_popupPlayer->text(1);
+			const QString txt1 = p.name;
 			lv_popup_name = (txt1.right(1) == "*" ? txt1.left(txt1.length() -1 ) : txt1);
 
 			is_nmatch = p.nmatch && lv_popup_name == opponent;// && setting->readBoolEntry("USE_NMATCH");
@@ -1528,7 +1696,9 @@ int ClientWindow::toggle_player_state (const char *list, const QString &symbol)
 	QString name;
 	bool found = false;
 	int cnt = cpy.count(';');
-	Player p = lv_popupPlayer->get_player ();
+	Player p;
+	if (!ListView_players->find_player(popup_player, p))
+		return 0;
 
 	for (int i = 0; i < cnt; i++)
 	{
@@ -1545,7 +1715,7 @@ int ClientWindow::toggle_player_state (const char *list, const QString &symbol)
 	if (!found)
 	{
 		// not found -> add to list
-		line += lv_popupPlayer->text(1);
+		line += p.name;
 		// update player list
 		if (p.mark != "M")
 		{
@@ -1570,21 +1740,22 @@ int ClientWindow::toggle_player_state (const char *list, const QString &symbol)
 
 	setting->writeEntry(list, line);
 
-	lv_popupPlayer->update_player (p);
+	ListView_players->set_player (p);
 	return change;
 }
 
 // result of player popup
 void ClientWindow::slot_playerPopup(int i)
 {
-	if (!lv_popupPlayer)
+	Player p;
+	if (!ListView_players->find_player(popup_player, p))
 	{
 		qWarning("*** programming error - no item selected");
 		return;
 	}
 
 	// some invited players on IGS get a * after their name
-	QString txt1 = lv_popupPlayer->text(1);
+	QString txt1 = p.name;
 	QString player_name = (txt1.right(1) == "*" ? txt1.left( txt1.length() -1 ) : txt1);
 
 	switch (i)
@@ -1592,7 +1763,7 @@ void ClientWindow::slot_playerPopup(int i)
 		case 1 :
 		case 11 :
 			// match
-			slot_matchrequest(player_name + " " + lv_popupPlayer->text(2), true);
+			slot_matchrequest(player_name + " " + p.rank, true);
 			break;
 
 
@@ -1600,12 +1771,12 @@ void ClientWindow::slot_playerPopup(int i)
     		case 3:
 			// talk and stats at the same time
 			slot_talk(player_name, QString::null, true);
-      			//slot_sendcommand("stats " + lv_popupPlayer->text(1), false);
+      			//slot_sendcommand("stats " + p.name, false);
 			break;
 
 		//case 3:
 			// stats
-			//slot_sendcommand("stats " + lv_popupPlayer->text(1), false);
+			//slot_sendcommand("stats " + p.name, false);
 			//break;
 
 		case 4:
@@ -1644,28 +1815,17 @@ void ClientWindow::slot_playerPopup(int i)
 		{
 			// observe game
 
-			bool found = false;
-
 			// emulate mouse click
-			QTreeWidgetItemIterator lv(ListView_games);
-			for (QTreeWidgetItem *lvi; (lvi = *lv);)
+			Game g;
+			if (ListView_games->find_game(p.play_str, g))
 			{
-				// compare game ids
-				if (lv_popupPlayer->text(3) == lvi->text(0))
-				{
-					// emulate mouse button - doubleclick on games
-					slot_mouse_games(3, lvi);
-					found = true;
-					break;
-				}
-				lv++;
+				// emulate mouse button - doubleclick on games
+				slot_mouse_games(3, g.nr);
 			}
-
-			if (!found)
+			else
 			{
 				// if not found -> load new data
-				Game g;
-				g.nr = lv_popupPlayer->text(3);
+				g.nr = p.play_str;
 //				g.running = true;
 //				slot_game(&g);
 
@@ -1684,10 +1844,10 @@ void ClientWindow::slot_playerPopup(int i)
 }
 
 // doubleclick...
-void ClientWindow::slot_click_players(QTreeWidgetItem *lv)
+void ClientWindow::slot_click_players(const QString &name)
 {
 	// emulate right button
-	slot_mouse_players(3, lv);
+	slot_mouse_players(3, name);
 }
 // move over ListView
 /*void ClientWindow::slot_moveOver_players()
@@ -1697,17 +1857,20 @@ void ClientWindow::slot_click_players(QTreeWidgetItem *lv)
 // mouse menus
 void ClientWindow::slot_menu_players(const QPoint& pt)
 {
-	QTreeWidgetItem *item = ListView_players->itemAt (pt);
+	QString name = ListView_players->player_at (pt);
 	// emulate right button
-	if (item)
-		slot_mouse_players(2, item);
+	if (!name.isNull ())
+		slot_mouse_players(2, name);
 }
 // mouse click on ListView_players
-void ClientWindow::slot_mouse_players(int button, QTreeWidgetItem *lv)
+void ClientWindow::slot_mouse_players(int button, const QString &name)
 {
 	static QMenu *puw = nullptr;
 	static QAction *puw11 = nullptr;
-	lv_popupPlayer = static_cast<PlayerTableItem*>(lv);
+	Player p;
+	if (!ListView_players->find_player(name, p))
+		return;
+	popup_player = name;
 	// create popup window
 	if (!puw)
 	{
@@ -1728,7 +1891,7 @@ void ClientWindow::slot_mouse_players(int button, QTreeWidgetItem *lv)
 
 	}
 
-	puw11->setEnabled(lv_popupPlayer->get_player ().nmatch);
+	puw11->setEnabled(p.nmatch);
 //puw->hide();
 
 	// do actions if button clicked on item
@@ -1736,34 +1899,20 @@ void ClientWindow::slot_mouse_players(int button, QTreeWidgetItem *lv)
 	{
 		// left button
 		case 1:
-			if (lv)
-			{
-			}
 			break;
 
 		// right button
 		case 2:
-			if (lv)
-			{
-				/*QRect r = ListView_players->geometry();
-				QPoint p = r.topLeft() + pt;
-				puw->move(p);
-				puw->show();*/
-        			puw->popup( QCursor::pos() );
-				// store selected lv
-				//lv_popupPlayer = static_cast<PlayerTableItem*>(lv);
-			}
+			/*QRect r = ListView_players->geometry();
+			QPoint p = r.topLeft() + pt;
+			puw->move(p);
+			puw->show();*/
+        		puw->popup( QCursor::pos() );
 			break;
 
 		// first menu item if doubleclick
 		case 3:
-			if (lv)
-			{
-				// store selected lv
-				//lv_popupPlayer = static_cast<PlayerTableItem*>(lv);
-
-				slot_playerPopup(1);
-			}
+			slot_playerPopup(1);
 			break;
 
 		default:
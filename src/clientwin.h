@@ -12,6 +12,10 @@
 #include "config.h"
 #include "telnet.h"
 #include "parser.h"
+
+#include <deque>
+#include <map>
+#include <QElapsedTimer>
 #include "gs_globals.h"
 #include "gamestable.h"
 #include "playertable.h"
@@ -20,17 +24,32 @@
 class GamesTable;
 class GameDialog;
 
+// order of outgoing commands: commands for running games first, then everything
+// else, and automatic list refreshes and lookups last
+enum { SEND_GAME = 0, SEND_NORMAL = 1, SEND_BACKGROUND = 2 };
+
+// time spent on one kind of server line while a recorded session is replayed
+struct line_timing
+{
+	qint64 count = 0;
+	qint64 total_ns = 0;
+	qint64 max_ns = 0;
+	qint64 allocs = 0;
+};
+
 class sendBuf
 {
 public:
-	sendBuf(QString text, bool echo=true) { txt = text; localecho = echo; }
+	sendBuf(QString text, bool echo=true, int prio=SEND_NORMAL) { txt = text; localecho = echo; priority = prio; }
 	~sendBuf() {}
 	QString get_txt() { return txt; }
 	bool get_localecho() { return localecho; }
+	int get_priority() { return priority; }
 	QString txt;
 
 private:
 	bool localecho;
+	int priority;
 };
 
 class ClientWindow : public QMainWindow, public Ui::ClientWindowGui
@@ -44,6 +63,7 @@ public:
 	int sendTextFromApp(const QString&, bool localecho=true);
 	void sendcommand(const QString&, bool localecho=false);
 	void prepare_tables(InfoType);
+	void resync_tables(InfoType);
 	void set_sessionparameter(QString, bool);
 	void send_nmatch_range_parameters();
 
@@ -75,6 +95,8 @@ public slots:
 	void slot_setBytesOut(int i) { setBytesOut(i); }
 
 	void slot_refresh(int);
+	void slot_roomnotice(const QString&);
+	void slot_gameseen(const QString&);
 	void slot_playerPopup(int);
 	void slot_gamesPopup(int);
 //	void slot_channelPopup(int);
@@ -103,6 +125,7 @@ public slots:
 
 	// telnet:
 	void sendTextToApp (const QString&);
+	void slot_replay_done (qint64 lines, qint64 msecs);
 	// parser:
 	void slot_player (Player*, bool);
 	void slot_game (Game*);
@@ -130,10 +153,10 @@ public slots:
 	void slot_SeekList (const QString&, const QString&);
 
 	// gamestable/playertable:
-	void slot_mouse_games (int, QTreeWidgetItem*);
-	void slot_mouse_players (int, QTreeWidgetItem*);
-	void slot_click_games (QTreeWidgetItem*);
-	void slot_click_players (QTreeWidgetItem *);
+	void slot_mouse_games (int, const QString &);
+	void slot_mouse_players (int, const QString &);
+	void slot_click_games (const QString &);
+	void slot_click_players (const QString &);
 	void slot_menu_games (const QPoint&);
 	void slot_menu_players (const QPoint&);
 
@@ -172,6 +195,11 @@ private:
 	bool               playerListEmpty;
 	bool               playerListSteadyUpdate;
 	bool               gamesListSteadyUpdate;
+	// a 'games' listing requested by resync_tables is on its way
+	bool               gamesResyncPending;
+	// the last 'who' listing was limited to a rank range or to open players,
+	// so players missing from the table are not a sign it is out of date
+	bool               playerListFiltered;
 //	bool               gamesListEmpty;
 	bool               autoAwayMessage;
 
@@ -186,7 +214,21 @@ private:
 	ChannelList channellist;
 	QList<Talk *> talklist;
 	QList<GameDialog *> matchlist;
+	// commands waiting to be sent, most urgent first
 	QList<sendBuf *> sendBuffer;
+	// the last command sent; the server's answer to it ends with the next prompt
+	sendBuf *cmdInFlight = nullptr;
+	// when the commands of the last second were sent, for the send budget
+	std::deque<qint64> sendTimes;
+	QElapsedTimer sendClock;
+	bool sendRetryPending = false;
+
+	// collected for each InfoType during a #replay
+	bool replayActive = false;
+	std::map<int, line_timing> replayTimings;
+
+	void queue_command (const QString &, bool localecho);
+	bool send_next_command ();
 
 	QLabel *statusUsers, *statusGames, *statusServer, *statusChannel;
 	QLabel *statusOnlineTime, *statusMessage;
@@ -219,9 +261,9 @@ private:
 	QPoint		pref_p;
 	QSize		pref_s;
 
-	// popup window save
-	PlayerTableItem	*lv_popupPlayer;
-	GamesTableItem	*lv_popupGames;
+	// popup window save: name of the player, copy of the game
+	QString		popup_player;
+	Game		popup_game;
 
 	// extended user info
 	bool		extUserInfo;
@@ -0,0 +1,255 @@
+/*
+ * dashboard.cpp
+ */
+
+#include <algorithm>
+
+#include <QLabel>
+#include <QGridLayout>
+#include <QVBoxLayout>
+#include <QScrollBar>
+#include <QMenu>
+#include <QMouseEvent>
+#include <QContextMenuEvent>
+#include <QCloseEvent>
+
+#include "board.h"
+#include "dashboard.h"
+
+/* Size of the thumbnails, and the shortest time between two redraws.  */
+#define THUMB_SIZE 180
+#define DASHBOARD_UPDATE_MS 500
+
+/* The one view that draws the thumbnails of all games.  It observes the position
+   it drew last, so that it never refers to one that has been deleted.  */
+class ThumbRenderer : public BoardView, public game_state::observer
+{
+	go_game_ptr m_game;
+
+public:
+	ThumbRenderer () : BoardView (nullptr)
+	{
+		m_show_coords = false;
+	}
+	~ThumbRenderer ()
+	{
+		stop_observing ();
+	}
+	virtual void observed_changed () override
+	{
+		m_displayed = m_state;
+	}
+	QPixmap render (go_game_ptr gr, game_state *st)
+	{
+		/* Only a different board size needs a new layout; otherwise the retained
+		   image is reused, and only the points that differ are painted.  */
+		if (m_game == nullptr || m_dims != board_rect (st->get_board ())) {
+			stop_observing ();
+			reset_game (gr);
+			resizeBoard (THUMB_SIZE, THUMB_SIZE);
+		}
+		m_game = gr;
+		move_state (st);
+		return draw_position (0);
+	}
+};
+
+DashboardEntry::DashboardEntry (ObserveDashboard *d, go_game_ptr gr, game_state *st, QWidget *win)
+	: m_dashboard (d), m_window (win), m_game (gr)
+{
+	setFrameStyle (QFrame::StyledPanel | QFrame::Raised);
+
+	QVBoxLayout *l = new QVBoxLayout (this);
+	l->setContentsMargins (2, 2, 2, 2);
+	m_board = new QLabel (this);
+	m_board->setFixedSize (THUMB_SIZE, THUMB_SIZE);
+	m_board->setAlignment (Qt::AlignCenter);
+	m_caption = new QLabel (this);
+	m_caption->setAlignment (Qt::AlignHCenter);
+	l->addWidget (m_board);
+	l->addWidget (m_caption);
+
+	start_observing (st);
+}
+
+DashboardEntry::~DashboardEntry ()
+{
+	stop_observing ();
+	m_dashboard->entry_removed (this);
+}
+
+void DashboardEntry::observed_changed ()
+{
+	m_dashboard->entry_changed (this);
+}
+
+void DashboardEntry::redraw (ThumbRenderer *r)
+{
+	m_board->setPixmap (r->render (m_game, m_state));
+
+	QString w = QString::fromStdString (m_game->name_white ());
+	QString b = QString::fromStdString (m_game->name_black ());
+	QString wr = QString::fromStdString (m_game->rank_white ());
+	QString br = QString::fromStdString (m_game->rank_black ());
+	if (!wr.isEmpty ())
+		w += " [" + wr + "]";
+	if (!br.isEmpty ())
+		b += " [" + br + "]";
+	QString txt = w + " - " + b + "\n";
+	QString result = QString::fromStdString (m_game->result ());
+	if (!result.isEmpty ())
+		txt += result;
+	else
+		txt += tr ("Move %1").arg (m_state->move_number ());
+	m_caption->setText (txt);
+}
+
+void DashboardEntry::mouseDoubleClickEvent (QMouseEvent *e)
+{
+	if (e->button () != Qt::LeftButton)
+		return;
+	m_window->show ();
+	m_window->raise ();
+	m_window->activateWindow ();
+}
+
+void DashboardEntry::contextMenuEvent (QContextMenuEvent *e)
+{
+	QMenu menu;
+	QAction *open = menu.addAction (tr ("Open board window"));
+	QAction *close = menu.addAction (tr ("Stop observing"));
+	QAction *chosen = menu.exec (e->globalPos ());
+	if (chosen == open) {
+		m_window->show ();
+		m_window->raise ();
+		m_window->activateWindow ();
+	} else if (chosen == close)
+		close_game ();
+}
+
+/* Stop observing the game by closing its window.  That deletes this entry, so it
+   is not done from within our own event handlers.  */
+void DashboardEntry::close_game ()
+{
+	QMetaObject::invokeMethod (m_window, "close", Qt::QueuedConnection);
+}
+
+ObserveDashboard::ObserveDashboard ()
+	: m_renderer (new ThumbRenderer)
+{
+	setWindowTitle (tr ("Observed games"));
+	setWidgetResizable (true);
+	m_grid_widget = new QWidget;
+	m_grid = new QGridLayout (m_grid_widget);
+	m_grid->setAlignment (Qt::AlignLeft | Qt::AlignTop);
+	setWidget (m_grid_widget);
+	resize (3 * (THUMB_SIZE + 20), 2 * (THUMB_SIZE + 50));
+
+	m_redraw_timer.setSingleShot (true);
+	m_redraw_timer.setInterval (DASHBOARD_UPDATE_MS);
+	connect (&m_redraw_timer, &QTimer::timeout, this, &ObserveDashboard::redraw_dirty);
+	/* Thumbnails that were skipped because they could not be seen are drawn
+	   when scrolled into view.  */
+	connect (verticalScrollBar (), &QScrollBar::valueChanged, this, &ObserveDashboard::redraw_dirty);
+}
+
+ObserveDashboard::~ObserveDashboard ()
+{
+	/* Deleting an entry calls entry_removed.  */
+	while (!m_entries.empty ())
+		delete m_entries.back ();
+	delete m_renderer;
+}
+
+DashboardEntry *ObserveDashboard::add_game (go_game_ptr gr, game_state *st, QWidget *win)
+{
+	DashboardEntry *e = new DashboardEntry (this, gr, st, win);
+	m_entries.push_back (e);
+	relayout (true);
+	if (!isVisible ())
+		show ();
+	return e;
+}
+
+void ObserveDashboard::entry_changed (DashboardEntry *e)
+{
+	m_dirty.insert (e);
+	if (!m_redraw_timer.isActive ())
+		m_redraw_timer.start ();
+}
+
+void ObserveDashboard::entry_removed (DashboardEntry *e)
+{
+	m_dirty.remove (e);
+	m_entries.erase (std::remove (m_entries.begin (), m_entries.end (), e), m_entries.end ());
+	relayout (true);
+	if (m_entries.empty ())
+		hide ();
+}
+
+/* Arrange the entries in as many columns as fit the width of the window.  */
+void ObserveDashboard::relayout (bool force)
+{
+	int cell = THUMB_SIZE + m_grid->spacing () + 6;
+	int columns = std::max (1, viewport ()->width () / cell);
+	if (!force && columns == m_columns)
+		return;
+	m_columns = columns;
+
+	for (auto e: m_entries)
+		m_grid->removeWidget (e);
+	int n = 0;
+	for (auto e: m_entries) {
+		m_grid->addWidget (e, n / columns, n % columns);
+		n++;
+	}
+}
+
+/* Draw the entries that changed, as long as they can be seen; the others stay in
+   m_dirty until they are scrolled into view or the window is shown.  */
+void ObserveDashboard::redraw_dirty ()
+{
+	if (!isVisible () || isMinimized ())
+		return;
+
+	QRect shown (m_grid_widget->mapFrom (viewport (), QPoint (0, 0)), viewport ()->size ());
+	for (auto it = m_dirty.begin (); it != m_dirty.end ();) {
+		DashboardEntry *e = *it;
+		if (!e->geometry ().intersects (shown)) {
+			++it;
+			continue;
+		}
+		e->redraw (m_renderer);
+		it = m_dirty.erase (it);
+	}
+}
+
+void ObserveDashboard::resizeEvent (QResizeEvent *e)
+{
+	QScrollArea::resizeEvent (e);
+	relayout (false);
+	redraw_dirty ();
+}
+
+void ObserveDashboard::showEvent (QShowEvent *e)
+{
+	QScrollArea::showEvent (e);
+	redraw_dirty ();
+}
+
+/* Games whose windows are hidden could not be reached any more once the dashboard
+   is closed, so closing it stops observing them.  */
+void ObserveDashboard::closeEvent (QCloseEvent *e)
+{
+	for (auto entry: m_entries)
+		if (!entry->window_shown ())
+			entry->close_game ();
+	QScrollArea::closeEvent (e);
+}
+
+void ObserveDashboard::changeEvent (QEvent *e)
+{
+	QScrollArea::changeEvent (e);
+	if (e->type () == QEvent::WindowStateChange)
+		redraw_dirty ();
+}
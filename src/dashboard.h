@@ -0,0 +1,85 @@
+/*
+ * dashboard.h
+ */
+
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <vector>
+
+#include <QScrollArea>
+#include <QFrame>
+#include <QTimer>
+#include <QSet>
+
+#include "gogame.h"
+
+class ThumbRenderer;
+class QLabel;
+class QGridLayout;
+class ObserveDashboard;
+
+/* One game in the dashboard.  It follows the latest position of the game like
+   the qGoBoard receiving the moves does, but only tells the dashboard about
+   changes; drawing is left to it.  */
+class DashboardEntry : public QFrame, public game_state::observer
+{
+	Q_OBJECT
+
+	ObserveDashboard *m_dashboard;
+	/* The full board window of the game, shown on a double click.  */
+	QWidget *m_window;
+	go_game_ptr m_game;
+	QLabel *m_board;
+	QLabel *m_caption;
+
+public:
+	DashboardEntry (ObserveDashboard *, go_game_ptr, game_state *, QWidget *win);
+	~DashboardEntry ();
+
+	virtual void observed_changed () override;
+	void redraw (ThumbRenderer *);
+	bool window_shown () const { return m_window->isVisible (); }
+	void close_game ();
+
+protected:
+	virtual void mouseDoubleClickEvent (QMouseEvent *) override;
+	virtual void contextMenuEvent (QContextMenuEvent *) override;
+};
+
+/* A grid of small boards, one for each observed game that is not shown in its
+   own window.  The thumbnails are all drawn by one ThumbRenderer with the stone
+   images of the StoneAtlas, at most once per DASHBOARD_UPDATE_MS, and only while
+   they can be seen.  */
+class ObserveDashboard : public QScrollArea
+{
+	Q_OBJECT
+
+	QWidget *m_grid_widget;
+	QGridLayout *m_grid;
+	std::vector<DashboardEntry *> m_entries;
+	/* Entries whose game has moved on since they were last drawn.  */
+	QSet<DashboardEntry *> m_dirty;
+	QTimer m_redraw_timer;
+	ThumbRenderer *m_renderer;
+	int m_columns = 0;
+
+	void relayout (bool force);
+	void redraw_dirty ();
+
+public:
+	ObserveDashboard ();
+	~ObserveDashboard ();
+
+	DashboardEntry *add_game (go_game_ptr, game_state *, QWidget *win);
+	void entry_changed (DashboardEntry *);
+	void entry_removed (DashboardEntry *);
+
+protected:
+	virtual void resizeEvent (QResizeEvent *) override;
+	virtual void showEvent (QShowEvent *) override;
+	virtual void changeEvent (QEvent *) override;
+	virtual void closeEvent (QCloseEvent *) override;
+};
+
+#endif
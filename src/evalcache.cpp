@@ -0,0 +1,216 @@
+#include <QSqlQuery>
+#include <QVariant>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QStringList>
+
+#include "gogame.h"
+#include "evalcache.h"
+
+eval_cache *analysis_cache;
+
+eval_cache::eval_cache ()
+{
+	QString dir = QStandardPaths::writableLocation (QStandardPaths::CacheLocation);
+	if (dir.isEmpty () || !QDir ().mkpath (dir))
+		return;
+
+	m_db = QSqlDatabase::addDatabase ("QSQLITE", "evalcache");
+	m_db.setDatabaseName (QDir (dir).filePath ("evalcache.db"));
+	if (!m_db.open ())
+		return;
+
+	QSqlQuery q (m_db);
+	q.exec ("pragma journal_mode = wal");
+	q.exec ("pragma synchronous = normal");
+	m_ok = q.exec ("create table if not exists evals (key text primary key, visits integer, data text)");
+}
+
+eval_cache::~eval_cache ()
+{
+	m_db.close ();
+}
+
+/* Find the point that may not be retaken immediately because the move that led to ST
+   took a simple ko.  Returns false if there is no such point.  */
+static bool ko_point (game_state *st, int &kx, int &ky)
+{
+	game_state *parent = st->prev_move ();
+	if (parent == nullptr || !st->was_move_p ())
+		return false;
+
+	const go_board &b = st->get_board ();
+	const go_board &pb = parent->get_board ();
+	stone_color col = st->get_move_color ();
+	stone_color opp = flip_color (col);
+	int n_caps = 0;
+	for (int x = 0; x < b.size_x (); x++)
+		for (int y = 0; y < b.size_y (); y++)
+			if (pb.stone_at (x, y) == opp && b.stone_at (x, y) == none) {
+				kx = x;
+				ky = y;
+				n_caps++;
+			}
+	if (n_caps != 1)
+		return false;
+
+	int mx = st->get_move_x ();
+	int my = st->get_move_y ();
+	static const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	bool adjacent = false;
+	for (auto &o: offsets) {
+		int nx = mx + o[0];
+		int ny = my + o[1];
+		if (nx < 0 || nx >= b.size_x () || ny < 0 || ny >= b.size_y ())
+			continue;
+		if (nx == kx && ny == ky) {
+			adjacent = true;
+			continue;
+		}
+		if (b.stone_at (nx, ny) != opp)
+			return false;
+	}
+	return adjacent;
+}
+
+eval_cache::key eval_cache::make_key (game_state *st, double komi, const std::string &rules, const std::string &engine)
+{
+	key k;
+	const go_board &b = st->get_board ();
+	std::string pos = b.canonical_position (k.sym);
+	k.size = b.size_x ();
+
+	int kx, ky;
+	if (ko_point (st, kx, ky)) {
+		transform_coords (k.sym, k.size, kx, ky);
+		pos += " ko " + std::to_string (kx) + "," + std::to_string (ky);
+	}
+	pos += st->to_move () == black ? " B " : " W ";
+	pos += komi_str (komi) + " " + rules + " " + engine;
+
+	k.hash = QCryptographicHash::hash (QByteArray::fromStdString (pos), QCryptographicHash::Sha1).toHex ();
+	return k;
+}
+
+static QString eval_line (const eval &ev)
+{
+	return (QString::number (ev.visits) + " " + QString::number (ev.wr_black)
+		+ " " + QString::number (ev.score_mean) + " " + QString::number (ev.score_stddev));
+}
+
+static bool parse_eval (const QStringList &fields, eval &ev)
+{
+	if (fields.size () < 4)
+		return false;
+	bool ok1, ok2, ok3, ok4;
+	ev.visits = fields[0].toInt (&ok1);
+	ev.wr_black = fields[1].toDouble (&ok2);
+	ev.score_mean = fields[2].toDouble (&ok3);
+	ev.score_stddev = fields[3].toDouble (&ok4);
+	return ok1 && ok2 && ok3 && ok4;
+}
+
+/* Look up an evaluation for the position in ST, and if one with at least MIN_VISITS
+   in total over its candidate moves is found, add it to ST together with its variations, in the same form that the
+   GTP controller produces from engine output.  */
+bool eval_cache::lookup (const key &k, int min_visits, game_state *st, const analyzer_id &id, result &res)
+{
+	if (!m_ok)
+		return false;
+
+	QSqlQuery q (m_db);
+	q.prepare ("select visits, data from evals where key = ?");
+	q.addBindValue (k.hash);
+	if (!q.exec () || !q.next ())
+		return false;
+	if (q.value (0).toInt () < min_visits)
+		return false;
+
+	QStringList lines = q.value (1).toString ().split ('\n', QString::SkipEmptyParts);
+	eval root;
+	if (lines.isEmpty () || !parse_eval (lines[0].split (' ', QString::SkipEmptyParts), root))
+		return false;
+
+	st->set_eval_data (root.visits, root.wr_black, root.score_mean, root.score_stddev, id);
+	res.visits = root.visits;
+	res.have_score = root.score_stddev != 0;
+	res.x = res.y = -1;
+
+	const go_board &b = st->get_board ();
+	int count = 0;
+	for (int i = 1; i < lines.size (); i++) {
+		QStringList fields = lines[i].split (' ', QString::SkipEmptyParts);
+		eval ev;
+		if (!parse_eval (fields, ev))
+			continue;
+		game_state *cur = st;
+		for (int j = 4; j < fields.size (); j++) {
+			QStringList xy = fields[j].split (',');
+			if (xy.size () != 2)
+				break;
+			int x = xy[0].toInt ();
+			int y = xy[1].toInt ();
+			inverse_transform_coords (k.sym, k.size, x, y);
+			if (x < 0 || x >= b.size_x () || y < 0 || y >= b.size_y ())
+				break;
+			game_state *next = cur->add_child_move (x, y);
+			if (next == nullptr)
+				break;
+			if (cur == st) {
+				cur->set_mark (x, y, mark::letter, count);
+				next->set_eval_data (ev.visits, ev.wr_black, ev.score_mean, ev.score_stddev, id);
+				next->set_figure (257, "");
+				if (count == 0) {
+					res.x = x;
+					res.y = y;
+				}
+			}
+			cur = next;
+		}
+		count++;
+	}
+	return true;
+}
+
+/* Store the evaluation found in ST, unless the cache already holds one with at least
+   as many visits.  The visits column holds the total over all candidate moves, the
+   same measure the visit targets of analysis jobs use; the root's own count is only
+   that of the top move.  */
+void eval_cache::store (const key &k, game_state *st, const analyzer_id &id)
+{
+	if (!m_ok)
+		return;
+
+	eval root = st->eval_from (id, true);
+	if (root.visits == 0)
+		return;
+
+	int total_visits = 0;
+	for (auto c: st->children ())
+		total_visits += c->eval_from (id, true).visits;
+
+	QSqlQuery q (m_db);
+	q.prepare ("select visits from evals where key = ?");
+	q.addBindValue (k.hash);
+	if (q.exec () && q.next () && q.value (0).toInt () >= total_visits)
+		return;
+
+	QString data = eval_line (root) + "\n";
+	for (auto c: st->children ()) {
+		QString line = eval_line (c->eval_from (id, true));
+		for (game_state *m = c; m != nullptr && m->was_move_p (); m = m->next_primary_move ()) {
+			int x = m->get_move_x ();
+			int y = m->get_move_y ();
+			transform_coords (k.sym, k.size, x, y);
+			line += " " + QString::number (x) + "," + QString::number (y);
+		}
+		data += line + "\n";
+	}
+
+	q.prepare ("insert or replace into evals (key, visits, data) values (?, ?, ?)");
+	q.addBindValue (k.hash);
+	q.addBindValue (total_visits);
+	q.addBindValue (data);
+	q.exec ();
+}
@@ -0,0 +1,52 @@
+/*
+ * evalcache.h
+ */
+
+#ifndef EVALCACHE_H
+#define EVALCACHE_H
+
+#include <QString>
+#include <QSqlDatabase>
+
+#include "goeval.h"
+
+class game_state;
+
+/* A persistent store of engine analysis results, so that positions which were
+   analyzed before, in this game or in any other, need not be sent to the engine
+   again.  Entries are keyed by a hash of the position in canonical orientation,
+   together with the side to move, a possible ko ban, komi, rules and the engine.
+   Moves are stored in canonical coordinates and transformed back on lookup.  */
+class eval_cache
+{
+	QSqlDatabase m_db;
+	bool m_ok = false;
+
+public:
+	struct key
+	{
+		QString hash;
+		/* The symmetry which maps the position to its canonical orientation.  */
+		int sym = 0;
+		int size = 0;
+	};
+	/* Describes the engine's top choice for a position found in the cache.  */
+	struct result
+	{
+		int visits = 0;
+		/* Coordinates of the top choice, or -1 for a pass.  */
+		int x = -1, y = -1;
+		bool have_score = false;
+	};
+
+	eval_cache ();
+	~eval_cache ();
+
+	static key make_key (game_state *, double komi, const std::string &rules, const std::string &engine);
+	bool lookup (const key &, int min_visits, game_state *, const analyzer_id &, result &);
+	void store (const key &, game_state *, const analyzer_id &);
+};
+
+extern eval_cache *analysis_cache;
+
+#endif
@@ -27,9 +27,20 @@ EvalGraph::EvalGraph (QWidget *parent)
 	gradient.setColorAt (1, Qt::black);
 	gradient.setCoordinateMode (QGradient::StretchToDeviceMode);
 	m_brush = new QBrush (gradient);
-	QGraphicsRectItem *r = m_scene->addRect (0, 0, GRADIENT_WIDTH, h, Qt::NoPen, *m_brush);
-	r->setZValue (-2);
-	m_scene->addLine (0, h / 2, w, h / 2);
+	m_gradient_item = m_scene->addRect (0, 0, GRADIENT_WIDTH, h, Qt::NoPen, *m_brush);
+	m_gradient_item->setZValue (-2);
+	m_mid_item = m_scene->addLine (0, h / 2, w, h / 2);
+	m_mid_item->setZValue (2);
+	m_type_item = m_scene->addText (tr ("Win rate"));
+	m_type_item->setZValue (4);
+	m_type_item->hide ();
+	m_sel_item = m_scene->addRect (0, 0, 0, 0, Qt::NoPen, QBrush (Qt::gray));
+	m_sel_item->setZValue (2);
+	m_sel_item->hide ();
+	m_sd_item = m_scene->addPath (QPainterPath (), Qt::NoPen);
+	m_sd_item->setZValue (1);
+	m_chg_items[0] = m_scene->addPath (QPainterPath (), Qt::NoPen, QBrush (Qt::black));
+	m_chg_items[1] = m_scene->addPath (QPainterPath (), Qt::NoPen, QBrush (Qt::white));
 	setAlignment (Qt::AlignTop | Qt::AlignLeft);
 
 	setToolTip (tr ("The evaluation graph.\nDisplays evaluation data found in the game record."));
@@ -64,6 +75,7 @@ void EvalGraph::mouseMoveEvent (QMouseEvent *e)
 
 void EvalGraph::resizeEvent (QResizeEvent*)
 {
+	m_layout_dirty = true;
 	update (m_game, m_active, m_id_idx);
 }
 
@@ -95,12 +107,14 @@ void EvalGraph::contextMenuEvent (QContextMenuEvent *e)
 void EvalGraph::show_scores (bool)
 {
 	m_show_scores = true;
+	m_layout_dirty = true;
 	update (m_game, m_active, m_id_idx);
 }
 
 void EvalGraph::show_winrates (bool)
 {
 	m_show_scores = false;
+	m_layout_dirty = true;
 	update (m_game, m_active, m_id_idx);
 }
 
@@ -128,91 +142,208 @@ void EvalGraph::export_file (bool)
 		QMessageBox::warning (this, PACKAGE, tr("Failed to save image!"));
 }
 
-void EvalGraph::update (go_game_ptr gr, game_state *active, int sel_idx)
+void EvalGraph::read_sample (sample &s, const game_state *st, int id)
 {
-	int w = width ();
-	int h = height ();
+	const eval_record *ev = st->find_eval (id);
+	s.valid = ev != nullptr;
+	if (s.valid) {
+		s.wr_black = ev->wr_black;
+		s.score_mean = ev->score_mean;
+		s.score_stddev = ev->score_stddev;
+	}
+}
 
-	m_scene->clear ();
-	QGraphicsRectItem *gradr = m_scene->addRect (0, 0, GRADIENT_WIDTH, h, Qt::NoPen, *m_brush);
-	gradr->setZValue (-2);
-	QGraphicsLineItem *line = m_scene->addLine (0, h / 2, w, h / 2);
-	line->setZValue (2);
+/* Bring the cached main line and the samples up to date with GR.  Evaluations are
+   only looked up for nodes whose evaluations changed since the last call, and for
+   model rows that now show a different analyzer.  When only evaluations changed,
+   the nodes to look at come from the game_state log of changes rather than a walk
+   along the main line.  Returns true if anything that affects the paths has
+   changed.  */
+bool EvalGraph::refresh_samples (go_game_ptr gr)
+{
+	bool new_game = gr != m_game;
+	if (new_game) {
+		m_line.clear ();
+		m_line_serials.clear ();
+		m_movers.clear ();
+		m_line_index.clear ();
+		m_samples.clear ();
+		m_sample_ids.clear ();
+	}
+	m_game = gr;
 
-	if (gr == nullptr)
-		return;
+	bool changed = false;
+	const auto &entries = m_model->entries ();
+	size_t rows = entries.size ();
+	size_t old_rows = m_samples.size ();
+	if (rows != old_rows) {
+		m_samples.resize (rows, std::vector<sample> (m_line.size ()));
+		m_sample_ids.resize (rows);
+		changed = true;
+	}
+	std::vector<bool> row_stale (rows, false);
+	bool any_stale = false;
+	for (size_t r = 0; r < rows; r++) {
+		int id = intern_analyzer_id (entries[r].first);
+		if (r >= old_rows || m_sample_ids[r] != id) {
+			m_sample_ids[r] = id;
+			row_stale[r] = true;
+			any_stale = true;
+		}
+	}
 
-	w -= GRADIENT_WIDTH;
+	if (!new_game && !any_stale && game_state::change_serial () == m_seen_serial)
+		return changed;
+	unsigned long seen = m_seen_serial;
+	m_seen_serial = game_state::change_serial ();
+
+	/* If no tree changed shape, the main line is still the same, and only the nodes
+	   whose evaluations changed need to be looked at.  */
+	if (!new_game && !any_stale && game_state::shape_serial () <= seen
+	    && game_state::evals_changed_since (seen, [this, &changed] (const game_state *changed_st) {
+		    auto it = m_line_index.find (changed_st);
+		    if (it == m_line_index.end () || m_line[it->second] != changed_st)
+			    return;
+		    size_t n = it->second;
+		    game_state *st = m_line[n];
+		    if (m_line_serials[n] == st->evals_serial ())
+			    return;
+		    m_line_serials[n] = st->evals_serial ();
+		    for (size_t r = 0; r < m_samples.size (); r++)
+			    read_sample (m_samples[r][n], st, m_sample_ids[r]);
+		    changed = true;
+	    }))
+		return changed;
+
+	size_t n = 0;
+	for (game_state *st = gr->get_root (); st != nullptr; st = st->next_primary_move (), n++) {
+		if (n == m_line.size ()) {
+			m_line.push_back (nullptr);
+			m_line_serials.push_back (0);
+			m_movers.push_back (none);
+			for (auto &s: m_samples)
+				s.emplace_back ();
+		}
+		bool known = m_line[n] == st && m_line_serials[n] == st->evals_serial ();
+		if (m_line[n] != st) {
+			/* The old node may have moved elsewhere in the line already.  */
+			auto it = m_line_index.find (m_line[n]);
+			if (it != m_line_index.end () && it->second == n)
+				m_line_index.erase (it);
+			m_line[n] = st;
+			m_line_index[st] = n;
+		}
+		for (size_t r = 0; r < rows; r++) {
+			if (known && !row_stale[r])
+				continue;
+			read_sample (m_samples[r][n], st, m_sample_ids[r]);
+			changed = true;
+		}
+		m_line_serials[n] = st->evals_serial ();
+		stone_color mover = !st->was_move_p () ? none : st->get_move_color () == black ? black : white;
+		if (m_movers[n] != mover) {
+			m_movers[n] = mover;
+			changed = true;
+		}
+	}
+	if (n < m_line.size ()) {
+		for (size_t i = n; i < m_line.size (); i++) {
+			auto it = m_line_index.find (m_line[i]);
+			if (it != m_line_index.end () && it->second == i)
+				m_line_index.erase (it);
+		}
+		m_line.resize (n);
+		m_line_serials.resize (n);
+		m_movers.resize (n);
+		for (auto &s: m_samples)
+			s.resize (n);
+		changed = true;
+	}
+	return changed;
+}
 
-	game_state *r = gr->get_root ();
+/* Recompute the paths of the graph from the cached samples.  */
+void EvalGraph::rebuild_paths ()
+{
+	m_layout_dirty = false;
 
-	m_game = gr;
-	m_active = active;
-	m_id_idx = sel_idx;
-
-	size_t count = 0;
-	int active_point = -1;
-	for (game_state *st = r; st != nullptr; st = st->next_primary_move ()) {
-		if (active == st)
-			active_point = count;
-		count++;
-	}
+	int w = width ();
+	int h = height ();
+	m_gradient_item->setRect (0, 0, GRADIENT_WIDTH, h);
+	m_mid_item->setLine (0, h / 2, w, h / 2);
 
+	w -= GRADIENT_WIDTH;
+
+	size_t count = m_line.size ();
 	m_step = (double)w / count;
 
-	QGraphicsTextItem *type = m_scene->addText (m_show_scores ? tr ("Score") : tr ("Win rate"));
-	QRectF trect = type->boundingRect ();
-	type->setPos (w - trect.width (), h - trect.height ());
-	type->setZValue (4);
-	for (int idnr = 0; idnr < m_model->rowCount (); idnr++) {
-		if (m_show_scores && idnr != sel_idx)
-			continue;
-		auto e = m_model->entries ()[idnr];
-		auto id = e.first;
+	m_type_item->setPlainText (m_show_scores ? tr ("Score") : tr ("Win rate"));
+	QRectF trect = m_type_item->boundingRect ();
+	m_type_item->setPos (w - trect.width (), h - trect.height ());
+	m_type_item->show ();
+
+	/* The rectangles for score deviations and winrate changes are collected into one
+	   path each rather than being added as separate items.  */
+	QPainterPath sd_path;
+	QPainterPath chg_paths[2];
+	sd_path.setFillRule (Qt::WindingFill);
+	chg_paths[0].setFillRule (Qt::WindingFill);
+	chg_paths[1].setFillRule (Qt::WindingFill);
+
+	size_t rows = m_samples.size ();
+	while (m_path_items.size () < rows) {
+		QGraphicsPathItem *p = m_scene->addPath (QPainterPath ());
+		p->setZValue (3);
+		m_path_items.push_back (p);
+	}
+	for (size_t idnr = 0; idnr < m_path_items.size (); idnr++) {
 		QPainterPath path;
+		bool selected = (int)idnr == m_id_idx;
+		if (idnr >= rows || (m_show_scores && !selected)) {
+			m_path_items[idnr]->setPath (path);
+			continue;
+		}
 		bool on_path = false;
-		game_state *st = r;
 		double prev = 0;
 
 		QPen pen;
 		pen.setWidth (2);
 		QVariant v = m_model->data (m_model->index (idnr, 0), Qt::DecorationRole);
 		pen.setColor (v.value<QColor> ());
-		QBrush sdbrush (v.value<QColor> ().lighter ());
-		for (int x = 0; st != nullptr; x++, st = st->next_primary_move ()) {
-			eval ev;
-			if (!st->find_eval (id, ev)) {
+		if (selected)
+			m_sd_item->setBrush (QBrush (v.value<QColor> ().lighter ()));
+		const std::vector<sample> &samples = m_samples[idnr];
+		for (size_t x = 0; x < count; x++) {
+			const sample &s = samples[x];
+			if (!s.valid) {
 				on_path = false;
 				continue;
 			}
 			double val;
 			if (m_show_scores) {
-				if (ev.score_stddev == 0) {
+				if (s.score_stddev == 0) {
 					on_path = false;
 					continue;
 				}
-				val = (ev.score_mean + 15.) / 30;
-				double vmin = val - ev.score_stddev / 30.;
-				double vmax = val + ev.score_stddev / 30.;
+				val = (s.score_mean + 15.) / 30;
+				double vmin = val - s.score_stddev / 30.;
+				double vmax = val + s.score_stddev / 30.;
 				val = std::min (1.0, std::max (val, 0.0));
 				double vminb = std::min (1.0, std::max (vmin, 0.0));
 				double vmaxb = std::min (1.0, std::max (vmax, 0.0));
-				QGraphicsRectItem *sdrect;
-				sdrect = m_scene->addRect (GRADIENT_WIDTH + x * m_step, (h - 2) * vminb,
-							   m_step, (h - 2) * (vmaxb - vminb), Qt::NoPen, sdbrush);
-				sdrect->setZValue (1);
+				sd_path.addRect (GRADIENT_WIDTH + x * m_step, (h - 2) * vminb,
+						 m_step, (h - 2) * (vmaxb - vminb));
 			} else
-				val = ev.wr_black;
+				val = s.wr_black;
 
 			if (on_path) {
 				path.lineTo (GRADIENT_WIDTH + x * m_step, (h - 2) * val);
 				double chg = val - prev;
-				if (!m_show_scores && chg != 0 && st->was_move_p () && idnr == sel_idx) {
-					QBrush br (st->get_move_color () == black ? Qt::black : Qt::white);
+				if (!m_show_scores && chg != 0 && m_movers[x] != none && selected) {
 					/* One idea was to offset this by half the width of a step, so as to
 					   make the change appear between moves, but I found that confusing.  */
-					m_scene->addRect (GRADIENT_WIDTH + x * m_step, h / 2, m_step, h * chg,
-							  Qt::NoPen, br);
+					QRectF r (GRADIENT_WIDTH + x * m_step, h / 2, m_step, h * chg);
+					chg_paths[m_movers[x] == black ? 0 : 1].addRect (r.normalized ());
 				}
 			} else
 				path.moveTo (GRADIENT_WIDTH + x * m_step, (h - 2) * val);
@@ -220,14 +351,59 @@ void EvalGraph::update (go_game_ptr gr, game_state *active, int sel_idx)
 			on_path = true;
 		}
 
-		QGraphicsPathItem *p = m_scene->addPath (path, pen);
-		p->setZValue (3);
+		m_path_items[idnr]->setPen (pen);
+		m_path_items[idnr]->setPath (path);
 	}
-	QGraphicsRectItem *sel = m_scene->addRect (GRADIENT_WIDTH + (int)(active_point * m_step), 0, round (m_step), h,
-						   Qt::NoPen, QBrush (Qt::gray));
-	sel->setZValue (2);
+	m_sd_item->setPath (sd_path);
+	m_chg_items[0]->setPath (chg_paths[0]);
+	m_chg_items[1]->setPath (chg_paths[1]);
+}
 
-	m_scene->update ();
+/* Place the marker for the active position; the only thing that changes when the
+   user merely moves through the game.  */
+void EvalGraph::move_marker ()
+{
+	auto it = m_line_index.find (m_active);
+	if (it == m_line_index.end ()) {
+		m_sel_item->hide ();
+		return;
+	}
+	m_sel_item->setRect (GRADIENT_WIDTH + (int)(it->second * m_step), 0, round (m_step), height ());
+	m_sel_item->show ();
+}
+
+void EvalGraph::update (go_game_ptr gr, game_state *active, int sel_idx)
+{
+	m_active = active;
+
+	if (gr == nullptr) {
+		int h = height ();
+		m_gradient_item->setRect (0, 0, GRADIENT_WIDTH, h);
+		m_mid_item->setLine (0, h / 2, width (), h / 2);
+		m_game = nullptr;
+		m_line.clear ();
+		m_line_serials.clear ();
+		m_movers.clear ();
+		m_line_index.clear ();
+		m_samples.clear ();
+		m_sample_ids.clear ();
+		for (auto p: m_path_items)
+			p->setPath (QPainterPath ());
+		m_sd_item->setPath (QPainterPath ());
+		m_chg_items[0]->setPath (QPainterPath ());
+		m_chg_items[1]->setPath (QPainterPath ());
+		m_type_item->hide ();
+		m_sel_item->hide ();
+		m_layout_dirty = true;
+		return;
+	}
+
+	bool changed = refresh_samples (gr);
+	if (changed || m_layout_dirty || sel_idx != m_id_idx) {
+		m_id_idx = sel_idx;
+		rebuild_paths ();
+	}
+	move_marker ();
 }
 
 void EvalGraph::changeEvent (QEvent *e)
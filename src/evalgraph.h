@@ -7,8 +7,11 @@
 
 #include <QGraphicsView>
 #include <memory>
+#include <vector>
+#include <unordered_map>
 #include "defines.h"
 #include "setting.h"
+#include "goboard.h"
 #include "goeval.h"
 
 class game_state;
@@ -21,6 +24,15 @@ class EvalGraph : public QGraphicsView
 {
 	Q_OBJECT
 
+	/* The evaluation of one analyzer at one node of the main line.  */
+	struct sample
+	{
+		bool valid = false;
+		double wr_black = 0;
+		double score_mean = 0;
+		double score_stddev = 0;
+	};
+
 	MainWindow *m_win {};
 	const an_id_model *m_model {};
 
@@ -29,9 +41,39 @@ class EvalGraph : public QGraphicsView
 	int m_id_idx = 0;
 	QGraphicsScene *m_scene;
 	QBrush *m_brush;
-	double m_step;
+	double m_step = 1;
 	bool m_show_scores = false;
 
+	/* The main line of m_game as of the last update, with the evaluation serial of
+	   each node at the time its samples were read, and the color of the move played
+	   there, if any.  */
+	std::vector<game_state *> m_line;
+	std::vector<unsigned long> m_line_serials;
+	std::vector<stone_color> m_movers;
+	std::unordered_map<const game_state *, size_t> m_line_index;
+	/* For each row of the model, the interned id of the analyzer it showed and one
+	   sample per node of the main line.  */
+	std::vector<int> m_sample_ids;
+	std::vector<std::vector<sample>> m_samples;
+	/* The game_state change serial at the last update.  */
+	unsigned long m_seen_serial = 0;
+	/* Set when the paths must be recomputed even if the samples did not change.  */
+	bool m_layout_dirty = true;
+
+	/* The scene items are created once and only modified afterwards.  */
+	QGraphicsRectItem *m_gradient_item;
+	QGraphicsLineItem *m_mid_item;
+	QGraphicsTextItem *m_type_item;
+	QGraphicsRectItem *m_sel_item;
+	QGraphicsPathItem *m_sd_item;
+	QGraphicsPathItem *m_chg_items[2];
+	std::vector<QGraphicsPathItem *> m_path_items;
+
+	static void read_sample (sample &, const game_state *, int id);
+	bool refresh_samples (go_game_ptr gr);
+	void rebuild_paths ();
+	void move_marker ();
+
 protected:
 	virtual void mouseMoveEvent (QMouseEvent *e) override;
 	virtual void mousePressEvent (QMouseEvent *e) override;
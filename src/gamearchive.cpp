@@ -0,0 +1,316 @@
+/*
+ * gamearchive.cpp
+ */
+
+#include <cstring>
+
+#include <QDebug>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QRunnable>
+#include <QStandardPaths>
+
+#include "gogame.h"
+#include "sgf.h"
+#include "setting.h"
+#include "archivehandler.h"
+#include "ui_helpers.h"
+#include "gamearchive.h"
+
+static const char journal_magic[] = "qgo-journal ";
+
+struct journal_file
+{
+	QFile file;
+	/* Held until the journal is archived, so that recover can tell the journals
+	   of a crashed client from those of another running one.  */
+	std::shared_ptr<QLockFile> lock;
+	QString archive_dir;
+
+	journal_file (const QString &path, const QString &dir)
+		: file (path), lock (std::make_shared<QLockFile> (path + ".lock")), archive_dir (dir)
+	{
+		lock->setStaleLockTime (0);
+	}
+};
+
+class archive_job : public QRunnable
+{
+	std::function<void ()> m_func;
+
+public:
+	archive_job (std::function<void ()> f) : m_func (f)
+	{
+	}
+	void run () override
+	{
+		m_func ();
+	}
+};
+
+GameArchive::GameArchive ()
+{
+	/* One thread, so that the writes to a journal happen in order.  */
+	m_pool.setMaxThreadCount (1);
+	m_pool.setExpiryTimeout (-1);
+
+	QString dir = QStandardPaths::writableLocation (QStandardPaths::AppDataLocation);
+	if (!dir.isEmpty ()) {
+		m_journal_dir = QDir (dir).filePath ("journal");
+		QDir ().mkpath (m_journal_dir);
+	}
+}
+
+GameArchive *GameArchive::instance ()
+{
+	/* Destroyed after the application object, waiting for the last jobs.  */
+	static GameArchive archive;
+	return &archive;
+}
+
+QString GameArchive::archive_dir ()
+{
+	QString dir = setting->readEntry ("ARCHIVE_DIR");
+	if (dir.isEmpty ())
+		dir = setting->readEntry ("LAST_DIR");
+	return dir;
+}
+
+void GameArchive::run (std::function<void ()> f)
+{
+	m_pool.start (new archive_job (f));
+}
+
+/* Replay the journal DATA, read from PATH, into a game record.  Returns null if
+   the journal is broken; sets EMPTY if nothing happened while the game was
+   followed.  Game trees share state with the rest of the program, so this runs on
+   the GUI thread; only the file access is left to the archive thread.  */
+static go_game_ptr journal_to_record (const QByteArray &data, const QString &path, bool &empty)
+{
+	QBuffer f;
+	f.setData (data);
+	f.open (QIODevice::ReadOnly);
+
+	QByteArray first = f.readLine ();
+	if (!first.startsWith (journal_magic)) {
+		qWarning () << "not a game journal: " << path;
+		return nullptr;
+	}
+	QBuffer header;
+	header.setData (f.read (first.mid (strlen (journal_magic)).trimmed ().toInt ()));
+	header.open (QIODevice::ReadOnly);
+
+	go_game_ptr gr;
+	try {
+		sgf *s = load_sgf (header);
+		gr = sgf2record (*s, nullptr);
+		delete s;
+	} catch (...) {
+		qWarning () << "broken game journal: " << path;
+		return nullptr;
+	}
+
+	game_state *st = gr->get_root ();
+	empty = true;
+	while (!f.atEnd ()) {
+		QByteArray line = f.readLine ();
+		/* The last line may have been cut short by a crash.  */
+		if (!line.endsWith ('\n'))
+			break;
+		QList<QByteArray> words = line.trimmed ().split (' ');
+		const QByteArray &what = words[0];
+		if (what == "move" && words.size () == 4) {
+			stone_color col = words[1] == "B" ? black : white;
+			game_state *next = st->add_child_move (words[2].toInt (), words[3].toInt (), col, game_state::add_mode::set_main);
+			if (next != nullptr)
+				st = next;
+		} else if (what == "pass") {
+			st = st->add_child_pass (game_state::add_mode::set_main);
+		} else if (what == "undo") {
+			if (!st->root_node_p ()) {
+				game_state *parent = st->prev_move ();
+				delete st;
+				st = parent;
+			}
+		} else if (what == "handicap" && words.size () == 2) {
+			int h = words[1].toInt ();
+			gr->set_handicap (std::to_string (h));
+			if (gr->replace_root (new_handicap_board (gr->boardsize (), h), h > 1 ? white : black))
+				st = gr->get_root ();
+		} else if (what == "result") {
+			gr->set_result (line.mid (7).trimmed ().toStdString ());
+		} else
+			continue;
+		empty = false;
+	}
+	return gr;
+}
+
+/* Save SGF, the game described by INFO, in ARCHIVE_DIR, then remove the journal at
+   PATH.  An empty SGF only removes the journal.  The journal is kept if the game
+   cannot be saved.  Runs on the archive thread.  */
+static void save_archived (const QString &path, const QString &archive_dir, const QByteArray &sgf, const game_info &info)
+{
+	if (!sgf.isEmpty ()) {
+		QDir ().mkpath (archive_dir);
+		QSaveFile out (get_candidate_filename (archive_dir, info));
+		if (!out.open (QIODevice::WriteOnly)) {
+			qWarning () << "cannot archive game journal " << path << " to " << archive_dir;
+			return;
+		}
+		out.write (sgf);
+		if (!out.commit ())
+			return;
+	}
+	QFile::remove (path);
+}
+
+/* Read the journal at PATH, have the GUI thread turn it into SGF, and save that in
+   ARCHIVE_DIR.  LOCK, which holds the journal, is released when the last of the
+   jobs below is done with it.  Runs on the archive thread.  */
+static void archive_journal (const QString &path, const QString &archive_dir, std::shared_ptr<QLockFile> lock)
+{
+	QFile f (path);
+	if (!f.open (QIODevice::ReadOnly))
+		return;
+	QByteArray data = f.readAll ();
+	f.close ();
+
+	/* When shutting down, the journal is archived on the next start.  */
+	QCoreApplication *app = QCoreApplication::instance ();
+	if (app == nullptr)
+		return;
+	QMetaObject::invokeMethod (app, [path, archive_dir, lock, data] () {
+		bool empty = true;
+		go_game_ptr gr = journal_to_record (data, path, empty);
+		if (gr == nullptr)
+			return;
+		QByteArray sgf;
+		if (!empty)
+			sgf = QByteArray::fromStdString (gr->to_sgf ());
+		game_info info (*gr);
+		GameArchive::instance ()->run ([path, archive_dir, lock, sgf, info] () {
+			save_archived (path, archive_dir, sgf, info);
+		});
+	}, Qt::QueuedConnection);
+}
+
+void GameArchive::recover (const QString &archive_dir)
+{
+	QString dir = m_journal_dir;
+	if (dir.isEmpty ())
+		return;
+	run ([dir, archive_dir] () {
+		QDir d (dir);
+		for (auto &name: d.entryList ({ "*.qgj" }, QDir::Files)) {
+			QString path = d.filePath (name);
+			auto lock = std::make_shared<QLockFile> (path + ".lock");
+			lock->setStaleLockTime (0);
+			if (!lock->tryLock (0))
+				continue;
+			qDebug () << "recovering game journal " << path;
+			archive_journal (path, archive_dir, lock);
+		}
+	});
+}
+
+GameJournal::GameJournal (const game_record &gr, const QString &archive_dir)
+{
+	const QString &dir = GameArchive::instance ()->journal_dir ();
+	if (dir.isEmpty ())
+		return;
+
+	static int count = 0;
+	QString name = QString ("%1-%2.qgj").arg (QDateTime::currentMSecsSinceEpoch ()).arg (count++);
+	m_file = std::make_shared<journal_file> (QDir (dir).filePath (name), archive_dir);
+
+	/* Only the root exists at this point, so this is cheap.  */
+	QByteArray header = QByteArray::fromStdString (gr.to_sgf ());
+	header.prepend (journal_magic + QByteArray::number (header.length ()) + "\n");
+	header.append ('\n');
+
+	std::shared_ptr<journal_file> jf = m_file;
+	GameArchive::instance ()->run ([jf, header] () {
+		jf->lock->tryLock (0);
+		if (!jf->file.open (QIODevice::WriteOnly | QIODevice::Append)) {
+			qWarning () << "cannot open game journal " << jf->file.fileName ();
+			return;
+		}
+		jf->file.write (header);
+		jf->file.flush ();
+	});
+}
+
+/* Close the journal, and archive the game GR, which is what the journal recorded
+   and more: the comments and clock times of the live game are not journaled.
+   Only the SGF text is made here; it is saved on the archive thread.  */
+void GameJournal::archive (game_record &gr)
+{
+	if (m_file == nullptr)
+		return;
+	std::shared_ptr<journal_file> jf = m_file;
+	m_file = nullptr;
+
+	QByteArray sgf;
+	if (gr.get_root ()->n_children () > 0 || !gr.result ().empty ())
+		sgf = QByteArray::fromStdString (gr.to_sgf ());
+	game_info info (gr);
+	GameArchive::instance ()->run ([jf, sgf, info] () {
+		if (!jf->file.isOpen ())
+			return;
+		jf->file.close ();
+		save_archived (jf->file.fileName (), jf->archive_dir, sgf, info);
+	});
+}
+
+/* Close the journal, and archive the game from it, unless archive was called.  */
+GameJournal::~GameJournal ()
+{
+	if (m_file == nullptr)
+		return;
+	std::shared_ptr<journal_file> jf = m_file;
+	GameArchive::instance ()->run ([jf] () {
+		if (!jf->file.isOpen ())
+			return;
+		jf->file.close ();
+		archive_journal (jf->file.fileName (), jf->archive_dir, jf->lock);
+	});
+}
+
+QByteArray GameJournal::move_line (stone_color col, int x, int y)
+{
+	return QByteArray ("move ") + (col == black ? "B " : "W ") + QByteArray::number (x) + " " + QByteArray::number (y) + "\n";
+}
+
+QByteArray GameJournal::pass_line (stone_color col)
+{
+	return col == black ? "pass B\n" : "pass W\n";
+}
+
+void GameJournal::append (const QByteArray &lines)
+{
+	if (m_file == nullptr || lines.isEmpty ())
+		return;
+	std::shared_ptr<journal_file> jf = m_file;
+	GameArchive::instance ()->run ([jf, lines] () {
+		if (!jf->file.isOpen ())
+			return;
+		jf->file.write (lines);
+		jf->file.flush ();
+	});
+}
+
+void GameJournal::set_handicap (int h)
+{
+	append ("handicap " + QByteArray::number (h) + "\n");
+}
+
+void GameJournal::set_result (const std::string &rs)
+{
+	append ("result " + QByteArray::fromStdString (rs) + "\n");
+}
@@ -0,0 +1,72 @@
+/*
+ * gamearchive.h
+ */
+
+#ifndef GAMEARCHIVE_H
+#define GAMEARCHIVE_H
+
+#include <memory>
+#include <functional>
+
+#include <QString>
+#include <QByteArray>
+#include <QThreadPool>
+
+#include "gogame.h"
+
+struct journal_file;
+
+/* Writes the journals of online games and turns them into SGF files.  All file
+   access happens on one thread of its own, in the order it was requested, so
+   that a slow disk never holds up the clocks and boards of the GUI.  The game
+   records themselves are only ever built on the GUI thread.  */
+class GameArchive
+{
+	QThreadPool m_pool;
+	QString m_journal_dir;
+
+	GameArchive ();
+
+public:
+	static GameArchive *instance ();
+
+	/* The directory archived games are saved to.  Reads the settings, so it must
+	   only be called from the GUI thread.  */
+	static QString archive_dir ();
+
+	const QString &journal_dir () const { return m_journal_dir; }
+	void run (std::function<void ()>);
+	/* Archive the journals left behind by a client that did not finish them,
+	   e.g. because it crashed.  */
+	void recover (const QString &archive_dir);
+};
+
+/* The journal of one online game: the SGF of its starting position, followed by
+   one line for each move, pass, undo or handicap change as it arrives from the
+   server.  Each write is handed to the operating system at once, so a crash of
+   the client loses nothing.  When the game is over, archive saves the live game
+   record and removes the journal; a journal deleted without that, or left behind
+   by a crash, is turned into an SGF file in the archive directory itself.  */
+class GameJournal
+{
+	/* Only ever touched by the archive thread.  */
+	std::shared_ptr<journal_file> m_file;
+
+public:
+	GameJournal (const game_record &, const QString &archive_dir);
+	~GameJournal ();
+
+	void archive (game_record &);
+
+	static QByteArray move_line (stone_color, int x, int y);
+	static QByteArray pass_line (stone_color);
+
+	void append (const QByteArray &);
+	void add_move (stone_color col, int x, int y) { append (move_line (col, x, y)); }
+	void add_pass (stone_color col) { append (pass_line (col)); }
+	void add_undo () { append ("undo\n"); }
+	void set_handicap (int);
+	void set_result (const std::string &);
+};
+
+#endif
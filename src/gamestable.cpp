@@ -4,66 +4,206 @@
 
 #include <QHeaderView>
 #include <QMouseEvent>
+#include <QBrush>
 #include "gamestable.h"
 #include "misc.h"
 #include "setting.h"
 
-GamesTable::GamesTable (QWidget *parent)
-	: QTreeWidget(parent)
+static const int n_games_columns = 12;
+
+/*
+ *   GamesTableModel
+ */
+
+void GamesTableModel::fill_row (row &r, const Game &g)
 {
-	setColumnCount (12);
+	r.nr = g.nr.toInt ();
+	r.wname = g.wname;
+	r.bname = g.bname;
+	r.wrank = m_pool.intern (g.wrank);
+	r.brank = m_pool.intern (g.brank);
+	r.mv = m_pool.intern (g.mv);
+	r.Sz = m_pool.intern (g.Sz);
+	r.H = m_pool.intern (g.H);
+	r.K = m_pool.intern (g.K);
+	r.By = m_pool.intern (g.By);
+	r.FR = m_pool.intern (g.FR);
+	r.ob = m_pool.intern (g.ob);
+	r.wrank_key = rkToSortKey (g.wrank);
+	r.brank_key = rkToSortKey (g.brank);
+	r.own_game = g.own_game;
+}
 
-	headers <<  tr ("Id") << tr ("White") << tr ("WR") << tr ("Black") << tr ("BR") << tr ("Mv") << tr ("Sz") << tr ("H") << tr ("K") << tr ("By") << tr ("FR") << tr ("Ob");
-	setHeaderLabels (headers);
-	for (int i = 0; i < 12; i++)
-		header()->setSectionResizeMode(i, QHeaderView::ResizeToContents);
+bool GamesTableModel::find_game (const QString &nr, Game &g) const
+{
+	auto it = m_index.constFind (nr.toInt ());
+	if (it == m_index.constEnd ())
+		return false;
 
-	setFocusPolicy (Qt::NoFocus);
-	setContextMenuPolicy (Qt::CustomContextMenu);
-	setAllColumnsShowFocus(true);
+	const row &r = m_rows[*it];
+	g.nr = nr;
+	g.running = true;
+	g.oneColorGo = false;
+	g.wname = r.wname;
+	g.bname = r.bname;
+	g.wrank = m_pool.str (r.wrank);
+	g.brank = m_pool.str (r.brank);
+	g.mv = m_pool.str (r.mv);
+	g.Sz = m_pool.str (r.Sz);
+	g.H = m_pool.str (r.H);
+	g.K = m_pool.str (r.K);
+	g.By = m_pool.str (r.By);
+	g.FR = m_pool.str (r.FR);
+	g.ob = m_pool.str (r.ob);
+	g.own_game = r.own_game;
+	return true;
+}
 
-	setUniformRowHeights (true);
-	setAlternatingRowColors (true);
-	//setItemMargin(2);
-	sortItems (2, Qt::AscendingOrder);
+// this walks all games, but it is only needed when one of my own games ends
+bool GamesTableModel::find_own_game (const QString &name, Game &g) const
+{
+	for (auto &r: m_rows)
+		if (r.wname == name || r.bname == name)
+			return find_game (QString::number (r.nr), g);
+	return false;
 }
 
-GamesTable::~GamesTable ()
+// let the views know about rows added during a batch
+void GamesTableModel::show_pending ()
 {
+	int n = m_rows.size ();
+	if (n == m_n_shown)
+		return;
+	beginInsertRows (QModelIndex (), m_n_shown, n - 1);
+	m_n_shown = n;
+	endInsertRows ();
 }
 
-void GamesTable::mouseDoubleClickEvent (QMouseEvent *e)
+bool GamesTableModel::set_game (const Game &g)
 {
-	printf ("doubleclick\n");
-	if (e->button () == Qt::LeftButton) {
-		QTreeWidgetItem *item = itemAt (e->pos ());
-		printf ("item %p\n", item);
-		if (item)
-			emit signal_doubleClicked (item);
+	auto it = m_index.constFind (g.nr.toInt ());
+	if (it != m_index.constEnd ()) {
+		int r = *it;
+		fill_row (m_rows[r], g);
+		if (r < m_n_shown)
+			emit dataChanged (index (r, 0), index (r, n_games_columns - 1));
+		return false;
 	}
+
+	row r;
+	fill_row (r, g);
+	m_index.insert (r.nr, m_rows.size ());
+	m_rows.push_back (r);
+	if (!m_batching)
+		show_pending ();
+	return true;
 }
 
-/*
- *   GamesTableItem
- */
+// the last row takes the place of the removed one, so that nothing needs to
+// be renumbered
+bool GamesTableModel::remove_game (const QString &nr)
+{
+	auto it = m_index.find (nr.toInt ());
+	if (it == m_index.end ())
+		return false;
+
+	show_pending ();
+	int r = *it;
+	m_index.erase (it);
+
+	int last = m_rows.size () - 1;
+	if (r != last) {
+		m_rows[r] = m_rows[last];
+		m_index[m_rows[r].nr] = r;
+		emit dataChanged (index (r, 0), index (r, n_games_columns - 1));
+	}
+	beginRemoveRows (QModelIndex (), last, last);
+	m_rows.pop_back ();
+	m_n_shown = last;
+	endRemoveRows ();
+	return true;
+}
+
+void GamesTableModel::clear_games ()
+{
+	beginResetModel ();
+	m_rows.clear ();
+	m_index.clear ();
+	m_pool.clear ();
+	m_n_shown = 0;
+	endResetModel ();
+}
+
+// collect new rows until end_batch instead of inserting them one by one
+void GamesTableModel::begin_batch ()
+{
+	m_batching = true;
+}
+
+void GamesTableModel::end_batch ()
+{
+	m_batching = false;
+	show_pending ();
+}
+
+// own games first, then strongest players first
+static bool player_less (bool own1, int key1, const QString &name1, bool own2, int key2, const QString &name2)
+{
+	if (own1 != own2)
+		return own1;
+	if (key1 != key2)
+		return key1 > key2;
+	return QString::compare (name1, name2, Qt::CaseInsensitive) < 0;
+}
+
+bool GamesTableModel::row_less (int r1, int r2, int column) const
+{
+	const row &a = m_rows[r1];
+	const row &b = m_rows[r2];
 
-GamesTableItem::GamesTableItem (GamesTable *parent, const Game &g)
-	: QTreeWidgetItem(parent), m_game (g)
+	int num1 = 0, num2 = 0;
+	int c = 0;
+	switch (column) {
+	case 0: num1 = a.nr; num2 = b.nr; break;
+	case 1: c = QString::compare (a.wname, b.wname); break;
+	case 3: c = QString::compare (a.bname, b.bname); break;
+	case 4:
+		return player_less (a.own_game, a.brank_key, a.bname, b.own_game, b.brank_key, b.bname);
+	case 5: num1 = m_pool.number (a.mv); num2 = m_pool.number (b.mv); break;
+	case 6: num1 = m_pool.number (a.Sz); num2 = m_pool.number (b.Sz); break;
+	case 7: num1 = m_pool.number (a.H); num2 = m_pool.number (b.H); break;
+	case 8: c = QString::compare (m_pool.str (a.K), m_pool.str (b.K)); break;
+	case 9: num1 = m_pool.number (a.By); num2 = m_pool.number (b.By); break;
+	case 10: c = QString::compare (m_pool.str (a.FR), m_pool.str (b.FR)); break;
+	case 11: num1 = m_pool.number (a.ob); num2 = m_pool.number (b.ob); break;
+	}
+	if (num1 != num2)
+		return num1 < num2;
+	if (c != 0)
+		return c < 0;
+	return player_less (a.own_game, a.wrank_key, a.wname, b.own_game, b.wrank_key, b.wname);
+}
+
+int GamesTableModel::rowCount (const QModelIndex &parent) const
 {
-	ownRepaint ();
+	return parent.isValid () ? 0 : m_n_shown;
 }
 
-GamesTableItem::~GamesTableItem()
+int GamesTableModel::columnCount (const QModelIndex &parent) const
 {
+	return parent.isValid () ? 0 : n_games_columns;
 }
 
-QVariant GamesTableItem::data (int column, int role) const
+QVariant GamesTableModel::data (const QModelIndex &index, int role) const
 {
+	if (!index.isValid () || index.row () >= m_n_shown)
+		return QVariant ();
+
+	const row &r = m_rows[index.row ()];
+	int column = index.column ();
 	if (role == Qt::ForegroundRole) {
-		if (its_me)
+		if (r.own_game)
 			return QBrush (Qt::blue);
-		else if (watched)
-			return QBrush (Qt::red);
 		return QVariant ();
 	} else if (role == Qt::TextAlignmentRole) {
 		return column < 5 && column != 0 ? Qt::AlignLeft : Qt::AlignRight;
@@ -71,56 +211,101 @@ QVariant GamesTableItem::data (int column, int role) const
 	if (role != Qt::DisplayRole)
 		return QVariant ();
 	switch (column) {
-	case 0: return m_game.nr;
-	case 1: return m_game.wname;
-	case 2: return m_game.wrank;
-	case 3: return m_game.bname;
-	case 4: return m_game.brank;
-	case 5: return m_game.mv;
-	case 6: return m_game.Sz;
-	case 7: return m_game.H;
-	case 8: return m_game.K;
-	case 9: return m_game.By;
-	case 10: return m_game.FR;
-	case 11: return m_game.ob;
-	case 12: return m_game.sort_rk_w;
-	case 14: return m_game.sort_rk_b;
+	case 0: return r.nr;
+	case 1: return r.wname;
+	case 2: return m_pool.str (r.wrank);
+	case 3: return r.bname;
+	case 4: return m_pool.str (r.brank);
+	case 5: return m_pool.str (r.mv);
+	case 6: return m_pool.str (r.Sz);
+	case 7: return m_pool.str (r.H);
+	case 8: return m_pool.str (r.K);
+	case 9: return m_pool.str (r.By);
+	case 10: return m_pool.str (r.FR);
+	case 11: return m_pool.str (r.ob);
 	default: return QVariant ();
 	}
 }
 
-void GamesTableItem::ownRepaint()
+QVariant GamesTableModel::headerData (int section, Qt::Orientation orientation, int role) const
 {
-	watched = false;
-	its_me = false;
-	if (!m_game.sort_rk_w.isEmpty ())
-	{
-		its_me = m_game.sort_rk_w.at(0) == 'A';
-#if 0 /* @@@ None of this works?  */
-		if (text(7).isEmpty())
-			watched = false;
-		else
-			watched = text(12).at(text(7).length()-1) == 'W';
-#endif
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QVariant ();
+
+	switch (section) {
+	case 0: return tr ("Id");
+	case 1: return tr ("White");
+	case 2: return tr ("WR");
+	case 3: return tr ("Black");
+	case 4: return tr ("BR");
+	case 5: return tr ("Mv");
+	case 6: return tr ("Sz");
+	case 7: return tr ("H");
+	case 8: return tr ("K");
+	case 9: return tr ("By");
+	case 10: return tr ("FR");
+	case 11: return tr ("Ob");
+	default: return QVariant ();
 	}
 }
 
-bool GamesTableItem::operator<(const QTreeWidgetItem &other) const
+/*
+ *   GamesTableProxy
+ */
+
+GamesTableProxy::GamesTableProxy (GamesTableModel *m, QObject *parent)
+	: QSortFilterProxyModel (parent), m_model (m)
+{
+	setSourceModel (m);
+	setDynamicSortFilter (true);
+}
+
+bool GamesTableProxy::lessThan (const QModelIndex &left, const QModelIndex &right) const
+{
+	return m_model->row_less (left.row (), right.row (), left.column ());
+}
+
+/*
+ *   GamesTable
+ */
+
+GamesTable::GamesTable (QWidget *parent)
+	: QTreeView (parent), m_proxy (&m_model)
 {
-	int column = treeWidget()->sortColumn();
-	int adj_col = column == 2 || column == 4 ? column + 10 : column;
-	const QString t1 = text (adj_col).trimmed ();
-	const QString t2 = other.text (adj_col).trimmed ();
+	setModel (&m_proxy);
+	for (int i = 0; i < n_games_columns; i++)
+		header()->setSectionResizeMode(i, QHeaderView::ResizeToContents);
+
+	setFocusPolicy (Qt::NoFocus);
+	setContextMenuPolicy (Qt::CustomContextMenu);
+	setAllColumnsShowFocus(true);
+
+	setRootIsDecorated (false);
+	setUniformRowHeights (true);
+	setAlternatingRowColors (true);
+	setSortingEnabled (true);
+	sortByColumn (2, Qt::AscendingOrder);
+}
 
-	if (column == 2 || column == 4)
-		return t1 < t2;
+GamesTable::~GamesTable ()
+{
+	// the view must let go of the proxy before the members are destroyed
+	setModel (nullptr);
+}
 
-	const QString r1 = m_game.sort_rk_w;
-	const QString r2 = other.text (12);
+QString GamesTable::game_at (const QPoint &p) const
+{
+	QModelIndex idx = indexAt (p);
+	if (!idx.isValid ())
+		return QString ();
+	return m_model.nr_at (m_proxy.mapToSource (idx).row ());
+}
 
-	if (column == 0 || column == 5 || column == 6 || column == 7 || column == 9 || column == 11) {
-		// id, move, observe, Sz, H, By, Ob
-		return t1.rightJustified (8, '0') + r1 < t2.rightJustified (8, '0') + r2;
-	} else
-		return t1 + r1 < t2 + r2;
+void GamesTable::mouseDoubleClickEvent (QMouseEvent *e)
+{
+	if (e->button () == Qt::LeftButton) {
+		QString nr = game_at (e->pos ());
+		if (!nr.isNull ())
+			emit signal_doubleClicked (nr);
+	}
 }
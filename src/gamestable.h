@@ -5,16 +5,22 @@
 #ifndef GAMESTABLE_H
 #define GAMESTABLE_H
 
+#include "misc.h"
+
+#include <vector>
+
 #include <QVariant>
-#include <QDialog>
-#include <QTreeWidget>
+#include <QTreeView>
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QHash>
 
 class Game
 {
 public:
 	Game() {};
 	~Game() {};
-	// #> [##] white name [ rk ] black name [ rk ] (Move size H Komi BY FR) (###) 
+	// #> [##] white name [ rk ] black name [ rk ] (Move size H Komi BY FR) (###)
 	QString nr;
 	QString	wname;
 	QString	wrank;
@@ -28,22 +34,95 @@ public:
 	QString By;
 	QString FR;
 	QString ob;
-	QString sort_rk_w, sort_rk_b;
 	bool running;
 	bool oneColorGo;
+	// one of the players is me; such games are listed first
+	bool own_game = false;
+};
+
+// the games known to the client, one compact row per game
+class GamesTableModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+	struct row
+	{
+		QString wname, bname;
+		int nr;
+		int wrank, brank, mv, Sz, H, K, By, FR, ob;
+		// computed once from the ranks, see rkToSortKey
+		int wrank_key, brank_key;
+		bool own_game;
+	};
+
+	string_pool m_pool;
+	std::vector<row> m_rows;
+	// row numbers by game number
+	QHash<int, int> m_index;
+	// rows beyond this one were added during a batch and are not yet known to views
+	int m_n_shown = 0;
+	bool m_batching = false;
+
+	void fill_row (row &, const Game &);
+	void show_pending ();
+
+public:
+	GamesTableModel (QObject *parent = 0) : QAbstractTableModel (parent) { }
+
+	bool find_game (const QString &nr, Game &) const;
+	bool find_own_game (const QString &name, Game &) const;
+	bool contains (const QString &nr) const { return m_index.contains (nr.toInt ()); }
+	bool set_game (const Game &);
+	bool remove_game (const QString &nr);
+	void clear_games ();
+	void begin_batch ();
+	void end_batch ();
+
+	QString nr_at (int r) const { return QString::number (m_rows[r].nr); }
+	bool row_less (int r1, int r2, int column) const;
+
+	virtual int rowCount (const QModelIndex &parent = QModelIndex ()) const override;
+	virtual int columnCount (const QModelIndex &parent = QModelIndex ()) const override;
+	virtual QVariant data (const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	virtual QVariant headerData (int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+};
+
+// sorts with the precomputed keys of the model
+class GamesTableProxy : public QSortFilterProxyModel
+{
+	GamesTableModel *m_model;
+
+public:
+	GamesTableProxy (GamesTableModel *m, QObject *parent = 0);
+
+protected:
+	virtual bool lessThan (const QModelIndex &left, const QModelIndex &right) const override;
 };
 
-class GamesTable : public QTreeWidget
+class GamesTable : public QTreeView
 {
 	Q_OBJECT
-	QStringList headers;
+
+	GamesTableModel m_model;
+	GamesTableProxy m_proxy;
 
 public:
 	GamesTable(QWidget* parent = 0);
 	~GamesTable();
-	void set_watch(QString);
-	void set_mark(QString);
 
+	bool find_game (const QString &nr, Game &g) const { return m_model.find_game (nr, g); }
+	// the first game NAME plays in
+	bool find_own_game (const QString &name, Game &g) const { return m_model.find_own_game (name, g); }
+	bool contains (const QString &nr) const { return m_model.contains (nr); }
+	// add a new game, or replace the entry of a known one; returns true if it was new
+	bool set_game (const Game &g) { return m_model.set_game (g); }
+	bool remove_game (const QString &nr) { return m_model.remove_game (nr); }
+	void clear_games () { m_model.clear_games (); }
+	void begin_batch () { m_model.begin_batch (); }
+	void end_batch () { m_model.end_batch (); }
+
+	// number of the game shown at point P, or a null string
+	QString game_at (const QPoint &p) const;
 
 	void resize_columns ()
 	{
@@ -60,35 +139,7 @@ public slots:
 	virtual void slot_mouse_games(const QPoint&) {};
 
  signals:
-	void signal_doubleClicked (QTreeWidgetItem *);
-};
-
-class GamesTableItem : public QTreeWidgetItem
-{
-	Game m_game;
-public:
-	GamesTableItem(GamesTable *parent, const Game &g);
-	~GamesTableItem();
-	Game get_game () { return m_game; }
-	void update_game (const Game &g) { m_game = g; ownRepaint (); emitDataChanged (); }
-	void ownRepaint();
-	virtual bool operator< (const QTreeWidgetItem &other) const override;
-	virtual QVariant data (int column, int role) const override;
- private:
-	void set_foreground (const QColor &col)
-	{
-		QBrush b (col);
-		for (int i = 0; i < columnCount (); i++)
-			setForeground (i, b);
-	}
-
-protected:
-#if 0
-	virtual void paintCell(QPainter *p, const QColorGroup &cg, int column, int width, int alignment);
-#endif
-
-	bool watched;
-	bool its_me;
+	void signal_doubleClicked (const QString &);
 };
 
 #endif // GAMESTABLE_H
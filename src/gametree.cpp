@@ -2,7 +2,10 @@
 * gametree.cpp
 */
 
+#include <cmath>
+
 #include <QHelpEvent>
+#include <QStyleOptionGraphicsItem>
 
 #include "config.h"
 #include "setting.h"
@@ -31,40 +34,239 @@ static QByteArray box_svg =
 	"     d=\"M 35.2,14 44.8,11 124.8,36 115.2,35 Z\" />"
 	"</svg>";
 
-class ClickablePixmap : public QGraphicsPixmapItem
+/* The game tree is drawn by two items covering the whole scene, one for the lines
+   connecting the nodes and one for the nodes themselves, with the active path drawn
+   between them.  They paint only the part of the tree that is exposed, straight
+   from the visualization data.  Trees with tens of thousands of nodes, as produced
+   by analysis with long variations, would otherwise need as many graphics items.  */
+class TreeLayer : public QGraphicsItem
 {
+protected:
 	GameTree *m_view;
-	int m_x, m_y, m_size;
+	int m_w = 0, m_h = 0;
+
+	/* Find the range of rows and columns covered by RECT.  */
+	void cell_range (const QRectF &rect, int &x0, int &y0, int &x1, int &y1)
+	{
+		int size = m_view->m_size;
+		x0 = std::max (0, (int)floor (rect.left () / size));
+		y0 = std::max (0, (int)floor (rect.top () / size));
+		x1 = std::min (m_w - 1, (int)floor (rect.right () / size));
+		y1 = std::min (m_h - 1, (int)floor (rect.bottom () / size));
+	}
+	/* Called with the new dimensions before changing the data.  Returns true if
+	   the geometry is unchanged, so that only the parts that differ need to be
+	   repainted.  FULL is true if the node size may have changed.  */
+	bool resize (int w, int h, bool full)
+	{
+		if (w == m_w && h == m_h && !full)
+			return true;
+		prepareGeometryChange ();
+		m_w = w;
+		m_h = h;
+		return false;
+	}
+	void update_rows (int y0, int y1)
+	{
+		int size = m_view->m_size;
+		update (QRectF (0, y0 * size, m_w * size, (y1 - y0 + 1) * size));
+	}
+
 public:
-	ClickablePixmap (GameTree *view, QGraphicsScene *scene, int x, int y, int size, const QPixmap &pm)
-		: QGraphicsPixmapItem (pm), m_view (view), m_x (x), m_y (y), m_size (size)
+	TreeLayer (GameTree *view) : m_view (view)
+	{
+		setFlag (QGraphicsItem::ItemUsesExtendedStyleOption);
+	}
+	virtual QRectF boundingRect () const override
+	{
+		return QRectF (0, 0, m_w * m_view->m_size, m_h * m_view->m_size);
+	}
+};
+
+class TreeLines : public TreeLayer
+{
+	struct line
+	{
+		int x0, y0, x1, y1;
+		bool dotted;
+		/* The first row the line touches.  */
+		int row;
+		bool operator== (const line &other) const
+		{
+			return (x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1
+				&& dotted == other.dotted);
+		}
+	};
+	/* Each line is stored in all rows it touches.  */
+	std::vector<std::vector<line>> m_rows;
+
+public:
+	TreeLines (GameTree *view) : TreeLayer (view)
+	{
+		setAcceptedMouseButtons (Qt::NoButton);
+	}
+	void set_tree (game_state *root, int w, int h, bool full);
+	virtual void paint (QPainter *, const QStyleOptionGraphicsItem *, QWidget *) override;
+};
+
+void TreeLines::set_tree (game_state *root, int w, int h, bool full)
+{
+	int size = m_view->m_size;
+	std::vector<std::vector<line>> rows (h);
+	auto add_line = [&] (int x0, int y0, int x1, int y1, bool dotted) -> void
+		{
+			int r0 = std::max (0, std::min (y0, y1) / size);
+			int r1 = std::min (h - 1, std::max (y0, y1) / size);
+			for (int r = r0; r <= r1; r++)
+				rows[r].push_back (line { x0, y0, x1, y1, dotted, r0 });
+		};
+	root->render_visualization (size / 2, size / 2, size, add_line, true);
+
+	bool same_size = resize (w, h, full);
+	std::swap (m_rows, rows);
+	if (!same_size) {
+		update ();
+		return;
+	}
+	for (int y = 0; y < h; y++)
+		if (m_rows[y] != rows[y])
+			update_rows (y, y);
+}
+
+void TreeLines::paint (QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
+{
+	int x0, y0, x1, y1;
+	cell_range (option->exposedRect, x0, y0, x1, y1);
+
+	QPen pen;
+	pen.setWidth (2);
+	QPen dotted_pen = pen;
+	dotted_pen.setStyle (Qt::DotLine);
+	for (int y = y0; y <= y1; y++)
+		for (auto &l: m_rows[y]) {
+			/* Paint lines spanning several rows only once.  */
+			if (y != std::max (l.row, y0))
+				continue;
+			painter->setPen (l.dotted ? dotted_pen : pen);
+			painter->drawLine (l.x0, l.y0, l.x1, l.y1);
+		}
+}
+
+class TreeNodes : public TreeLayer
+{
+	/* The same data as produced by game_state::extract_visualization.  */
+	visual_tree::bit_rect m_stones_w { 0, 0 }, m_stones_b { 0, 0 };
+	visual_tree::bit_rect m_edits { 0, 0 }, m_collapsed { 0, 0 };
+	visual_tree::bit_rect m_figures { 0, 0 }, m_hidden_figs { 0, 0 };
+
+	bool find_node (const QPointF &pos, int &x, int &y)
+	{
+		int size = m_view->m_size;
+		x = floor (pos.x () / size);
+		y = floor (pos.y () / size);
+		if (x < 0 || y < 0 || x >= m_w || y >= m_h)
+			return false;
+		return (m_stones_w.test_bit (x, y) || m_stones_b.test_bit (x, y)
+			|| m_edits.test_bit (x, y) || m_collapsed.test_bit (x, y));
+	}
+
+public:
+	TreeNodes (GameTree *view) : TreeLayer (view)
 	{
 		setZValue (10);
-		/* Supposedly faster, and makes it easier to click on edit nodes.  */
-		setShapeMode (QGraphicsPixmapItem::BoundingRectShape);
-		scene->addItem (this);
 		setAcceptHoverEvents (true);
 	}
+	void set_tree (game_state *root, int w, int h, bool full);
+	virtual void paint (QPainter *, const QStyleOptionGraphicsItem *, QWidget *) override;
+
 protected:
 	virtual void mousePressEvent (QGraphicsSceneMouseEvent *e) override;
-	virtual void hoverEnterEvent (QGraphicsSceneHoverEvent *e) override;
+	virtual void hoverMoveEvent (QGraphicsSceneHoverEvent *e) override;
 	virtual void hoverLeaveEvent (QGraphicsSceneHoverEvent *e) override;
 	virtual void contextMenuEvent (QGraphicsSceneContextMenuEvent *e) override;
 };
 
-void ClickablePixmap::contextMenuEvent (QGraphicsSceneContextMenuEvent *e)
+void TreeNodes::set_tree (game_state *root, int w, int h, bool full)
+{
+	visual_tree::bit_rect stones_w (w, h);
+	visual_tree::bit_rect stones_b (w, h);
+	visual_tree::bit_rect edits (w, h);
+	visual_tree::bit_rect collapsed (w, h);
+	visual_tree::bit_rect figures (w, h);
+	visual_tree::bit_rect hidden_figs (w, h);
+
+	root->extract_visualization (0, 0, stones_w, stones_b, edits, collapsed, figures, hidden_figs);
+
+	bool same_size = resize (w, h, full);
+	std::swap (m_stones_w, stones_w);
+	std::swap (m_stones_b, stones_b);
+	std::swap (m_edits, edits);
+	std::swap (m_collapsed, collapsed);
+	std::swap (m_figures, figures);
+	std::swap (m_hidden_figs, hidden_figs);
+	if (!same_size) {
+		update ();
+		return;
+	}
+	/* Only repaint the rows that changed; when a move is added, that is usually
+	   just one.  */
+	for (int y = 0; y < h; y++)
+		if (m_stones_w.m_rep[y] != stones_w.m_rep[y] || m_stones_b.m_rep[y] != stones_b.m_rep[y]
+		    || m_edits.m_rep[y] != edits.m_rep[y] || m_collapsed.m_rep[y] != collapsed.m_rep[y]
+		    || m_figures.m_rep[y] != figures.m_rep[y] || m_hidden_figs.m_rep[y] != hidden_figs.m_rep[y])
+			update_rows (y, y);
+}
+
+void TreeNodes::paint (QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
 {
-	QPointF pos = e->pos ();
-	int x = m_x + pos.x () / m_size;
-	int y = m_y;
+	int x0, y0, x1, y1;
+	cell_range (option->exposedRect, x0, y0, x1, y1);
+
+	int size = m_view->m_size;
+	QPen diag_pen (Qt::blue);
+	diag_pen.setWidth (2);
+	painter->setBrush (Qt::NoBrush);
+	for (int y = y0; y <= y1; y++)
+		for (int x = x0; x <= x1; x++) {
+			const QPixmap *src;
+			bool fig = m_figures.test_bit (x, y);
+			if (m_edits.test_bit (x, y))
+				src = &m_view->m_pm_e;
+			else if (m_stones_w.test_bit (x, y))
+				src = fig ? &m_view->m_pm_wfig : &m_view->m_pm_w;
+			else if (m_stones_b.test_bit (x, y))
+				src = fig ? &m_view->m_pm_bfig : &m_view->m_pm_b;
+			else if (m_collapsed.test_bit (x, y))
+				src = &m_view->m_pm_box;
+			else
+				continue;
+			painter->drawPixmap (x * size + 1, y * size + 1, *src);
+			if (m_hidden_figs.test_bit (x, y)) {
+				painter->setPen (diag_pen);
+				painter->drawRect (x * size + size / 2 + 2, y * size + 2,
+						   size / 2 - 4, size / 2 - 4);
+			}
+		}
+}
+
+void TreeNodes::contextMenuEvent (QGraphicsSceneContextMenuEvent *e)
+{
+	int x, y;
+	if (!find_node (e->pos (), x, y)) {
+		e->ignore ();
+		return;
+	}
 	m_view->show_menu (x, y, e->screenPos ());
 }
 
-void ClickablePixmap::mousePressEvent (QGraphicsSceneMouseEvent *e)
+void TreeNodes::mousePressEvent (QGraphicsSceneMouseEvent *e)
 {
-	QPointF pos = e->pos ();
-	int x = m_x + pos.x () / m_size;
-	int y = m_y;
+	int x, y;
+	/* Let the view handle it, so that empty areas can be used to drag.  */
+	if (!find_node (e->pos (), x, y)) {
+		e->ignore ();
+		return;
+	}
 	if (e->button () == Qt::LeftButton) {
 		if (e->modifiers () == Qt::ShiftModifier)
 			m_view->toggle_collapse (x, y, false);
@@ -76,12 +278,13 @@ void ClickablePixmap::mousePressEvent (QGraphicsSceneMouseEvent *e)
 		m_view->toggle_collapse (x, y, false);
 }
 
-void ClickablePixmap::hoverEnterEvent (QGraphicsSceneHoverEvent *)
+void TreeNodes::hoverMoveEvent (QGraphicsSceneHoverEvent *e)
 {
-	m_view->setDragMode (QGraphicsView::NoDrag);
+	int x, y;
+	m_view->setDragMode (find_node (e->pos (), x, y) ? QGraphicsView::NoDrag : QGraphicsView::ScrollHandDrag);
 }
 
-void ClickablePixmap::hoverLeaveEvent (QGraphicsSceneHoverEvent *)
+void TreeNodes::hoverLeaveEvent (QGraphicsSceneHoverEvent *)
 {
 	m_view->setDragMode (QGraphicsView::ScrollHandDrag);
 }
@@ -102,6 +305,11 @@ GameTree::GameTree (QWidget *parent)
 			"Shift-click or middle-click nodes to collapse or expand their sub-variations.\n"
 			"Control-click a collapsed node to expand one level of its children."));
 
+	m_lines = new TreeLines (this);
+	m_nodes = new TreeNodes (this);
+	m_scene->addItem (m_lines);
+	m_scene->addItem (m_nodes);
+
 	update_prefs ();
 
 	m_previewer = new FigureView;
@@ -273,79 +481,19 @@ void GameTree::update (go_game_ptr gr, game_state *active, bool force)
 	if (!changed && !active_changed)
 		return;
 	m_game = gr;
+	const visual_tree &vroot = r->visualization ();
+	int w = vroot.width ();
+	int h = vroot.height ();
 	if (changed) {
-		const visual_tree &vroot = r->visualization ();
-		int w = vroot.width ();
-		int h = vroot.height ();
-
 		m_scene->setSceneRect (0, 0, m_size * w, m_size * h);
 
-		m_scene->clear ();
-		m_sel = nullptr;
-		m_path = nullptr;
-		m_path_end = nullptr;
-
 		setDragMode (QGraphicsView::ScrollHandDrag);
 
-		visual_tree::bit_rect stones_w (w, h);
-		visual_tree::bit_rect stones_b (w, h);
-		visual_tree::bit_rect edits (w, h);
-		visual_tree::bit_rect collapsed (w, h);
-		visual_tree::bit_rect figures (w, h);
-		visual_tree::bit_rect hidden_figs (w, h);
-
-		r->extract_visualization (0, 0, stones_w, stones_b, edits, collapsed, figures, hidden_figs);
-		visual_tree::bit_rect all_items = stones_w;
-		all_items.ior (stones_b, 0, 0);
-		all_items.ior (edits, 0, 0);
-		all_items.ior (collapsed, 0, 0);
-
-		QPen diag_pen (Qt::blue);
-		diag_pen.setWidth (2);
-		for (int y = 0; y < h; y++)
-			for (int x0 = 0; x0 < w; ) {
-				int len = 1;
-				if (all_items.test_bit (x0, y)) {
-					while (x0 + len < w && all_items.test_bit (x0 + len, y))
-						len++;
-					QPixmap combined (m_size * len, m_size);
-					combined.fill (QColor (0, 0, 0, 0));
-					QPainter painter;
-					painter.begin (&combined);
-					painter.setPen (Qt::NoPen);
-					for (int i = 0; i < len; i++) {
-						QPixmap *src = &m_pm_box;
-						bool fig = figures.test_bit (x0 + i, y);
-						if (edits.test_bit (x0 + i, y))
-							src =  &m_pm_e;
-						else if (stones_w.test_bit (x0 + i, y))
-							src = fig ? &m_pm_wfig : &m_pm_w;
-						else if (stones_b.test_bit (x0 + i, y))
-							src = fig ? &m_pm_bfig : &m_pm_b;
-						painter.drawPixmap (i * m_size + 1, 1, *src);
-						if (hidden_figs.test_bit (x0 + i, y)) {
-							painter.setPen (diag_pen);
-							painter.drawRect (i * m_size + m_size / 2 + 2, 2,
-									  m_size / 2 - 4, m_size / 2 - 4);
-							painter.setPen (Qt::NoPen);
-						}
-					}
-					painter.end ();
-					QGraphicsPixmapItem *pm = new ClickablePixmap (this, m_scene, x0, y, m_size, combined);
-					pm->setPos (x0 * m_size, y * m_size);
-				}
-				x0 += len;
-			}
-		auto line = [&] (int x0, int y0, int x1, int y1, bool dotted) -> void
-			{
-				QPen pen;
-				pen.setWidth (2);
-				if (dotted)
-					pen.setStyle (Qt::DotLine);
-				QLineF line (x0, y0, x1, y1);
-				m_scene->addLine (line, pen);
-			};
-		r->render_visualization (m_size / 2, m_size / 2, m_size, line, true);
+		m_lines->set_tree (r, w, h, force);
+		m_nodes->set_tree (r, w, h, force);
+	}
+	if (changed && (w != m_header_width || force)) {
+		m_header_width = w;
 		m_header_scene->clear ();
 		m_header_scene->setSceneRect (0, 0, m_size * w, m_header_scene->height ());
 		m_header_view->setSceneRect (0, 0, m_size * w, m_header_scene->height ());
@@ -405,7 +553,6 @@ void GameTree::update (go_game_ptr gr, game_state *active, bool force)
 			ensureVisible (m_sel, m_size / 2, m_size / 2);
 	} else
 		m_sel->hide ();
-	m_scene->update ();
 }
 
 bool GameTree::event (QEvent *e)
@@ -16,11 +16,17 @@ class game_record;
 typedef std::shared_ptr<game_record> go_game_ptr;
 class MainWindow;
 class FigureView;
+class TreeLines;
+class TreeNodes;
 
 class GameTree : public QGraphicsView
 {
 	Q_OBJECT
 
+	friend class TreeLayer;
+	friend class TreeLines;
+	friend class TreeNodes;
+
 	MainWindow *m_win {};
 	/* We used to use a QHeaderView.  That didn't work terribly well for a
 	   variety of reasons, the main one being that on Windows, the cells had a
@@ -39,6 +45,11 @@ class GameTree : public QGraphicsView
 	game_state *m_active {};
 	QGraphicsScene *m_scene;
 	QGraphicsScene *m_header_scene;
+	/* The number of columns shown in the header.  */
+	int m_header_width = -1;
+	/* Scene items painting the tree; owned by the scene.  */
+	TreeLines *m_lines;
+	TreeNodes *m_nodes;
 	QGraphicsRectItem *m_sel {};
 	QGraphicsPathItem *m_path {};
 	QGraphicsLineItem *m_path_end {};
@@ -374,6 +374,34 @@ go_score go_board::get_scores () const
 	return sc;
 }
 
+/* Describe the stones on the board as a string, using the orientation that sorts
+   first among all symmetries of the board.  The symmetry that was chosen is stored
+   in SYM, for use with transform_coords.  Non-square and toroidal boards only have
+   the identity.  */
+std::string go_board::canonical_position (int &sym) const
+{
+	int n_syms = m_sz_x == m_sz_y && !m_torus_h && !m_torus_v ? 8 : 1;
+	std::string best;
+	sym = 0;
+	for (int s = 0; s < n_syms; s++) {
+		std::string str (bitsize (), '.');
+		for (int x = 0; x < m_sz_x; x++)
+			for (int y = 0; y < m_sz_y; y++) {
+				stone_color c = stone_at (x, y);
+				if (c == none)
+					continue;
+				int tx = x, ty = y;
+				transform_coords (s, m_sz_x, tx, ty);
+				str[bitpos (tx, ty)] = c == black ? 'X' : 'O';
+			}
+		if (s == 0 || str < best) {
+			best = str;
+			sym = s;
+		}
+	}
+	return best;
+}
+
 /* Called when loading an SGF and encountering a position with territory markers.
    Update our captures and territory so that the correct result can be shown.  */
 void go_board::territory_from_markers ()
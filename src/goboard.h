@@ -381,6 +381,7 @@ public:
 		return *m_stones_w;
 	}
 	go_score get_scores () const;
+	std::string canonical_position (int &sym) const;
 	void territory_from_markers ();
 	void append_marks_sgf (std::string &) const;
 
@@ -472,6 +473,28 @@ struct board_rect
 	bool is_square () { return width () == height (); }
 };
 
+/* The eight symmetries of a square board of size SIZE, numbered 0 to 7.  Bit 2 of SYM
+   transposes the board, bits 0 and 1 then mirror it horizontally and vertically.  */
+inline void transform_coords (int sym, int size, int &x, int &y)
+{
+	if (sym & 4)
+		std::swap (x, y);
+	if (sym & 1)
+		x = size - 1 - x;
+	if (sym & 2)
+		y = size - 1 - y;
+}
+
+inline void inverse_transform_coords (int sym, int size, int &x, int &y)
+{
+	if (sym & 2)
+		y = size - 1 - y;
+	if (sym & 1)
+		x = size - 1 - x;
+	if (sym & 4)
+		std::swap (x, y);
+}
+
 /* Some functions to create unique bit sets of particular shapes.  These are the
    ones required elsewhere, the others are private to goboard.cc.  */
 extern const bit_array *create_row_top (int w, int h);
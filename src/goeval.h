@@ -1,6 +1,8 @@
 #ifndef GOEVAL_H
 #define GOEVAL_H
 
+#include <string>
+
 struct analyzer_id {
 	std::string engine;
 	double komi = 0;
@@ -25,4 +27,37 @@ struct eval {
 	analyzer_id id;
 };
 
+/* Analyzer ids are interned into a process-wide table, so that evaluations stored
+   in game trees can refer to them by a small index and be compared as integers.
+   References returned by interned_analyzer_id remain valid.  */
+int intern_analyzer_id (const analyzer_id &);
+/* Returns -1 if the id was never interned.  */
+int find_analyzer_id (const analyzer_id &);
+const analyzer_id &interned_analyzer_id (int);
+
+/* The compact form in which evaluations are stored in game trees.  */
+struct eval_record {
+	int id;
+	int visits;
+	double score_mean;
+	double score_stddev;
+	double wr_black;
+
+	explicit eval_record (const eval &ev)
+		: id (intern_analyzer_id (ev.id)), visits (ev.visits), score_mean (ev.score_mean),
+		  score_stddev (ev.score_stddev), wr_black (ev.wr_black)
+	{
+	}
+	eval to_eval () const
+	{
+		eval ev;
+		ev.visits = visits;
+		ev.score_mean = score_mean;
+		ev.score_stddev = score_stddev;
+		ev.wr_black = wr_black;
+		ev.id = interned_analyzer_id (id);
+		return ev;
+	}
+};
+
 #endif
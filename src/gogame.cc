@@ -1,3 +1,8 @@
+#include <map>
+#include <algorithm>
+#include <deque>
+#include <tuple>
+
 #include "goboard.h"
 #include "gogame.h"
 #include "svgbuilder.h"
@@ -29,31 +34,84 @@ const go_board game_state::child_moves (const game_state *excluding, bool exclud
 	return b;
 }
 
+visual_tree::visual_tree (bool collapsed)
+	: m_w (collapsed ? 2 : 1), m_h (1)
+{
+	std::shared_ptr<column> c = std::make_shared<column> ();
+	c->top = c->bottom = 0;
+	c->next_off = 0;
+	if (collapsed) {
+		std::shared_ptr<column> box = std::make_shared<column> (*c);
+		c->next = box;
+	}
+	m_cols = c;
+}
+
 visual_tree::visual_tree (visual_tree &main_var, int max_child_width)
-	: m_rep (1 + max_child_width, main_var.height ())
+	: m_w (1 + max_child_width), m_h (main_var.height ())
 {
-	m_rep.ior (main_var.m_rep, 1, 0);
 	main_var.m_off_y = 0;
-	m_rep.set_bit (0, 0);
+	std::shared_ptr<column> c = std::make_shared<column> ();
+	c->top = c->bottom = 0;
+	c->next_off = 0;
+	c->next = main_var.m_cols;
+	m_cols = c;
 }
 
 void visual_tree::add_variation (visual_tree &other)
 {
-	m_rep.set_max_width (other.width () + 1);
-
-	/* Find the highest offset that does not cause overlap.  */
-	int i = height ();
-	while (i-- > 0)
-		if (m_rep.test_overlap (other.m_rep, 1, i))
-			break;
+	/* Find the highest offset that does not cause overlap.  Since the variation
+	   has to go below everything it would overlap with, this only depends on the
+	   last occupied row of our columns and the first one of the variation's.  */
+	int i = -1;
+	const column *a = m_cols->next.get ();
+	int abase = m_cols->next_off;
+	const column *b = other.m_cols.get ();
+	int bbase = 0;
+	while (a != nullptr && b != nullptr) {
+		i = std::max (i, abase + a->bottom - (bbase + b->top));
+		abase += a->next_off;
+		a = a->next.get ();
+		bbase += b->next_off;
+		b = b->next.get ();
+	}
 
 	other.m_off_y = i + 1;
-	m_rep.set_max_height (std::max (height (), other.m_off_y + other.height ()));
-	m_rep.ior (other.m_rep, 1, other.m_off_y);
-
-	/* Show conflicts for the connecting lines as well.  */
-	for (int y = 1; y < other.m_off_y; y++)
-		m_rep.set_bit (0, y);
+	m_w = std::max (m_w, other.width () + 1);
+	m_h = std::max (m_h, other.m_off_y + other.height ());
+
+	/* Build the merged outline.  The first column also has to show conflicts for
+	   the connecting line.  New columns, whose rows are relative to our first one,
+	   are needed only where both trees have columns; after that, the tail of the
+	   longer one is shared.  */
+	std::vector<column> merged;
+	merged.push_back (*m_cols);
+	merged[0].bottom = std::max (merged[0].bottom, other.m_off_y - 1);
+
+	std::shared_ptr<const column> a_ptr = m_cols->next;
+	abase = m_cols->next_off;
+	std::shared_ptr<const column> b_ptr = other.m_cols;
+	bbase = other.m_off_y;
+	while (a_ptr != nullptr && b_ptr != nullptr) {
+		column c;
+		c.top = std::min (abase + a_ptr->top, bbase + b_ptr->top);
+		c.bottom = std::max (abase + a_ptr->bottom, bbase + b_ptr->bottom);
+		merged.push_back (c);
+		abase += a_ptr->next_off;
+		a_ptr = a_ptr->next;
+		bbase += b_ptr->next_off;
+		b_ptr = b_ptr->next;
+	}
+	std::shared_ptr<const column> tail = a_ptr != nullptr ? a_ptr : b_ptr;
+	int tail_base = a_ptr != nullptr ? abase : bbase;
+	for (size_t k = merged.size (); k-- > 0;) {
+		std::shared_ptr<column> c = std::make_shared<column> (merged[k]);
+		c->next = tail;
+		c->next_off = tail_base;
+		tail = c;
+		tail_base = 0;
+	}
+	m_cols = tail;
 }
 
 bool game_state::update_visualization (bool hide_figures)
@@ -61,7 +119,9 @@ bool game_state::update_visualization (bool hide_figures)
 	bool changes = false;
 	int max_width = 1;
 	for (auto &it: m_children) {
-		changes |= it->update_visualization (hide_figures);
+		/* Subtrees in which nothing is out of date can be skipped.  */
+		if (!it->m_visual_ok || it->m_visual_dirty_below || it->m_visual_hide_figs != hide_figures)
+			changes |= it->update_visualization (hide_figures);
 		bool show = it == m_children[0] || !it->has_figure () || !hide_figures;
 		changes |= show != it->m_visual_shown;
 		it->m_visual_shown = show;
@@ -69,6 +129,8 @@ bool game_state::update_visualization (bool hide_figures)
 			max_width = std::max (max_width, it->m_visualized.width ());
 	}
 
+	m_visual_dirty_below = false;
+	m_visual_hide_figs = hide_figures;
 	if (!changes && m_visual_ok)
 		return false;
 	if (m_children.size () == 0 || m_visual_collapse) {
@@ -308,16 +370,84 @@ bool game_state::has_figure_recursive () const
 	return false;
 }
 
-void game_state::update_eval (const eval &ev)
+/* The komi is only part of an analyzer's identity if it was set.  */
+typedef std::tuple<std::string, bool, double> analyzer_key;
+
+static analyzer_key key_for (const analyzer_id &id)
+{
+	return analyzer_key (id.engine, id.komi_set, id.komi_set ? id.komi : 0);
+}
+
+static std::map<analyzer_key, int> analyzer_index;
+/* A deque, so that references to its elements stay valid as it grows.  */
+static std::deque<analyzer_id> analyzer_ids;
+
+int intern_analyzer_id (const analyzer_id &id)
+{
+	auto result = analyzer_index.emplace (key_for (id), (int)analyzer_ids.size ());
+	if (result.second)
+		analyzer_ids.push_back (id);
+	return result.first->second;
+}
+
+int find_analyzer_id (const analyzer_id &id)
+{
+	auto it = analyzer_index.find (key_for (id));
+	return it == analyzer_index.end () ? -1 : it->second;
+}
+
+const analyzer_id &interned_analyzer_id (int idx)
+{
+	return analyzer_ids[idx];
+}
+
+unsigned long game_state::s_change_serial = 0;
+unsigned long game_state::s_shape_serial = 0;
+std::vector<std::pair<unsigned long, const game_state *>> game_state::s_eval_log;
+unsigned long game_state::s_eval_log_dropped = 0;
+
+static const size_t eval_log_max = 4096;
+
+void game_state::note_eval_change ()
+{
+	m_evals_serial = ++s_change_serial;
+	if (s_eval_log.size () >= eval_log_max) {
+		auto keep = s_eval_log.begin () + eval_log_max / 2;
+		s_eval_log_dropped = (keep - 1)->first;
+		s_eval_log.erase (s_eval_log.begin (), keep);
+	}
+	s_eval_log.emplace_back (m_evals_serial, this);
+}
+
+bool game_state::evals_changed_since (unsigned long serial, const std::function<void (const game_state *)> &f)
+{
+	if (serial < s_eval_log_dropped)
+		return false;
+	auto it = std::upper_bound (s_eval_log.begin (), s_eval_log.end (), serial,
+				    [] (unsigned long s, const std::pair<unsigned long, const game_state *> &e) { return s < e.first; });
+	for (; it != s_eval_log.end (); ++it)
+		f (it->second);
+	return true;
+}
+
+void game_state::update_eval (const eval_record &ev)
 {
 	for (auto &ours: m_evals) {
 		if (ev.id == ours.id) {
-			if (ev.visits > ours.visits)
+			if (ev.visits > ours.visits) {
 				ours = ev;
+				note_eval_change ();
+			}
 			return;
 		}
 	}
 	m_evals.push_back (ev);
+	note_eval_change ();
+}
+
+void game_state::update_eval (const eval &ev)
+{
+	update_eval (eval_record (ev));
 }
 
 void game_state::update_eval (const game_state &other)
@@ -328,19 +458,26 @@ void game_state::update_eval (const game_state &other)
 
 eval game_state::best_eval ()
 {
-	eval best;
+	const eval_record *best = nullptr;
+	bool best_komi_set = false;
+	int best_visits = 0;
 	for (auto &it: m_evals) {
-		if ((it.id.komi_set && !best.id.komi_set) || it.visits > best.visits)
-			best = it;
+		bool komi_set = interned_analyzer_id (it.id).komi_set;
+		if ((komi_set && !best_komi_set) || it.visits > best_visits) {
+			best = &it;
+			best_komi_set = komi_set;
+			best_visits = it.visits;
+		}
 	}
-	return best;
+	return best == nullptr ? eval () : best->to_eval ();
 }
 
 eval game_state::eval_from (const analyzer_id &id, bool require)
 {
+	int idx = find_analyzer_id (id);
 	for (auto &it: m_evals) {
-		if (it.id == id)
-			return it;
+		if (it.id == idx)
+			return it.to_eval ();
 	}
 	return require ? eval () : best_eval ();
 }
@@ -5,6 +5,7 @@
 #include "goeval.h"
 
 #include <functional>
+#include <memory>
 
 inline std::string komi_str (double k)
 {
@@ -20,6 +21,7 @@ inline std::string komi_str (double k)
 class visual_tree
 {
 public:
+	/* Used to extract the visualization for display.  */
 	struct bit_rect
 	{
 		std::vector<bit_array> m_rep;
@@ -37,65 +39,42 @@ public:
 		{
 			return m_rep[y].test_bit (x);
 		}
-		void ior (const bit_rect &other, int xoff, int yoff)
-		{
-			for (int i = 0; i < other.m_h; i++)
-				m_rep[yoff + i].ior (other.m_rep[i], xoff);
-		}
-		bool test_overlap (const bit_rect &other, int xoff, int yoff)
-		{
-			for (int y = yoff; y < m_h && y - yoff < other.m_h; y++)
-				if (m_rep[y].intersect_p (other.m_rep[y - yoff], xoff))
-					return true;
-			return false;
-		}
-		void set_max_width (int x)
-		{
-			if (x <= m_w)
-				return;
-			m_w = x;
-			for (auto &vec: m_rep)
-				vec.grow (m_w);
-		}
-		void set_max_height (int h)
-		{
-			while (m_h < h) {
-				m_rep.emplace_back (m_w);
-				m_h++;
-			}
-		}
 	};
 
 private:
-	bit_rect m_rep;
+	/* The layout only ever needs to know the outline of a subtree: for each column,
+	   the first and last row that is occupied, by nodes or by connecting lines.
+	   Columns are kept in a singly linked list whose tails are shared between trees.
+	   A node whose only shown child is the main variation just adds one column in
+	   front of the child's list, and adding a variation creates new columns only
+	   for those the two trees have in common.  */
+	struct column
+	{
+		int top, bottom;
+		/* Added to the rows of all following columns.  */
+		int next_off;
+		std::shared_ptr<const column> next;
+	};
+	std::shared_ptr<const column> m_cols;
+	int m_w, m_h;
 	/* The offset from the parent's box.  */
 	int m_off_y = 0;
 public:
-	visual_tree (bool collapsed = false)
-		: m_rep (collapsed ? 2 : 1, 1)
-	{
-		m_rep.set_bit (0, 0);
-		if (m_rep.m_w == 2)
-			m_rep.set_bit (1, 0);
-	}
+	visual_tree (bool collapsed = false);
 	visual_tree (visual_tree &main_var, int max_child_width);
 	void add_variation (visual_tree &other);
 	int width () const
 	{
-		return m_rep.m_w;
+		return m_w;
 	}
 	int height () const
 	{
-		return m_rep.m_h;
+		return m_h;
 	}
 	int y_offset () const
 	{
 		return m_off_y;
 	}
-	const bit_rect &representation ()
-	{
-		return m_rep;
-	}
 };
 
 class game_state
@@ -138,14 +117,42 @@ private:
 	bool m_visual_collapse = false;
 	/* True if this node was considered visible when calculating the parent's visualization.  */
 	bool m_visual_shown = false;
+	/* True if the visualization of some node below this one is out of date, so that
+	   updates need to look only at the paths leading to changed nodes.  */
+	bool m_visual_dirty_below = false;
+	/* The HIDE_FIGURES argument of the last update_visualization call.  */
+	bool m_visual_hide_figs = false;
+
+	/* Mark the visualization of this node as out of date, and flag the path to it.  */
+	void invalidate_visual ()
+	{
+		s_shape_serial = ++s_change_serial;
+		m_visual_ok = false;
+		for (game_state *p = m_parent; p != nullptr && !p->m_visual_dirty_below; p = p->m_parent)
+			p->m_visual_dirty_below = true;
+	}
 
 	/* The SGF PM property, or -1 if it wasn't set.  */
 	int m_print_numbering = -1;
 	sgf_figure m_figure;
 
-	std::vector<eval> m_evals;
+	std::vector<eval_record> m_evals;
 	eval m_live_eval;
 
+	/* Incremented for every change to the shape of any game tree or to the evaluations
+	   stored in it, so that views can tell cheaply whether they need to look again.  */
+	static unsigned long s_change_serial;
+	/* The value of s_change_serial at the last change to the shape of a tree.  */
+	static unsigned long s_shape_serial;
+	/* The value of s_change_serial when m_evals last changed.  */
+	unsigned long m_evals_serial = 0;
+	/* The most recent changes to evaluations, as pairs of m_evals_serial and the
+	   node, oldest first.  Only the last few thousand are kept; s_eval_log_dropped
+	   is the serial of the newest one that was discarded.  */
+	static std::vector<std::pair<unsigned long, const game_state *>> s_eval_log;
+	static unsigned long s_eval_log_dropped;
+	void note_eval_change ();
+
 	/* Support for SGF VW.  */
 	bit_array *m_visible {};
 
@@ -230,11 +237,14 @@ public:
 			game_state *new_c = new game_state (*c, this);
 			m_children.push_back (new_c);
 		}
+		/* The copied children were laid out in another tree; check them all.  */
+		m_visual_dirty_below = true;
 		m_comment = other.m_comment;
 		m_active = other.m_active;
 		m_figure = other.m_figure;
 		m_print_numbering = other.m_print_numbering;
 		m_evals = other.m_evals;
+		m_evals_serial = ++s_change_serial;
 
 		m_timeleft_w = other.m_timeleft_w;
 		m_timeleft_b = other.m_timeleft_b;
@@ -259,7 +269,7 @@ public:
 			if (i == parent->m_active && i > 0)
 				parent->m_active--;
 
-			parent->m_visual_ok = false;
+			parent->invalidate_visual ();
 			if (parent->m_children.size () == 0)
 				parent->m_visual_collapse = false;
 #if 0
@@ -449,7 +459,7 @@ private:
 public:
 	game_state *add_child_edit_nochecks (const go_board &new_board, stone_color to_move, bool scored, add_mode am)
 	{
-		m_visual_ok = false;
+		invalidate_visual ();
 		int code = scored ? -3 : -2;
 		game_state *tmp = new game_state (new_board, m_move_number + 1, m_sgf_movenum + 1,
 						  this, to_move, code, code, none);
@@ -466,7 +476,7 @@ public:
 	game_state *add_child_move_nochecks (const go_board &new_board, stone_color to_move, int x, int y, add_mode am)
 	{
 		stone_color next_to_move = to_move == black ? white : black;
-		m_visual_ok = false;
+		invalidate_visual ();
 		game_state *tmp = new game_state (new_board, m_move_number + 1, m_sgf_movenum + 1,
 						  this, next_to_move, x, y, to_move);
 		return insert_child (tmp, am);
@@ -504,7 +514,7 @@ public:
 	}
 	game_state *add_child_pass_nochecks (const go_board &new_board, add_mode am)
 	{
-		m_visual_ok = false;
+		invalidate_visual ();
 		game_state *tmp = new game_state (new_board, m_move_number + 1, m_sgf_movenum + 1,
 						  this, m_to_move == black ? white : black);
 		tmp->m_move_color = m_to_move;
@@ -525,7 +535,7 @@ public:
 	{
 		m_children.push_back (other);
 		other->m_parent = this;
-		m_visual_ok = false;
+		invalidate_visual ();
 	}
 	bool valid_move_p (int x, int y, stone_color);
 	void toggle_group_alive (int x, int y)
@@ -626,7 +636,7 @@ public:
 		std::vector<game_state *> tmp;
 		std::swap (tmp, m_children);
 		m_active = 0;
-		m_visual_ok = false;
+		invalidate_visual ();
 		for (auto it: tmp)
 			it->m_parent = nullptr;
 		return tmp;
@@ -674,13 +684,22 @@ public:
 		return m_comment;
 	}
 	void update_eval (const eval &);
+	void update_eval (const eval_record &);
 	void update_eval (const game_state &other);
+	static unsigned long change_serial () { return s_change_serial; }
+	static unsigned long shape_serial () { return s_shape_serial; }
+	unsigned long evals_serial () const { return m_evals_serial; }
+	/* Call F for every node whose evaluations changed after change serial SERIAL,
+	   possibly more than once.  The nodes may have been deleted since, so F must
+	   only use them to look things up.  Returns false, without calling F, if the
+	   changes go back further than the log of them.  */
+	static bool evals_changed_since (unsigned long serial, const std::function<void (const game_state *)> &f);
 	eval best_eval ();
 	eval eval_from (const analyzer_id &id, bool require);
 	void collect_analyzers (std::function<void (const analyzer_id &, bool)> &callback)
 	{
 		for (auto &it: m_evals)
-			callback (it.id, it.score_stddev != 0);
+			callback (interned_analyzer_id (it.id), it.score_stddev != 0);
 	}
 	void set_eval_data (int visits, double winrate_black, analyzer_id id)
 	{
@@ -702,13 +721,22 @@ public:
 	}
 	bool find_eval (const analyzer_id &id, eval &ev)
 	{
+		int idx = find_analyzer_id (id);
 		for (auto &e: m_evals)
-			if (e.id == id) {
-				ev = e;
+			if (e.id == idx) {
+				ev = e.to_eval ();
 				return true;
 			}
 		return false;
 	}
+	/* Look up an evaluation by the index of its interned analyzer id.  */
+	const eval_record *find_eval (int id) const
+	{
+		for (auto &e: m_evals)
+			if (e.id == id)
+				return &e;
+		return nullptr;
+	}
 	void append_to_sgf (std::string &) const;
 
 	/* Should really only be used for setting handicap at the root node.  */
@@ -736,7 +764,7 @@ public:
 	void set_figure (int flags, const std::string &title)
 	{
 		if (!m_figure.present)
-			m_visual_ok = false;
+			invalidate_visual ();
 		m_figure.present = true;
 		m_figure.flags = flags;
 		m_figure.title = title;
@@ -744,7 +772,7 @@ public:
 	void clear_figure ()
 	{
 		if (m_figure.present)
-			m_visual_ok = false;
+			invalidate_visual ();
 		m_figure.present = false;
 	}
 	const bit_array *visible () const
@@ -791,7 +819,7 @@ public:
 			return;
 
 		m_visual_collapse = !m_visual_collapse;
-		m_visual_ok = false;
+		invalidate_visual ();
 	}
 	bool vis_collapsed ()
 	{
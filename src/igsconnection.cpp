@@ -13,6 +13,8 @@
 #include <QTimer>
 #include <QWidget>
 #include <QHostAddress>
+#include <cstring>
+#include <algorithm>
 #include "defines.h"
 #include "tables.h"
 #include "igsconnection.h"
@@ -26,9 +28,6 @@ IGSConnection::IGSConnection(QWidget *lvp, QWidget *lvg) : m_lv_p (lvp), m_lv_g
 
 	textCodec = 0;
 
-	saved_data = 0;
-	len_saved_data = 0;
-
 	username = "";
 	password = "";
 
@@ -36,6 +35,7 @@ IGSConnection::IGSConnection(QWidget *lvp, QWidget *lvg) : m_lv_p (lvp), m_lv_g
 	connect(qsocket, &QTcpSocket::connected, this, &IGSConnection::OnConnected);
 	connect(qsocket, &QTcpSocket::readyRead, this, &IGSConnection::OnReadyRead);
 	connect(qsocket, &QTcpSocket::disconnected, this, &IGSConnection::OnConnectionClosed);
+	connect(&m_replay_timer, &QTimer::timeout, this, &IGSConnection::replay_step);
 #if 0
 	connect(qsocket, SIGNAL(delayedCloseFinished()), SLOT(OnDelayedCloseFinish()));
 #endif
@@ -153,90 +153,105 @@ public:
 	}
 };
 
+char *line_buffer::reserve (int n)
+{
+	if (m_start == m_end)
+		m_start = m_end = 0;
+	else if (m_start > 0 && m_end + n > m_data.size ()) {
+		/* Move the partial line to the front rather than growing the buffer.  */
+		memmove (m_data.data (), m_data.constData () + m_start, m_end - m_start);
+		m_end -= m_start;
+		m_start = 0;
+	}
+	if (m_end + n > m_data.size ())
+		m_data.resize (std::max (m_end + n, m_data.size () * 2));
+	return m_data.data () + m_end;
+}
+
+/* Decode and remove everything up to and including the last newline.  */
+QString line_buffer::take_complete (QTextCodec *codec)
+{
+	if (m_start == m_end)
+		return QString ();
+	int last = m_data.lastIndexOf ('\n', m_end - 1);
+	if (last < m_start)
+		return QString ();
+	const char *p = m_data.constData () + m_start;
+	int len = last + 1 - m_start;
+	m_start = last + 1;
+	return codec->toUnicode (p, len);
+}
+
 // We got data to read
 void IGSConnection::OnReadyRead()
 {
-	qDebug("OnReadyRead....");
-	Update_Locker l1 (m_lv_p);
-	Update_Locker l2 (m_lv_g);
-	for (;;)
+	qint64 available = qsocket->bytesAvailable ();
+	if (available <= 0)
+		return;
+
+	char *dst = m_input.reserve (available);
+	qint64 nread = qsocket->read (dst, available);
+	if (nread <= 0)
+		return;
+	if (nread < available)
+		qDebug () << "available " << available << " but read " << nread;
+	m_input.commit (nread);
+	if (m_record.isOpen ())
+		m_record.write (dst, nread);
+
+	process_input ();
+}
+
+// pass the complete lines in m_input to the application
+void IGSConnection::process_input ()
+{
 	{
-		int available = qsocket->bytesAvailable();
-		if (available == 0)
-			return;
-
-		if (!qsocket->canReadLine()) {
-			char *new_data = new char[available + len_saved_data];
-			if (saved_data) {
-				memcpy (new_data, saved_data, len_saved_data);
-				delete[] saved_data;
-			}
-			int nread = qsocket->read (new_data + len_saved_data, available);
-			if (nread < available)
-				qDebug () << "available " << available << " but read " << nread;
-			saved_data = new_data;
-			len_saved_data += nread;
+		Update_Locker l1 (m_lv_p);
+		Update_Locker l2 (m_lv_g);
+		m_input.take_lines (textCodec, [this] (const QString &x) {
+			sendTextToApp (x);
 
-			if (authState == LOGIN && len_saved_data == 7)
-			{
-				qDebug("looking for 'Login:'");
-				QString y = QString::fromLatin1(saved_data, len_saved_data);
-
-				qDebug() << "Collected: " << y;
-				if (checkPrompt(y)) {
-					delete[] saved_data;
-					saved_data = 0;
-					len_saved_data = 0;
-				}
-			} else if (authState == PASSWORD && len_saved_data == 10) {
-				qDebug("looking for 'Password:'");
-				QString y = QString::fromLatin1 (saved_data, len_saved_data);
-
-				qDebug() << "Collected: " << y;
-				if (checkPrompt(y)) {
-					delete[] saved_data;
-					saved_data = 0;
-					len_saved_data = 0;
-				}
-			}
-		}
-		while (qsocket->canReadLine())
-		{
-			int size = qsocket->bytesAvailable() + 1;
-			char *c = new char[size + len_saved_data];
-			if (len_saved_data)
-				memcpy (c, saved_data, len_saved_data);
-			qsocket->readLine(c + len_saved_data, size);
-			QString x = textCodec->toUnicode(c);
-			delete[] c;
-			len_saved_data = 0;
-			if (saved_data)
-				delete[] saved_data;
-			saved_data = 0;
-
-			if (x.isEmpty())
+			if (authState == PASSWORD)
 			{
-				qDebug("READ:NULL");
-				return;
+				checkPrompt (x);
+				qDebug ("PASSWORD***");
 			}
+		});
+	}
 
-			// some statistics
-//		emit signal_setBytesIn(x.length());
-
-			x.truncate(x.length()-2);
-
-			sendTextToApp(x);
+	/* The login and password prompts are not terminated by a newline.  */
+	int len = m_input.pending ();
+	if ((authState == LOGIN && len == 7) || (authState == PASSWORD && len == 10))
+	{
+		QString y = QString::fromLatin1 (m_input.pending_data (), len);
+		qDebug () << "Collected: " << y;
+		if (checkPrompt (y))
+			m_input.clear ();
+	}
+}
 
-			if (authState == PASSWORD)
-			{
-				checkPrompt(x);
-				qDebug("PASSWORD***");
-			}
-		}
+/* Read the next chunk of a recorded session into the input buffer, exactly as
+   OnReadyRead does with data from the socket.  */
+void IGSConnection::replay_step ()
+{
+	for (int i = 0; i < m_replay_chunk && !m_replay.atEnd (); i++) {
+		char *dst = m_input.reserve (MAX_LINESIZE + 1);
+		qint64 len = m_replay.readLine (dst, MAX_LINESIZE + 1);
+		if (len <= 0)
+			break;
+		m_input.commit (len);
+		/* Overlong lines are read in pieces; count them once.  */
+		if (dst[len - 1] == '\n')
+			m_replay_lines++;
 	}
+	process_input ();
 
-//*/
-//	convertBlockToLines();
+	if (m_replay.atEnd ()) {
+		m_replay_timer.stop ();
+		m_replay.close ();
+		authState = LOGIN;
+		emit signal_replay_done (m_replay_lines, m_replay_clock.elapsed ());
+	}
 }
 
 // Connection was closed from host
@@ -279,6 +294,9 @@ void IGSConnection::sendTextToHost(QString txt, bool ignoreCodec)
 	*/
 
 	qDebug () << ">> " << txt;
+	// nobody is listening to a replay
+	if (m_replay.isOpen ())
+		return;
 	if (ignoreCodec)
 	{
 
@@ -309,6 +327,7 @@ bool IGSConnection::openConnection(const Host &host)
 
 	username = host.login_name;
 	password = host.password;
+	m_input.clear ();
 
 	QString hostnm = host.host;
 	int port = host.port;
@@ -327,6 +346,15 @@ bool IGSConnection::openConnection(const Host &host)
 
 bool IGSConnection::closeConnection()
 {
+	if (m_replay.isOpen ()) {
+		m_replay_timer.stop ();
+		m_replay.close ();
+		authState = LOGIN;
+		sendTextToApp ("Replay stopped.\n");
+		emit signal_replay_done (m_replay_lines, m_replay_clock.elapsed ());
+		return true;
+	}
+
 	// We have no connection?
 	if (qsocket->state() == QAbstractSocket::UnconnectedState)
 		return false;
@@ -347,3 +375,41 @@ bool IGSConnection::closeConnection()
 	return true;
 }
 
+bool IGSConnection::openReplay (const QString &path, int lines_per_second)
+{
+	if (isConnected () || m_replay.isOpen ())
+		return false;
+
+	m_replay.setFileName (path);
+	if (!m_replay.open (QIODevice::ReadOnly))
+		return false;
+
+	m_input.clear ();
+	if (!textCodec)
+		textCodec = QTextCodec::codecForLocale ();
+	/* The recording starts after the login.  */
+	authState = SESSION;
+
+	/* A timer interval of 0 runs once per pass of the event loop, so that
+	   repaints and timers are handled between chunks as during a real session.  */
+	int interval = 0;
+	m_replay_chunk = 100;
+	if (lines_per_second > 0) {
+		interval = lines_per_second >= 100 ? 10 : 1000 / lines_per_second;
+		m_replay_chunk = lines_per_second >= 100 ? lines_per_second / 100 : 1;
+	}
+	m_replay_lines = 0;
+	m_replay_clock.start ();
+	m_replay_timer.start (interval);
+	return true;
+}
+
+bool IGSConnection::recordSession (const QString &path)
+{
+	if (m_record.isOpen ())
+		m_record.close ();
+	if (path.isEmpty ())
+		return true;
+	m_record.setFileName (path);
+	return m_record.open (QIODevice::WriteOnly | QIODevice::Truncate);
+}
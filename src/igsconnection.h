@@ -10,12 +10,54 @@
 #include <QObject>
 #include <QTcpSocket>
 #include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
 
 class QTextCodec;
 struct Host;
 
 #define MAX_LINESIZE 512
 
+/* Collects the data received from the server and splits it into lines.  Data is read
+   straight into a growable buffer; only the unterminated line at its end is ever
+   moved, so a burst of lines costs one read, one decoding step and one string per
+   line.  */
+class line_buffer
+{
+	QByteArray m_data;
+	int m_start = 0;
+	int m_end = 0;
+
+	QString take_complete (QTextCodec *);
+
+public:
+	/* Return space for at least N more bytes, to be followed by a call to commit.  */
+	char *reserve (int n);
+	void commit (int n) { m_end += n; }
+
+	int pending () const { return m_end - m_start; }
+	const char *pending_data () const { return m_data.constData () + m_start; }
+	void clear () { m_start = m_end = 0; }
+
+	/* Decode all complete lines at once and pass them to F, without their line
+	   endings.  The buffer is updated before F is called, so F may cause more
+	   data to be added.  */
+	template<class F> void take_lines (QTextCodec *codec, F f)
+	{
+		QString text = take_complete (codec);
+		int len = text.length ();
+		int pos = 0;
+		while (pos < len) {
+			int nl = text.indexOf ('\n', pos);
+			int end = nl > pos && text[nl - 1] == '\r' ? nl - 1 : nl;
+			f (text.mid (pos, end - pos));
+			pos = nl + 1;
+		}
+	}
+};
+
 class IGSConnection : public QObject
 {
 	Q_OBJECT
@@ -30,11 +72,21 @@ public:
 	bool closeConnection();
 	void sendTextToHost(QString txt, bool ignoreCodec=false);
 
+	/* Feed the lines of a recorded session to the application as if they came
+	   from the server, LINES_PER_SECOND at a time, or as fast as the event loop
+	   allows if it is 0.  */
+	bool openReplay (const QString &path, int lines_per_second);
+	bool isReplaying () { return m_replay.isOpen (); }
+	/* Save everything received from now on to PATH, for later replays; an empty
+	   PATH stops the recording.  */
+	bool recordSession (const QString &path);
+
 signals:
 	// for statistics reason
 	void signal_setBytesIn(int);
 	void signal_setBytesOut(int);
 	void signal_text_to_app(const QString &);
+	void signal_replay_done (qint64 lines, qint64 msecs);
 
 protected:
 	virtual bool checkPrompt(const QString &);
@@ -50,11 +102,21 @@ private slots:
 	void OnDelayedCloseFinish();
 
 private:
+	void process_input ();
+	void replay_step ();
+
 	QTcpSocket *qsocket;
 	QTextCodec *textCodec;
 
-	int len_saved_data;
-	char *saved_data;
+	line_buffer m_input;
+
+	QFile m_record;
+	QFile m_replay;
+	QTimer m_replay_timer;
+	/* Lines fed on each tick of the timer.  */
+	int m_replay_chunk = 0;
+	qint64 m_replay_lines = 0;
+	QElapsedTimer m_replay_clock;
 	//struct USERINFO {
 	QString username;
 	QString password;
@@ -6,10 +6,18 @@
 *
 */
 
+#include <QApplication>
 #include <QPainter>
 #include <QPixmap>
 #include <QSvgRenderer>
 #include <QFileInfo>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QSemaphore>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
 
 #include "defines.h"
 #include "imagehandler.h"
@@ -101,20 +109,15 @@ extern bool isHidingStones;
 // shadow under stones
 void ImageHandler::paint_shadow_stone (QImage &si, int d)
 {
-	//const double pixel=0.8,shadow=0.99;
-
-	// these are the images
-	unsigned *pw=new unsigned[d*d];
-	int i, j,  k;
+	int i, j;
 	double di, dj, d2=(double)d/2.0-5e-1, r=d2-2e-1;
 	double hh;
 
-	k=0;
-
 	bool smallerstones = false;
 	if (smallerstones) r-=1;
 
-	for (i=0; i<d; i++)
+	for (i=0; i<d; i++) {
+		uint *line = (uint *)si.scanLine (i);
 		for (j=0; j<d; j++) {
 			di=i-d2; dj=j-d2;
 			hh=r-sqrt(di*di+dj*dj);
@@ -122,18 +125,11 @@ void ImageHandler::paint_shadow_stone (QImage &si, int d)
 				hh=2*hh/r ;
 				if (hh> 1)  hh=1;
 
-				pw[k]=((int)(255*hh)<<24)|(1<<16)|(1<<8)|(1);
+				line[j]=((int)(255*hh)<<24)|(1<<16)|(1<<8)|(1);
 			}
-			else pw[k]=0;
-			k++;
-
+			else line[j]=0;
 		}
-
-	// now copy the result in QImages
-	icopy(pw, si, d, d);
-
-	// free memory
-	delete[] pw;
+	}
 }
 
 static double shade_point (double x, double y, double material, double ratio, double hardness, double ambient_ratio)
@@ -164,35 +160,6 @@ static double shade_point (double x, double y, double material, double ratio, do
 
 static double pic_radius = 0.97;
 
-static void render (unsigned *dest, double *intense, int d, const QColor &in_col)
-{
-	double pix_width = 2.0 / d;
-	for (int k = 0; k < d*d; k++) {
-		int i = k % d;
-		int j = k / d;
-		double norm_x = 2.0*i / d - 1;
-		double norm_y = 2.0*j / d - 1;
-
-		double dist = sqrt(norm_x * norm_x + norm_y * norm_y);
-		double alpha = 1;
-		if (dist >= pic_radius - pix_width) {
-			dist -= pic_radius - pix_width;
-			if (dist < pix_width)
-				alpha = 1 - (dist / pix_width);
-			else
-				alpha = 0;
-		}
-		QColor col = in_col;
-		int h, s, v;
-		col.getHsv (&h, &s, &v);
-		col.setHsv (h, s, 255 * intense[k]);
-		int r = 0, g = 0, b = 0;
-		if (alpha > 0)
-			col.getRgb (&r, &g, &b);
-		dest[k] = (unsigned)(alpha * 255) * 0x01000000 + r * 0x010000 + g * 0x0100 + b;
-	}
-}
-
 void ImageHandler::paint_stone_new (QImage &wi, int d, const QColor &col, double hard, double spec,
 				    int flat, double radius, bool clamshell, int idx)
 {
@@ -205,79 +172,75 @@ void ImageHandler::paint_stone_new (QImage &wi, int d, const QColor &col, double
 	double h, s, v;
 	col.getHsvF (&h, &s, &v);
 
-	// these are the images
-	double *intense = new double[d*d];
-	int i, j;
-
-	double max_int = 0;
-
-	int k = 0;
-	for (i=0; i<d; i++)
-		for (j=0; j<d; j++) {
-			double norm_x = 2.0*i / d - 1;
+	/* Only the value component of the color varies across the stone, so rather than
+	   going through QColor's HSV conversion for every pixel, we precompute the colors
+	   for all possible values.  Out of range values produce an invalid color, which
+	   shows as black.  */
+	unsigned rgb_for_value[256];
+	int hue, sat, val;
+	col.getHsv (&hue, &sat, &val);
+	for (int i = 0; i < 256; i++)
+		rgb_for_value[i] = QColor::fromHsv (hue, sat, i).rgb () & 0xFFFFFF;
+
+	/* Flattening multiplies the distance from the center by its square root up to
+	   five times.  */
+	int n_flat = std::min (std::max (flat, 0), 5);
+	double pix_width = 2.0 / d;
+	double edge = pic_radius - pix_width;
+
+	/* Rows are independent of each other; each is written straight to the image.
+	   Note that the first coordinate runs along the rows, as it always has.  */
+	for (int i = 0; i < d; i++) {
+		uint *line = (uint *)wi.scanLine (i);
+		double norm_x0 = 2.0*i / d - 1;
+		for (int j = 0; j < d; j++) {
+			double norm_x = norm_x0;
 			double norm_y = 2.0*j / d - 1;
 
 			double dist = sqrt(norm_x * norm_x + norm_y * norm_y);
-			if (dist <= 1) {
-				double newdist = dist;
-				if (dist != 0) {
-					double rdist = sqrt (dist);
-					if (flat > 0)
-						newdist *= rdist;
-					if (flat > 1)
-						newdist *= rdist;
-					if (flat > 2)
-						newdist *= rdist;
-					if (flat > 3)
-						newdist *= rdist;
-					if (flat > 4)
-						newdist *= rdist;
-					norm_x = norm_x * (newdist / dist);
-					norm_y = norm_y * (newdist / dist);
-				}
+			/* Pixels outside the antialiased edge are fully transparent, no need
+			   to shade them.  */
+			if (dist >= edge + pix_width) {
+				line[j] = 0;
+				continue;
+			}
+			double alpha = dist >= edge ? 1 - (dist - edge) / pix_width : 1;
+
+			if (dist != 0 && n_flat > 0) {
+				/* A square root and a few multiplications are much cheaper than
+				   pow for every pixel.  */
+				double rdist = sqrt (dist);
+				double scale = rdist;
+				for (int k = 1; k < n_flat; k++)
+					scale *= rdist;
+				norm_x *= scale;
+				norm_y *= scale;
+			}
 
-				double v2 = v;
+			double v2 = v;
 
-				if (clamshell) {
-					double x = norm_x * d / 2;
-					double y = norm_y * d / 2;
-					double z = r*r-x*x-y*y;
-					if (z > 0)
-						z=sqrt(z)*f;
-					else
-						z=0;
+			if (clamshell) {
+				double x = norm_x * d / 2;
+				double y = norm_y * d / 2;
+				double z = r*r-x*x-y*y;
+				if (z > 0)
+					z=sqrt(z)*f;
+				else
+					z=0;
 
-					double xr=sqrt(6*(x*x+y*y+z*z));
-					double xr1=(2*z-x+y)/xr;
+				double xr=sqrt(6*(x*x+y*y+z*z));
+				double xr1=(2*z-x+y)/xr;
 
-					v2 = getStripe(desc, v, xr1/7.0, i, j, 0.15);
-				}
-				norm_x /= radius;
-				norm_y /= radius;
-#if 0 /* Some sort of random unevenness, but so far it doesn't look great.  */
-				double rnd_x = drand48 ();
-				double rnd_y = drand48 ();
-				rnd_x = (rnd_x * rnd_x * rnd_x - 0.5) / 10;
-				rnd_y = (rnd_y * rnd_y * rnd_y - 0.5) / 10;
-				norm_x += rnd_x;
-				norm_y += rnd_y;
-#endif
-				double intensity = shade_point (norm_x, norm_y, v2, spec, hard, m_ambient);
-				max_int = std::max (intensity, max_int);
-				intense[k] = intensity;
-			} else
-				intense[k] = 0;
-			k++;
+				v2 = getStripe(desc, v, xr1/7.0, i, j, 0.15);
+			}
+			norm_x /= radius;
+			norm_y /= radius;
+			double intensity = shade_point (norm_x, norm_y, v2, spec, hard, m_ambient);
+			double value = 255 * intensity;
+			unsigned rgb = value >= 0 && value < 256 ? rgb_for_value[(int)value] : 0;
+			line[j] = (unsigned)(alpha * 255) * 0x01000000 + rgb;
 		}
-
-	unsigned *pw = new unsigned[d*d];
-	render (pw, intense, d, col);
-	// now copy the result in QImages
-	icopy(pw, wi, d, d);
-
-	// free memory
-	delete[] pw;
-	delete[] intense;
+	}
 }
 
 void ImageHandler::paint_white_stone_picture(QImage &img, int size, int idx)
@@ -328,6 +291,11 @@ void ImageHandler::paint_black_stone_old (QImage &bi, int d)
 	double di, dj, d2=(double)d/2.0-5e-1, r=d2-2e-1, f=sqrt(3.0);
 	double x, y, z, xr,xr1, xr2, xg1,xg2,hh;
 
+	/* Stones may be painted on several threads at once, so we use our own random
+	   number generator rather than drand48.  */
+	std::minstd_rand rng (d);
+	std::uniform_real_distribution<double> noise (0, 1);
+
 	k=0;
 
 	bool smallerstones = false;
@@ -355,7 +323,7 @@ void ImageHandler::paint_black_stone_old (QImage &bi, int d)
 
 				//random = drand48();
 
-				g1=(int)(5+10*drand48() + 10*xr1 + xg1*140);
+				g1=(int)(5+10*noise (rng) + 10*xr1 + xg1*140);
 				g2=(int)(10+10* xr2+xg2*160);
 				g=(g1 > g2 ? g1 : g2);
 				//g=(int)1/ (1/g1 + 1/g2);
@@ -568,106 +536,65 @@ void ImageHandler::paint_one_stone (QImage &img, bool white, int size, int idx)
 }
 
 
-void ImageHandler::init(int size)
+/* Runs a function object on a thread pool.  */
+template<class F>
+class func_runnable : public QRunnable
 {
-	// Scale the images
-	size = size * 9 / 10;
-
-	//black stone
-	for (int i = 1; i <= WHITE_STONES_NB; i++)
-	{
-		QImage ib1(size, size, QImage::Format_ARGB32);
-		paint_one_stone (ib1, false, size, i - 1);
-		stonePixmaps.append(QPixmap::fromImage (ib1,
-							 Qt::PreferDither |
-							 Qt::DiffuseAlphaDither |
-							 Qt::DiffuseDither));
-
-		QImage gb1(ib1);
-		ghostImage(&gb1);
-		ghostPixmaps.append(QPixmap::fromImage(gb1));
-	}
-
-	// white stones
-	for (int i = 1; i <= WHITE_STONES_NB; i++)
-	{
-		QImage iw1(size, size, QImage::Format_ARGB32);
-		paint_one_stone (iw1, true, size, i - 1);
-		stonePixmaps.append(QPixmap::fromImage (iw1,
-							 Qt::PreferDither |
-							 Qt::DiffuseAlphaDither |
-							 Qt::DiffuseDither));
-
-		QImage gw1(iw1);
-		ghostImage(&gw1);
-		ghostPixmaps.append(QPixmap::fromImage(gw1));
-	}
+	F m_func;
+public:
+	func_runnable (const F &f) : m_func (f) { }
+	void run () override { m_func (); }
+};
 
-	//shadow under the stones
-	QImage is = QImage(size, size, QImage::Format_ARGB32);
-	if (m_look > 1)
-		paint_shadow_stone(is, size);
-	else
-		is.fill(0);
-	stonePixmaps.append(QPixmap::fromImage(is,
-					       Qt::PreferDither |
-					       Qt::DiffuseAlphaDither |
-					       Qt::DiffuseDither));
+template<class F>
+static void start_in_pool (QThreadPool &pool, const F &f)
+{
+	pool.start (new func_runnable<F> (f));
 }
 
-void ImageHandler::rescale(int size)
+void ImageHandler::render_images (int size, QList<QImage> &stones, QList<QImage> &ghosts)
 {
-	stone_params_from_settings ();
-	size = size + 1;
-
-	//repaint black stones
-	for (int i = 0; i < BLACK_STONES_NB; i++)
-	{
-		QImage ib1 = QImage(size, size, QImage::Format_ARGB32);
-		paint_one_stone (ib1, false, size, i);
-		stonePixmaps[i].convertFromImage(ib1, Qt::PreferDither |
-						 Qt::DiffuseAlphaDither |
-						 Qt::DiffuseDither);
-		QImage gb1(ib1);
-		ghostImage(&gb1);
-		ghostPixmaps[i].convertFromImage(gb1, Qt::PreferDither |
-						 Qt::DiffuseAlphaDither |
-						 Qt::DiffuseDither);
-	}
-
-	// white stones
-	for (int i = 0; i < WHITE_STONES_NB; i++)
-	{
-		QImage iw1 = QImage(size, size, QImage::Format_ARGB32);
-		paint_one_stone (iw1, true, size, i);
-		stonePixmaps[i+BLACK_STONES_NB].convertFromImage(iw1, Qt::PreferDither |
-						 Qt::DiffuseAlphaDither |
-						 Qt::DiffuseDither);
-		QImage gw1(iw1);
-		ghostImage(&gw1);
-		ghostPixmaps[i+BLACK_STONES_NB].convertFromImage(gw1, Qt::PreferDither |
-						 Qt::DiffuseAlphaDither |
-						 Qt::DiffuseDither);
-	}
-
-	// shadow
-	QImage is = QImage(size, size, QImage::Format_ARGB32);
-	if (m_look > 1)
-		paint_shadow_stone(is, size);
-	else
-		is.fill(0);
-	stonePixmaps[WHITE_STONES_NB+BLACK_STONES_NB].convertFromImage(is, Qt::PreferDither |
-							 Qt::DiffuseAlphaDither |
-							 Qt::DiffuseDither);
-#if 0
-	// QQQ add transparency image
-	int adding = 1+WHITE_STONES_NB; // black stone + white stone + shadow
-	QImage alpha = QImage(size, size, 32);
-	alpha.setAlphaBuffer(TRUE);
-	alpha.reset();
-	stonePixmaps->setImage(adding+1, new Q3CanvasPixmap(alpha));
-	stonePixmaps->image(adding+1)->setOffset(size/2, size/2);
-#endif
+	/* Black stone variants, white stone variants and the shadow.  They are all
+	   independent, so they are painted in parallel, on the global pool so that
+	   no threads need to be started for each size.  DONE counts finished images;
+	   the pool may be running other work, so we cannot wait for all of it.  */
+	const int n_stones = BLACK_STONES_NB + WHITE_STONES_NB;
+	std::vector<QImage> stone_imgs (n_stones + 1);
+	std::vector<QImage> ghost_imgs (n_stones);
+
+	QSemaphore done;
+	for (int i = 0; i <= n_stones; i++)
+		start_in_pool (*QThreadPool::globalInstance (), [this, i, size, n_stones, &stone_imgs, &ghost_imgs, &done] ()
+		{
+			QImage img (size, size, QImage::Format_ARGB32);
+			if (i == n_stones) {
+				if (m_look > 1)
+					paint_shadow_stone (img, size);
+				else
+					img.fill (0);
+				stone_imgs[i] = img;
+				done.release ();
+				return;
+			}
+			if (i < BLACK_STONES_NB)
+				paint_one_stone (img, false, size, i);
+			else
+				paint_one_stone (img, true, size, i - BLACK_STONES_NB);
+			stone_imgs[i] = img;
+
+			QImage ghost (img);
+			ghostImage (&ghost);
+			ghost_imgs[i] = ghost;
+			done.release ();
+		});
+	done.acquire (n_stones + 1);
+
+	stones.clear ();
+	ghosts.clear ();
+	for (auto &img: stone_imgs)
+		stones.append (img);
+	for (auto &img: ghost_imgs)
+		ghosts.append (img);
 }
 
 void ImageHandler::ghostImage(QImage *img)
@@ -716,3 +643,196 @@ void ImageHandler::stone_params_from_settings ()
 	else
 		m_b_col = QColor (bcol);
 }
+
+QString ImageHandler::params_key () const
+{
+	QStringList l;
+	l << QString::number (m_b_radius) << QString::number (m_w_radius)
+	  << QString::number (m_b_spec) << QString::number (m_w_spec)
+	  << QString::number (m_b_hard) << QString::number (m_w_hard)
+	  << QString::number (m_b_flat) << QString::number (m_w_flat)
+	  << QString::number (m_ambient) << QString::number (m_clamshell)
+	  << QString::number (m_look) << QString::number (m_sizePercent)
+	  << m_w_col.name (QColor::HexArgb) << m_b_col.name (QColor::HexArgb)
+	  << m_whiteStonePicturePath << m_blackStonePicturePath;
+	return l.join ('|');
+}
+
+/* Renders one image set on a thread of the atlas' pool, using a copy of the
+   ImageHandler taken when the job was created.  */
+class StoneAtlas::render_job : public QRunnable
+{
+	StoneAtlas *m_atlas;
+	ImageHandler m_painter;
+	int m_generation;
+	int m_size;
+
+public:
+	render_job (StoneAtlas *atlas, const ImageHandler &painter, int generation, int size)
+		: m_atlas (atlas), m_painter (painter), m_generation (generation), m_size (size)
+	{
+	}
+	void run () override
+	{
+		image_set set;
+		m_painter.render_images (m_size, set.stones, set.ghosts);
+		StoneAtlas *atlas = m_atlas;
+		int generation = m_generation;
+		int size = m_size;
+		QMetaObject::invokeMethod (atlas, [atlas, generation, size, set] () { atlas->job_done (generation, size, set); },
+					   Qt::QueuedConnection);
+	}
+};
+
+StoneAtlas::StoneAtlas ()
+	: QObject (qApp)
+{
+	/* One job at a time is enough; while the user is resizing a window, most of the
+	   intermediate sizes are never rendered at all.  */
+	m_pool.setMaxThreadCount (1);
+}
+
+StoneAtlas *StoneAtlas::instance ()
+{
+	/* Owned by the application object, which also ensures that the thread pool has
+	   finished before the process exits.  */
+	static StoneAtlas *atlas = new StoneAtlas;
+	return atlas;
+}
+
+/* Stones are rendered at sizes rounded up to a step that grows with the size, and
+   scaled down to the size that is actually needed.  The difference is too small
+   to be visible, but it greatly reduces the number of sets that are rendered.  */
+int StoneAtlas::quantise (int size)
+{
+	int step = std::max (1, size / 32);
+	return (size + step - 1) / step * step;
+}
+
+void StoneAtlas::check_params ()
+{
+	m_painter.stone_params_from_settings ();
+	QString key = m_painter.params_key ();
+	if (key == m_params)
+		return;
+	m_params = key;
+	m_generation++;
+	m_rendered.clear ();
+	m_pixmaps.clear ();
+	m_wanted.clear ();
+	/* A job that is still running will have its result discarded.  */
+	m_job_size = 0;
+}
+
+void StoneAtlas::want (int qsize)
+{
+	if (qsize == m_job_size)
+		return;
+	m_wanted.erase (std::remove (m_wanted.begin (), m_wanted.end (), qsize), m_wanted.end ());
+	m_wanted.push_back (qsize);
+	/* Forget sizes that were only passed through.  A view that still needs one of
+	   them asks again when it receives stones_ready.  */
+	if (m_wanted.size () > 4)
+		m_wanted.erase (m_wanted.begin ());
+	start_job ();
+}
+
+void StoneAtlas::start_job ()
+{
+	if (m_job_size != 0 || m_wanted.empty ())
+		return;
+	int qsize = m_wanted.back ();
+	m_wanted.pop_back ();
+	m_job_size = qsize;
+	m_pool.start (new render_job (this, m_painter, m_generation, qsize));
+}
+
+void StoneAtlas::job_done (int generation, int qsize, const image_set &set)
+{
+	if (generation != m_generation)
+		return;
+	m_job_size = 0;
+
+	m_rendered[qsize] = set;
+	/* Keep a handful of sizes, dropping those furthest away from the new one.  */
+	while (m_rendered.size () > 8) {
+		auto far = m_rendered.begin ();
+		if (qsize - far->first < std::prev (m_rendered.end ())->first - qsize)
+			far = std::prev (m_rendered.end ());
+		m_rendered.erase (far);
+	}
+
+	/* All provisional pixmaps are dropped, as there may now be better ones.  */
+	for (auto it = m_pixmaps.begin (); it != m_pixmaps.end ();)
+		if (it->second->provisional)
+			it = m_pixmaps.erase (it);
+		else
+			++it;
+
+	emit stones_ready ();
+	start_job ();
+}
+
+std::shared_ptr<const stone_pixmaps> StoneAtlas::make_pixmaps (int size, int from_size, bool provisional)
+{
+	const image_set &set = m_rendered[from_size];
+	auto convert = [size, from_size] (const QImage &img) -> QPixmap
+		{
+			if (size == from_size)
+				return QPixmap::fromImage (img, Qt::PreferDither | Qt::DiffuseAlphaDither | Qt::DiffuseDither);
+			return QPixmap::fromImage (img.scaled (size, size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation),
+						   Qt::PreferDither | Qt::DiffuseAlphaDither | Qt::DiffuseDither);
+		};
+
+	std::shared_ptr<stone_pixmaps> p = std::make_shared<stone_pixmaps> ();
+	p->size = size;
+	p->provisional = provisional;
+	for (auto &img: set.stones)
+		p->stones.append (convert (img));
+	for (auto &img: set.ghosts)
+		p->ghosts.append (convert (img));
+	return p;
+}
+
+/* Return stone images for SIZE.  The result may be provisional, in which case the
+   caller should ask again after stones_ready.  */
+std::shared_ptr<const stone_pixmaps> StoneAtlas::stones (int size)
+{
+	check_params ();
+
+	auto it = m_pixmaps.find (size);
+	if (it != m_pixmaps.end ())
+		return it->second;
+
+	int qsize = quantise (size);
+	int from_size = qsize;
+	if (m_rendered.find (qsize) == m_rendered.end ()) {
+		if (m_rendered.empty ()) {
+			/* Nothing to scale from, so this one must be done immediately.  */
+			image_set &set = m_rendered[qsize];
+			m_painter.render_images (qsize, set.stones, set.ghosts);
+		} else {
+			want (qsize);
+			/* Scale from the nearest size we have, preferring a larger one.  */
+			auto next = m_rendered.lower_bound (qsize);
+			if (next == m_rendered.end ())
+				from_size = std::prev (next)->first;
+			else if (next == m_rendered.begin ())
+				from_size = next->first;
+			else
+				from_size = (next->first - qsize <= qsize - std::prev (next)->first
+					     ? next->first : std::prev (next)->first);
+		}
+	}
+
+	std::shared_ptr<const stone_pixmaps> p = make_pixmaps (size, from_size, from_size != qsize);
+	m_pixmaps[size] = p;
+	/* Drop pixmaps no view is using any longer.  */
+	if (m_pixmaps.size () > 8)
+		for (auto pit = m_pixmaps.begin (); pit != m_pixmaps.end ();)
+			if (pit->second.use_count () == 1 && pit->first != size)
+				pit = m_pixmaps.erase (pit);
+			else
+				++pit;
+	return p;
+}
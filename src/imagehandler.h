@@ -5,11 +5,16 @@
 #ifndef IMAGEDATA_H
 #define IMAGEDATA_H
 
+#include <QObject>
 #include <QImage>
 #include <QPixmap>
+#include <QThreadPool>
 
 #include "defines.h"
 #include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
 
 struct WhiteDesc;
 
@@ -34,10 +39,14 @@ class ImageHandler
 public:
 	ImageHandler();
 
-	void init(int size);
-	void rescale(int size);
-	const QList<QPixmap> *getStonePixmaps() const { return &stonePixmaps; }
-	const QList<QPixmap> *getGhostPixmaps() const { return &ghostPixmaps; }
+	void stone_params_from_settings ();
+	/* A string describing all parameters that affect the appearance of stones.  */
+	QString params_key () const;
+	/* Paint the black and white stone variants of size SIZE, followed by the shadow,
+	   into STONES, and ghost versions of the stones into GHOSTS.  Does not touch
+	   anything but the images, so it can be used from a worker thread on a copy
+	   of the ImageHandler.  */
+	void render_images (int size, QList<QImage> &stones, QList<QImage> &ghosts);
 
 	void set_stone_params (double w_hard, double b_hard, double w_spec, double b_spec,
 			       double w_radius, double b_radius, int w_flat, int b_flat,
@@ -73,7 +82,6 @@ protected:
 private:
 	void decideAppearance(WhiteDesc *desc, int size, int rnd_idx);
 
-	void stone_params_from_settings ();
 	void paint_black_stone_old (QImage &bi, int d);
 	void paint_white_stone_old (QImage &wi, int d, bool clamshell, int idx = 0);
 	void paint_stone_new (QImage &wi, int d, const QColor &, double, double, int, double,
@@ -82,8 +90,67 @@ private:
 	void paint_black_stone_picture (QImage &img, int size, int idx);
 	void paint_stone_picture (QImage &img, int size, int idx, const QString& path);
 	void ghostImage(QImage *img);
+};
+
+/* The stone images used by a board view for one size: the black stone variants,
+   the white stone variants and the shadow, plus ghost versions of the stones.  */
+struct stone_pixmaps
+{
+	int size;
+	/* True if the images were scaled from a different size, because the proper
+	   ones are still being rendered.  */
+	bool provisional;
+	QList<QPixmap> stones, ghosts;
+};
+
+/* A process-wide cache of stone images, shared by all board views including the
+   small ones in previews and the database dialog.  Rendering stones is expensive,
+   so it is done on a background thread, at sizes rounded up to a coarser step for
+   large stones.  Until a size is available, images of the nearest rendered size
+   are scaled; stones_ready is emitted when views should ask again.  */
+class StoneAtlas : public QObject
+{
+	Q_OBJECT
+
+	struct image_set
+	{
+		QList<QImage> stones, ghosts;
+	};
+	class render_job;
+
+	/* Holds the current stone parameters and the random numbers for the stripes of
+	   white stones, so that all views show identical stones.  */
+	ImageHandler m_painter;
+	QString m_params;
+	/* Incremented whenever the parameters change, to discard results of jobs that
+	   were started with the old ones.  */
+	int m_generation = 0;
+
+	/* Image sets rendered at quantised sizes.  */
+	std::map<int, image_set> m_rendered;
+	/* Pixmaps for the sizes requested by views.  */
+	std::map<int, std::shared_ptr<const stone_pixmaps>> m_pixmaps;
+	/* Quantised sizes still to be rendered, the most recently requested last.  */
+	std::vector<int> m_wanted;
+	/* The size being rendered, or 0 if no job is running.  */
+	int m_job_size = 0;
+	QThreadPool m_pool;
+
+	StoneAtlas ();
+	void check_params ();
+	void want (int qsize);
+	void start_job ();
+	void job_done (int generation, int qsize, const image_set &);
+	std::shared_ptr<const stone_pixmaps> make_pixmaps (int size, int from_size, bool provisional);
+
+	static int quantise (int size);
+
+public:
+	static StoneAtlas *instance ();
+	std::shared_ptr<const stone_pixmaps> stones (int size);
 
-	QList<QPixmap> stonePixmaps, ghostPixmaps;
+signals:
+	void stones_ready ();
 };
 
 #endif
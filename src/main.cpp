@@ -6,7 +6,9 @@
  *
  */
 #include <tuple>
+#include <cstring>
 #include <QFileDialog>
+#include <QElapsedTimer>
 
 #include "config.h"
 #include "sgf.h"
@@ -17,6 +19,10 @@
 #include "ui_helpers.h"
 #include "variantgamedlg.h"
 #include "analyzedlg.h"
+#include "evalcache.h"
+#include "batchanalysis.h"
+#include "imagehandler.h"
+#include "igsconnection.h"
 #include "sgfpreview.h"
 #include "dbdialog.h"
 #include "archivehandlerfactory.h"
@@ -518,8 +524,127 @@ void show_batch_analysis ()
 	analyze_dialog->activateWindow ();
 }
 
+/* Batch analysis and the benchmarks run without any windows; make sure we can
+   start without a display, e.g. from cron or on a server.  */
+static void prepare_batch_mode (int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++)
+		if (strcmp (argv[i], "--batch-analyze") == 0 || strncmp (argv[i], "--batch-analyze=", 16) == 0
+		    || strcmp (argv[i], "--stone-benchmark") == 0
+		    || strcmp (argv[i], "--igs-benchmark") == 0 || strncmp (argv[i], "--igs-benchmark=", 16) == 0) {
+			if (!qEnvironmentVariableIsSet ("QT_QPA_PLATFORM"))
+				qputenv ("QT_QPA_PLATFORM", "offscreen");
+			return;
+		}
+}
+
+static int run_batch_analysis (QApplication &app, const QCommandLineParser &cmdp, const QStringList &args,
+			       const QCommandLineOption &clo_engine, const QCommandLineOption &clo_jobs,
+			       const QCommandLineOption &clo_seconds, const QCommandLineOption &clo_visits,
+			       const QCommandLineOption &clo_lines, const QCommandLineOption &clo_early,
+			       const QCommandLineOption &clo_outdir)
+{
+	QTextStream err (stderr);
+	Engine e ("", "", "", "", true, "");
+	if (!BatchAnalyzer::read_engine (cmdp.value (clo_engine), e)) {
+		err << QObject::tr ("Unknown engine or invalid engine file: ") << cmdp.value (clo_engine) << "\n";
+		return 2;
+	}
+	if (args.isEmpty ()) {
+		err << QObject::tr ("No files or directories given for batch analysis.") << "\n";
+		return 2;
+	}
+
+	batch_options opts;
+	opts.n_jobs = std::max (1, cmdp.value (clo_jobs).toInt ());
+	opts.n_seconds = std::max (1, cmdp.value (clo_seconds).toInt ());
+	opts.n_visits = std::max (0, cmdp.value (clo_visits).toInt ());
+	opts.n_lines = std::max (0, cmdp.value (clo_lines).toInt ());
+	opts.early_stop = cmdp.isSet (clo_early);
+	opts.output_dir = cmdp.value (clo_outdir);
+
+	/* Never stop for message boxes.  This is not saved, since there is no client
+	   window to write the settings back.  */
+	setting->writeBoolEntry ("SUPPRESS_SGF_PARSER_ERROR_WARNING", true);
+
+	BatchAnalyzer batch (e, BatchAnalyzer::collect_files (args), opts);
+	if (!batch.start ())
+		return 0;
+	return app.exec ();
+}
+
+/* Report how long it takes to render a complete set of stones at a range of sizes,
+   using the stone appearance configured in the preferences.  */
+static int run_stone_benchmark ()
+{
+	QTextStream out (stdout);
+	ImageHandler ih;
+	for (int size: { 16, 24, 32, 48, 64, 96, 128, 192, 256, 384 }) {
+		QList<QImage> stones, ghosts;
+		/* Take the best of a few runs to reduce noise.  */
+		qint64 best = 0;
+		for (int i = 0; i < 5; i++) {
+			QElapsedTimer timer;
+			timer.start ();
+			ih.render_images (size, stones, ghosts);
+			qint64 ns = timer.nsecsElapsed ();
+			if (i == 0 || ns < best)
+				best = ns;
+		}
+		out << QObject::tr ("Stone size ") << size << ": "
+		    << QString::number (best / 1e6, 'f', 2) << QObject::tr (" ms per set of ")
+		    << stones.size () + ghosts.size () << QObject::tr (" images") << "\n";
+	}
+	return 0;
+}
+
+/* Measure how fast data received from a Go server is split into lines and decoded,
+   using a transcript of a real session.  The data is fed in pieces of the size a
+   socket typically delivers during a burst.  */
+static int run_igs_benchmark (const QString &filename)
+{
+	QTextStream out (stdout);
+	QFile f (filename);
+	if (!f.open (QIODevice::ReadOnly)) {
+		QTextStream (stderr) << filename << ": " << QObject::tr ("cannot open file") << "\n";
+		return 2;
+	}
+	QByteArray transcript = f.readAll ();
+	if (transcript.isEmpty ())
+		return 0;
+
+	QTextCodec *codec = QTextCodec::codecForLocale ();
+	for (int chunk: { 1448, 16384, 65536 }) {
+		qint64 best = 0;
+		long lines = 0;
+		for (int i = 0; i < 5; i++) {
+			line_buffer buf;
+			lines = 0;
+			QElapsedTimer timer;
+			timer.start ();
+			for (int pos = 0; pos < transcript.size (); pos += chunk) {
+				int n = std::min (chunk, transcript.size () - pos);
+				memcpy (buf.reserve (n), transcript.constData () + pos, n);
+				buf.commit (n);
+				buf.take_lines (codec, [&lines] (const QString &) { lines++; });
+			}
+			qint64 ns = timer.nsecsElapsed ();
+			if (i == 0 || ns < best)
+				best = ns;
+		}
+		double secs = std::max (best, (qint64)1) / 1e9;
+		out << QObject::tr ("Reads of ") << chunk << QObject::tr (" bytes: ") << lines << QObject::tr (" lines in ")
+		    << QString::number (best / 1e6, 'f', 2) << QObject::tr (" ms, ")
+		    << QString::number (transcript.size () / secs / 1e6, 'f', 1) << QObject::tr (" MB/s, ")
+		    << QString::number (lines / secs, 'f', 0) << QObject::tr (" lines/s") << "\n";
+	}
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
+	prepare_batch_mode (argc, argv);
+
 	QApplication myapp(argc, argv);
 	qgo_app = &myapp;
 
@@ -532,6 +657,15 @@ int main(int argc, char **argv)
 	QCommandLineOption clo_debug { { "d", "debug" }, QObject::tr ("Display debug messages in a window") };
 	QCommandLineOption clo_debug_file { { "D", "debug-file" }, QObject::tr ("Send debug messages to <file>."), QObject::tr ("file") };
 	QCommandLineOption clo_encoding { { "e", "encoding "}, QObject::tr ("Specify text <encoding> of SGF files passed by command line."), "encoding"};
+	QCommandLineOption clo_batch { "batch-analyze", QObject::tr ("Analyze the given files and directories with <engine> without opening any windows.  <engine> is the name of a configured analysis engine, or a file with key=value lines for title, path, args, komi and boardsize."), QObject::tr ("engine") };
+	QCommandLineOption clo_jobs { { "j", "jobs" }, QObject::tr ("Number of engine processes to run in parallel in batch mode."), QObject::tr ("n"), "1" };
+	QCommandLineOption clo_seconds { "seconds", QObject::tr ("Maximum seconds per move in batch mode."), QObject::tr ("n"), "5" };
+	QCommandLineOption clo_visits { "visits", QObject::tr ("Visits per move in batch mode (0 for no limit)."), QObject::tr ("n"), "0" };
+	QCommandLineOption clo_lines { "lines", QObject::tr ("Number of variations to keep per move in batch mode."), QObject::tr ("n"), "10" };
+	QCommandLineOption clo_early { "early-stop", QObject::tr ("Move on early once the engine's choice is clear in batch mode.") };
+	QCommandLineOption clo_outdir { "output-dir", QObject::tr ("Write batch analysis results to <dir> instead of next to the input files."), QObject::tr ("dir") };
+	QCommandLineOption clo_stone_bench { "stone-benchmark", QObject::tr ("Print the time needed to render the stone images at various sizes, then exit.") };
+	QCommandLineOption clo_igs_bench { "igs-benchmark", QObject::tr ("Measure how fast the Go server transcript in <file> is split into lines, then exit."), QObject::tr ("file") };
 
 	cmdp.addOption (clo_client);
 	cmdp.addOption (clo_board);
@@ -541,6 +675,15 @@ int main(int argc, char **argv)
 	cmdp.addOption (clo_debug_file);
 #endif
 	cmdp.addOption (clo_encoding);
+	cmdp.addOption (clo_batch);
+	cmdp.addOption (clo_jobs);
+	cmdp.addOption (clo_seconds);
+	cmdp.addOption (clo_visits);
+	cmdp.addOption (clo_lines);
+	cmdp.addOption (clo_early);
+	cmdp.addOption (clo_outdir);
+	cmdp.addOption (clo_stone_bench);
+	cmdp.addOption (clo_igs_bench);
 	cmdp.addHelpOption ();
 	cmdp.addPositionalArgument ("file", QObject::tr ("Load <file> and display it in a board window."));
 
@@ -567,6 +710,8 @@ int main(int argc, char **argv)
 	setting = new Setting();
 	setting->loadSettings();
 
+	analysis_cache = new eval_cache ();
+
 	// Load translation
 	QTranslator trans(0);
 	QString lang = setting->getLanguage();
@@ -594,6 +739,28 @@ int main(int argc, char **argv)
 		myapp.installTranslator(&qtTrans);
 	}
 
+	if (cmdp.isSet (clo_stone_bench)) {
+		int retval = run_stone_benchmark ();
+		delete analysis_cache;
+		delete setting;
+		return retval;
+	}
+
+	if (cmdp.isSet (clo_igs_bench)) {
+		int retval = run_igs_benchmark (cmdp.value (clo_igs_bench));
+		delete analysis_cache;
+		delete setting;
+		return retval;
+	}
+
+	if (cmdp.isSet (clo_batch)) {
+		int retval = run_batch_analysis (myapp, cmdp, args, clo_batch, clo_jobs, clo_seconds, clo_visits,
+						 clo_lines, clo_early, clo_outdir);
+		delete analysis_cache;
+		delete setting;
+		return retval;
+	}
+
 	client_window = new ClientWindow (0);
 	client_window->setWindowTitle (PACKAGE1 + QString(" V") + VERSION);
 
@@ -666,6 +833,7 @@ int main(int argc, char **argv)
 #ifdef OWN_DEBUG_MODE
 	delete debug_dialog;
 #endif
+	delete analysis_cache;
 	delete setting;
 
 	return retval;
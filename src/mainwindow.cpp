@@ -1749,6 +1749,14 @@ void MainWindow::closeEvent (QCloseEvent *e)
 		e->ignore();
 }
 
+/* The board does not draw new positions while the window is minimized.  */
+void MainWindow::changeEvent (QEvent *e)
+{
+	QMainWindow::changeEvent (e);
+	if (e->type () == QEvent::WindowStateChange && !isMinimized ())
+		gfx_board->show_deferred_position ();
+}
+
 int MainWindow::checkModified (bool interactive)
 {
 	if (!m_game->modified ())
@@ -160,6 +160,7 @@ protected:
 	GameMode game_mode () { return m_gamemode; };
 
 	virtual void closeEvent (QCloseEvent *e) override;
+	virtual void changeEvent (QEvent *e) override;
 	virtual void keyPressEvent (QKeyEvent*) override;
 	virtual void keyReleaseEvent (QKeyEvent*) override;
 
@@ -0,0 +1,165 @@
+#include <cmath>
+#include <algorithm>
+
+#include <QPainter>
+#include <QStaticText>
+#include <QFontMetricsF>
+#include <QHash>
+
+#include "markpainter.h"
+
+void mark_painter::add (item::kind k, double x1, double y1, double x2, double y2,
+			const QString &fill, const QString &stroke, double width)
+{
+	item it;
+	it.k = k;
+	it.x1 = x1;
+	it.y1 = y1;
+	it.x2 = x2;
+	it.y2 = y2;
+	/* SVG color names are understood by QColor; "none" produces an invalid color.  */
+	it.fill = QColor (fill);
+	it.stroke = QColor (stroke);
+	it.width = width;
+	it.font_h = 0;
+	m_items.push_back (it);
+}
+
+/* The size calculations match those of svg_builder::text_at.  */
+void mark_painter::text_at (double cx, double cy, double sidelen, int len,
+			    const QString &txt, const QString &fill, const QFontInfo &)
+{
+	int real_len = txt.length ();
+	if (real_len > len)
+		len = real_len;
+	int font_h = sidelen * 0.8 / (1 + 0.35 * (len - 1));
+	/* A very crude attempt at centering vertically.  */
+	int font_yoff = -font_h * 0.17;
+
+	add (item::kind::text, cx, cy + font_h / 2 + font_yoff, 0, 0, fill, "none", 0);
+	m_items.back ().txt = txt;
+	m_items.back ().font_h = font_h;
+}
+
+void mark_painter::circle_at (double cx, double cy, double r,
+			      const QString &fill, const QString &stroke, const QString &width)
+{
+	add (item::kind::circle, cx, cy, r, 0, fill, stroke, width.isNull () ? 2 : width.toDouble ());
+}
+
+void mark_painter::square_at (double cx, double cy, double sidelen, const QString &fill, const QString &stroke)
+{
+	add (item::kind::square, cx, cy, sidelen, 0, fill, stroke, 2);
+}
+
+void mark_painter::triangle_at (double cx, double cy, double sidelen, const QString &fill, const QString &stroke)
+{
+	add (item::kind::triangle, cx, cy, sidelen, 0, fill, stroke, 2);
+}
+
+void mark_painter::cross_at (double cx, double cy, double sidelen, const QString &stroke)
+{
+	sidelen /= M_SQRT2 * 2;
+	add (item::kind::line, cx - sidelen, cy - sidelen, cx + sidelen, cy + sidelen, "none", stroke, 2);
+	add (item::kind::line, cx + sidelen, cy - sidelen, cx - sidelen, cy + sidelen, "none", stroke, 2);
+}
+
+/* Laying out text is the expensive part of drawing marks, and the same few labels
+   are drawn over and over, so we keep them around.  */
+struct cached_text
+{
+	QStaticText text;
+	/* The text is laid out again if it is not painted with the same font.  */
+	QFont font;
+	qreal ascent;
+};
+
+static const cached_text &find_text (const QString &family, bool bold, int pixel_size, const QString &txt)
+{
+	static QHash<QString, cached_text> cache;
+
+	QString key = family + "|" + QString::number (pixel_size) + (bold ? "|b|" : "|n|") + txt;
+	auto it = cache.constFind (key);
+	if (it != cache.constEnd ())
+		return *it;
+
+	/* Labels change with every analysis update; don't let the cache grow forever.  */
+	if (cache.size () > 4000)
+		cache.clear ();
+
+	QFont f (family);
+	f.setBold (bold);
+	f.setPixelSize (pixel_size);
+	cached_text ct;
+	ct.text.setText (txt);
+	ct.text.setTextFormat (Qt::PlainText);
+	ct.text.setPerformanceHint (QStaticText::AggressiveCaching);
+	ct.text.prepare (QTransform (), f);
+	ct.font = f;
+	ct.ascent = QFontMetricsF (f).ascent ();
+	return *cache.insert (key, ct);
+}
+
+void mark_painter::paint (QPainter &painter, const item_list &items, QPointF origin, double scale) const
+{
+	painter.save ();
+	painter.setRenderHint (QPainter::Antialiasing);
+	painter.setRenderHint (QPainter::TextAntialiasing);
+
+	for (auto &it: items) {
+		QPointF p1 = origin + QPointF (it.x1, it.y1) * scale;
+		if (it.k == item::kind::text) {
+			int px = std::max (1, (int)round (it.font_h * scale));
+			const cached_text &ct = find_text (m_family, m_bold, px, it.txt);
+			QSizeF sz = ct.text.size ();
+			painter.setPen (it.fill);
+			painter.setFont (ct.font);
+			painter.drawStaticText (QPointF (p1.x () - sz.width () / 2, p1.y () - ct.ascent), ct.text);
+			continue;
+		}
+
+		if (it.stroke.isValid ()) {
+			QPen pen (it.stroke);
+			pen.setWidthF (it.width * scale);
+			painter.setPen (pen);
+		} else
+			painter.setPen (Qt::NoPen);
+		if (it.fill.isValid ())
+			painter.setBrush (it.fill);
+		else
+			painter.setBrush (Qt::NoBrush);
+
+		switch (it.k) {
+		case item::kind::circle:
+		{
+			double r = it.x2 * scale;
+			painter.drawEllipse (p1, r, r);
+			break;
+		}
+		case item::kind::square:
+		{
+			double s = it.x2 * scale;
+			painter.drawRect (QRectF (p1.x () - s / 2, p1.y () - s / 2, s, s));
+			break;
+		}
+		case item::kind::triangle:
+		{
+			/* Same shape as svg_builder::triangle_at.  */
+			double half = it.x2 * scale / 2;
+			double s = sin (M_PI * 2 / 3);
+			double c = cos (M_PI * 2 / 3);
+			QPointF pts[3] = { QPointF (p1.x (), p1.y () - half),
+					   QPointF (p1.x () - s * half, p1.y () - c * half),
+					   QPointF (p1.x () + s * half, p1.y () - c * half) };
+			painter.drawPolygon (pts, 3);
+			break;
+		}
+		case item::kind::line:
+			painter.drawLine (p1, origin + QPointF (it.x2, it.y2) * scale);
+			break;
+		default:
+			break;
+		}
+	}
+	painter.restore ();
+}
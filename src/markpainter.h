@@ -0,0 +1,72 @@
+#ifndef MARKPAINTER_H
+#define MARKPAINTER_H
+
+#include <vector>
+
+#include <QString>
+#include <QColor>
+#include <QPointF>
+#include <QFontInfo>
+
+class QPainter;
+
+/* Collects board marks for on-screen display.  It offers the same drawing
+   functions as svg_builder, but instead of producing SVG text, which would have
+   to be parsed again for every redraw, it records a list of simple items that
+   are painted directly.  Coordinates are in the same abstract units as those
+   used for SVG; they are scaled when painting.  */
+class mark_painter
+{
+public:
+	struct item
+	{
+		enum class kind { circle, square, triangle, line, text };
+		kind k;
+		double x1, y1, x2, y2;
+		QColor fill, stroke;
+		double width;
+		/* For text items.  */
+		QString txt;
+		int font_h;
+
+		bool operator== (const item &other) const
+		{
+			return (k == other.k && x1 == other.x1 && y1 == other.y1 && x2 == other.x2 && y2 == other.y2
+				&& fill == other.fill && stroke == other.stroke && width == other.width
+				&& font_h == other.font_h && txt == other.txt);
+		}
+		bool operator!= (const item &other) const { return !(*this == other); }
+	};
+	typedef std::vector<item> item_list;
+
+private:
+	item_list m_items;
+	QString m_family;
+	bool m_bold;
+
+	void add (item::kind k, double x1, double y1, double x2, double y2,
+		  const QString &fill, const QString &stroke, double width);
+
+public:
+	mark_painter (const QFontInfo &fi) : m_family (fi.family ()), m_bold (fi.bold ())
+	{
+	}
+	int length () const { return m_items.size (); }
+	item_list items_from (int pos) const { return item_list (m_items.begin () + pos, m_items.end ()); }
+
+	void text_at (double cx, double cy, double sidelen, int len,
+		      const QString &txt, const QString &fill, const QFontInfo &fi);
+	void circle_at (double cx, double cy, double r,
+			const QString &fill, const QString &stroke, const QString &width = QString ());
+	void square_at (double cx, double cy, double sidelen,
+			const QString &fill, const QString &stroke);
+	void triangle_at (double cx, double cy, double sidelen,
+			  const QString &fill, const QString &stroke);
+	void cross_at (double cx, double cy, double sidelen,
+		       const QString &stroke);
+
+	/* Paint ITEMS, mapping a point P to ORIGIN + P * SCALE.  */
+	void paint (QPainter &, const item_list &items, QPointF origin, double scale) const;
+};
+
+#endif
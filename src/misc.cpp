@@ -102,3 +102,41 @@ QString rkToKey(QString txt, bool integer)
 		return keyStr + buffer + end;
 	}
 }
+
+// numeric rank key for sorting, computed from rkToKey(); stronger ranks get
+// higher values, '+' ranks sort above plain ones and '?' ranks below them.
+// rkToKey() puts 7d and 1p on the same value, so pros get a tier of their
+// own above all dans, as in the string keys
+int rkToSortKey(const QString &rk)
+{
+	int key = rkToKey(rk, true).toInt() * 4;
+	if (rk.contains('p'))
+		key += 100000;
+	if (rk.contains('+'))
+		return key + 3;
+	if (rk.contains('?'))
+		return key + 1;
+	return key + 2;
+}
+
+int string_pool::intern(const QString &s)
+{
+	auto it = m_ids.constFind(s);
+	if (it != m_ids.constEnd())
+		return *it;
+
+	int id = m_strings.size();
+	m_strings.append(s);
+	m_numbers.append(s.trimmed().toInt());
+	m_ids.insert(s, id);
+	return id;
+}
+
+// id 0 is always the empty string
+void string_pool::clear()
+{
+	m_strings.clear();
+	m_numbers.clear();
+	m_ids.clear();
+	intern(QString());
+}
@@ -6,10 +6,30 @@
 #define MISC_H
 
 #include <QString>
+#include <QVector>
+#include <QHash>
 
 // some useful functions
 
 QString rkToKey(QString, bool integer=false);
+int rkToSortKey(const QString &);
+
+// strings that take only a few distinct values (ranks, flags, game numbers)
+// are stored once and referred to by index; their numeric value is kept for
+// sorting
+class string_pool
+{
+	QVector<QString> m_strings;
+	QVector<int> m_numbers;
+	QHash<QString, int> m_ids;
+
+public:
+	string_pool() { clear(); }
+	int intern(const QString &);
+	const QString &str(int id) const { return m_strings[id]; }
+	int number(int id) const { return m_numbers[id]; }
+	void clear();
+};
 
 
 #endif
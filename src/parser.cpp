@@ -8,8 +8,30 @@
 
 #include <qregexp.h>
 #include <iostream>
+#include <vector>
 using namespace std;
 
+// Lines identifying the server we are connected to, checked in this order
+static const struct
+{
+	QLatin1String marker;
+	GSName name;
+} server_markers[] =
+{
+	{ QLatin1String("IGS entry on"), IGS },
+	{ QLatin1String("LGS #"), LGS },
+	{ QLatin1String("NNGS #"), NNGS },
+	// suggested by Rod Assard for playing with NNGS version 1.1.14
+	{ QLatin1String("Server (NNGS)"), NNGS },
+	{ QLatin1String("WING #"), WING },
+	{ QLatin1String("CTN #"), CTN },
+	// adapted from NNGS, chinese characters
+	{ QLatin1String("CWS #"), CWS },
+	{ QLatin1String("==CWS"), CWS },
+	// critical: TO BE WATCHED....
+	{ QLatin1String("#>"), DEFAULT }
+};
+
 // Parsing of Go Server messages
 Parser::Parser(ClientWindow *cw, qGoIF *qgoif) : m_client_win (cw), m_qgoif (qgoif)
 {
@@ -77,70 +99,19 @@ InfoType Parser::put_line(const QString &txt)
 	// try to find out server and set mode
 	if (gsName == GS_UNKNOWN)
 	{
-		if (line.indexOf("IGS entry on",0) != -1)
-		{
-			gsName = IGS;
-			emit signal_svname(gsName);
-			return SERVERNAME;
-		}
-
-		if (line.indexOf("LGS #",0) != -1)
-		{
-			gsName = LGS;
-			emit signal_svname(gsName);
-			return SERVERNAME;
-		}
-
-		if (line.indexOf("NNGS #",0) != -1)
-		{
-			gsName = NNGS;
-			emit signal_svname(gsName);
-			return SERVERNAME;
-		}
-
-		// suggested by Rod Assard for playing with NNGS version 1.1.14
-		if (line.indexOf("Server (NNGS)",0) != -1)
-		{
-			gsName = NNGS;
-			emit signal_svname(gsName);
-			return SERVERNAME;
-		}
-
-		if (line.indexOf("WING #",0) != -1)
-		{
-			gsName = WING;
-			emit signal_svname(gsName);
-			return SERVERNAME;
-		}
-
-		if (line.indexOf("CTN #",0) != -1)
-		{
-			gsName = CTN;
-			emit signal_svname(gsName);
-			return SERVERNAME;
-		}
-
-		// adapted from NNGS, chinese characters
-		if (line.indexOf("CWS #",0) != -1 || line.indexOf("==CWS",0) != -1)
-		{
-			gsName = CWS;
-			emit signal_svname(gsName);
-			return SERVERNAME;
-		}
-
-		// critical: TO BE WATCHED....
-		if (line.indexOf("#>",0) != -1)
-		{
-			gsName = DEFAULT;
-			emit signal_svname(gsName);
-			return SERVERNAME;
-		}
+		for (auto &m: server_markers)
+			if (line.contains (m.marker))
+			{
+				gsName = m.name;
+				emit signal_svname(gsName);
+				return SERVERNAME;
+			}
 
 		// account name
 		if (line.indexOf("Your account name is",0) != -1)
 		{
 			buffer = line.right(line.length() - 21);
-			buffer.replace(QRegExp("[\".]"), "");
+			buffer.remove('"').remove('.');
 			emit signal_accname(buffer);
 			return ACCOUNT;
 		}
@@ -173,7 +144,7 @@ InfoType Parser::put_line(const QString &txt)
 	//
 	// get command type:
 	bool ok;
-	int cmd_nr = line.section(' ', 0, 0).toInt(&ok);
+	int cmd_nr = line.leftRef(line.indexOf(' ')).toInt(&ok);
 	if (!ok && memory_str.contains("CHANNEL"))
 	{
 		// special case: channel info
@@ -221,80 +192,63 @@ InfoType Parser::put_line(const QString &txt)
 
 	// process for different servers has particular solutions
 	// command mode -> expect result
-	switch (cmd_nr)
-	{
-	case 1:
-		return cmd1(line);
-	case 2:
-		return cmd2(line);
-	case 5:
-		return cmd5(line);
-	case 7:
-		return cmd7(line);
-	case 8:
-		return cmd8(line);
-	case 9:
-		return cmd9(line);
-	case 11:
-		return cmd11(line);
-	case 14:
-		return cmd14(line);
-	case 15:
-		return cmd15(line);
-	case 19:
-		return cmd19(line);
-	case 20:
-		return cmd20(line);
-	case 21:
-		return cmd21(line);
-	case 22:
-		return cmd22(line);
-#if 0 // TODO
+	const dispatch_entry *d = find_handler(cmd_nr);
+	if (d == nullptr)
+	{
+		emit signal_message(line);
+		return MESSAGE;
+	}
+	if (d->handler == nullptr)
+		return IT_OTHER;
+	return (this->*d->handler)(d->raw ? txt : line);
+}
+
+/* The handlers for numbered messages.  Entries without a handler are messages
+   that are known, but ignored.  */
+const Parser::dispatch_entry *Parser::find_handler(int cmd_nr)
+{
+	static const std::vector<dispatch_entry> table = [] ()
+	{
+		std::vector<dispatch_entry> t (64, dispatch_entry { nullptr, false, false });
+		t[1] = { &Parser::cmd1, false, true };
+		t[2] = { &Parser::cmd2, false, true };
+		t[5] = { &Parser::cmd5, false, true };
+		t[7] = { &Parser::cmd7, false, true };
+		t[8] = { &Parser::cmd8, false, true };
+		t[9] = { &Parser::cmd9, false, true };
+		t[11] = { &Parser::cmd11, false, true };
+		t[14] = { &Parser::cmd14, false, true };
+		t[15] = { &Parser::cmd15, false, true };
+		t[19] = { &Parser::cmd19, false, true };
+		t[20] = { &Parser::cmd20, false, true };
+		t[21] = { &Parser::cmd21, false, true };
+		t[22] = { &Parser::cmd22, false, true };
+		// TODO
 		// STORED
 		// 9 Stored games for frosla:
 		// 23           frosla-physician
-	case 23:
-		break;
-#endif
-
-	case 24:
-		return cmd24(line);
+		t[24] = { &Parser::cmd24, false, true };
 		// results
 		//25 File
 		//curio      [ 5d*](W) : lllgolll   [ 4d*](B) H 0 K  0.5 19x19 W+Resign 22-04-47 R
 		//curio      [ 5d*](W) : was        [ 4d*](B) H 0 K  0.5 19x19 W+Time 22-05-06 R
 		//25 File
-	case 25:
-		break;
-	case 27:
-		return cmd27(txt);
-	case 28:
-		return cmd28(line);
-	case 32:
-		return cmd32(line);
-
+		t[25] = { nullptr, false, true };
+		t[27] = { &Parser::cmd27, true, true };
+		t[28] = { &Parser::cmd28, false, true };
+		t[32] = { &Parser::cmd32, false, true };
 		// Setting your . to xxxx
-	case 40:
-		break;
-
-	case 42:
-		return cmd42(txt);
-
-	case 48:
-		return cmd48(line);
-
-	case 49:
-		return cmd49(line);
-
-	case 63:
-		return cmd63(line);
-
-	default:
-		emit signal_message(line);
-		return MESSAGE;
-	}
-
-	return IT_OTHER;
+		t[40] = { nullptr, false, true };
+		t[42] = { &Parser::cmd42, true, true };
+		t[48] = { &Parser::cmd48, false, true };
+		t[49] = { &Parser::cmd49, false, true };
+		t[63] = { &Parser::cmd63, false, true };
+		return t;
+	} ();
+
+	if (cmd_nr < 0 || cmd_nr >= (int)table.size() || !table[cmd_nr].known)
+		return nullptr;
+	return &table[cmd_nr];
 }
 
 // PROMPT
@@ -400,7 +354,7 @@ InfoType Parser::cmd7(const QString &line)
 		return IT_OTHER;
 	}
 #endif
-	QRegExp gamesre("\\[\\s*(\\d+)\\s*\\]\\s+"
+	static QRegExp gamesre ("\\[\\s*(\\d+)\\s*\\]\\s+"
 			"([^\\s]+)\\s+\\[\\s*([^\\]\\s]*)\\s*\\]\\s+" "vs.\\s+"
 			"([^\\s]+)\\s+\\[\\s*([^\\]\\s]*)\\s*\\]\\s+"
 			"\\(\\s*(\\d+)\\s+(\\d+)\\s+(\\d+)\\s+([\\d-.]+)\\s+(\\d+)\\s+([^\\s\\)]+)\\)\\s+"
@@ -521,7 +475,7 @@ InfoType Parser::cmd8(const QString &line)
 //	9     -- -- kou         6k*   0   0 23s  NR                                    
 //	9 SQ! -- -- GnuGo      11k*   0   0  5m  Estimation based on NNGS rating early 
 //	9   X -- -- Maurice     3k*   0   0 24s  2d at Hamilton Go Club, Canada; 3d in 
-InfoType Parser::cmd9(QString &line)
+InfoType Parser::cmd9(const QString &line)
 {
 	// status messages
 	if (line.contains("Set open to be"))
@@ -704,7 +658,9 @@ InfoType Parser::cmd9(QString &line)
 			h = newline.section(' ', 3, 3);
 
 		// @@@ 10?
-		k = newline.section(' ', 9, 9).remove(QRegExp("\\.$"));
+		k = newline.section(' ', 9, 9);
+		if (k.endsWith ('.'))
+			k.chop (1);
 
 		int size = 19;
 		if (newline.contains("13x13"))
@@ -728,7 +684,7 @@ InfoType Parser::cmd9(QString &line)
 	// 9 Use <nmatch yfh2test B 3 19 60 600 25 0 0 0> or <decline yfh2test> to respond.
 	else if (line.contains("<decline") && line.contains("match"))
 	{
-		QRegExp re("<(n?match[^>]*)>");
+		static QRegExp re ("<(n?match[^>]*)>");
 		if (re.indexIn(line) == -1) {
 			return IT_OTHER;
 		}
@@ -739,7 +695,7 @@ InfoType Parser::cmd9(QString &line)
 	// 9 Creating match [5] with guest17.
 	else if (line.contains("Creating match"))
 	{
-		QRegExp re("\\[\\s*(\\d+)\\s*\\]\\s+with\\s+([^\\s\\.]+)(?:\\sin.*accepted)?\\..*");
+		static QRegExp re ("\\[\\s*(\\d+)\\s*\\]\\s+with\\s+([^\\s\\.]+)(?:\\sin.*accepted)?\\..*");
 		if (re.indexIn(line) == -1) {
 			return IT_OTHER;
 		}
@@ -752,7 +708,7 @@ InfoType Parser::cmd9(QString &line)
 	}
 	else if (line.contains("Match") && line.contains("accepted"))
 	{
-		QRegExp re("\\[\\s*(\\d+)\\s*\\]\\s+with\\s+([^\\s]+)\\s+.*");
+		static QRegExp re ("\\[\\s*(\\d+)\\s*\\]\\s+with\\s+([^\\s]+)\\s+.*");
 		if (re.indexIn(line) == -1) {
 			return IT_OTHER;
 		}
@@ -779,7 +735,7 @@ InfoType Parser::cmd9(QString &line)
 	//9 yfh2test left this room
 	//9 yfh2test entered this room
 	else if (line.contains("this room"))
-		emit signal_refresh(10);
+		emit signal_roomnotice(line.section(' ', 0, 0));
 
 	//9 Requesting match in 10 min with frosla as Black.
 	else if (line.contains("Requesting match in"))
@@ -916,7 +872,7 @@ InfoType Parser::cmd9(QString &line)
 	// 9 Setting your . to Banana  [text] (idle: 0 minutes)
 	else if (line.contains("Setting your . to"))
 	{
-		QRegExp textre("\\[([^\\]]+)]");
+		static QRegExp textre ("\\[([^\\]]+)]");
 		if (textre.indexIn(line) != -1)
 		{
 			QString player = line.section(' ', 4, 4);
@@ -1268,7 +1224,7 @@ InfoType Parser::cmd15(const QString &line)
 {
 	if (line.contains("Game"))
 	{
-		QRegExp gamere ("Game\\s+(\\d+)\\s+"
+		static QRegExp gamere ("Game\\s+(\\d+)\\s+"
 				"([^:]+)\\s*:\\s+([^\\s]+)\\s+"
 				"\\(\\s*(\\d+)\\s+(\\d+)\\s+([\\d-]+)\\)\\s+"
 				"vs\\s+([^\\s]+)\\s+"
@@ -1289,6 +1245,8 @@ InfoType Parser::cmd15(const QString &line)
 		aGameInfo->btime = gamere.cap (9);
 		aGameInfo->bstones = gamere.cap (10);
 
+		emit signal_gameseen(aGameInfo->nr);
+
 		if (memory_str == QString("rmv@"))
 		{
 			// continue removing
@@ -1317,7 +1275,7 @@ InfoType Parser::cmd15(const QString &line)
 	}
 	else if (line.contains("TIME"))
 	{
-		QRegExp timere ("TIME:\\s*(\\d+)\\s*:([^:]+)\\([BW]\\):\\s*"
+		static QRegExp timere ("TIME:\\s*(\\d+)\\s*:([^:]+)\\([BW]\\):\\s*"
 				"(\\d+)\\s+(\\d+)/(\\d+)\\s+(\\d+)/(\\d+)\\s+(\\d+)/(\\d+)\\s+.*");
 
 		if (!timere.exactMatch (line)) {
@@ -1350,7 +1308,7 @@ InfoType Parser::cmd15(const QString &line)
 	}
 	else
 	{
-		QRegExp movere ("(\\d+)\\s*\\(([BW])\\):\\s*([^\\s].*)");
+		static QRegExp movere ("(\\d+)\\s*\\(([BW])\\):\\s*([^\\s].*)");
 
 		if (!movere.exactMatch (line)) {
 			return IT_OTHER;
@@ -1404,7 +1362,7 @@ InfoType Parser::cmd21(const QString &line)
 	if (line.contains(" connected.}"))
 	{
 		// {guest1381 [NR ] has connected.}
-		QRegExp re("\\{\\s*([^\\s]+)\\s+\\[\\s*([^\\]\\s]+)\\s*\\]");
+		static QRegExp re ("\\{\\s*([^\\s]+)\\s+\\[\\s*([^\\]\\s]+)\\s*\\]");
 		if (re.indexIn(line) == -1) {
 			qDebug () << "parse failure: " << line;
 			return IT_OTHER;
@@ -1486,7 +1444,7 @@ InfoType Parser::cmd21(const QString &line)
 		// {Match 116: xxxx [19k*] vs. yyyy1 [18k*] }
 		// {116:xxxx[19k*]yyyy1[18k*]}
 		// WING: {Match 41: o4641 [10k*] vs. Urashima [11k*] H:2 Komi:3.5}
-		QRegExp re("\\{[\\w\\s]*(\\d+):\\s*"
+		static QRegExp re ("\\{[\\w\\s]*(\\d+):\\s*"
 			   "([\\w\\d]+)\\s*\\[\\s*([^\\s\\]]+)\\s*\\]"
 			   "(?:\\s+vs.\\s+)?"
 			   "([\\w\\d]+)\\s*\\[\\s*([^\\s\\]]+)\\s*\\]\\s+\\}.*");
@@ -1593,16 +1551,17 @@ InfoType Parser::cmd22(const QString &line)
 InfoType Parser::cmd24(const QString &line)
 {
 	int pos;
-	QRegExp re("\\*([^\\*]+)\\*: CLIENT:.*wants handicap\\s+(\\d+), komi\\s+([\\d.-]+)");
-	if (re.indexIn (line) == -1) {
-		re = QRegExp ("-->\\s+([^\\*]+)\\s+CLIENT:.*wants handicap\\s+(\\d+), komi\\s+([\\d.-]+)");
-	}
-	if (re.indexIn (line) != -1)
+	static QRegExp tell_re ("\\*([^\\*]+)\\*: CLIENT:.*wants handicap\\s+(\\d+), komi\\s+([\\d.-]+)");
+	static QRegExp nngs_re ("-->\\s+([^\\*]+)\\s+CLIENT:.*wants handicap\\s+(\\d+), komi\\s+([\\d.-]+)");
+	QRegExp *re = &tell_re;
+	if (re->indexIn (line) == -1)
+		re = &nngs_re;
+	if (re->indexIn (line) != -1)
 	{
 		bool free = line.contains("free");
-		QString opp = re.cap(1);
-		QString h = re.cap(2);
-		QString k = re.cap(3);
+		QString opp = re->cap(1);
+		QString h = re->cap(2);
+		QString k = re->cap(3);
 		float komi = k.toFloat();
 
 		emit signal_komirequest(opp, h.toInt(), komi, free);
@@ -1981,7 +1940,7 @@ InfoType Parser::cmd42(const QString &txt)
 	}
 	//                        1                   2
 	//                        Name                Info
-	QRegExp re = QRegExp("42 ([A-Za-z0-9 ]{,10})  (.{1,14})  "
+	static QRegExp re ("42 ([A-Za-z0-9 ]{,10})  (.{1,14})  "
 	//                    3
 	//                    Country
 			     "([a-zA-Z][a-zA-Z. /]{,6}|--     )  "
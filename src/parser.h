@@ -63,6 +63,9 @@ signals:
 	void signal_cancelSeek();
 	void signal_SeekList(const QString&, const QString&);
 	void signal_refresh(int);
+	// a player entered or left the room; a move was sent for a game
+	void signal_roomnotice(const QString&);
+	void signal_gameseen(const QString&);
 	void signal_dispute(const QString&, const QString&);
 	void signal_set_observe(const QString&);
 	//void signal_undoRequest(const QString&);
@@ -82,12 +85,22 @@ public:
 	InfoType   cmdsent(const QString&);
 
 private:
+	// How numbered messages are handled; see find_handler
+	struct dispatch_entry
+	{
+		InfoType (Parser::*handler)(const QString&);
+		// pass the line as received instead of with the number removed
+		bool raw;
+		bool known;
+	};
+	static const dispatch_entry *find_handler(int);
+
 	InfoType   cmd1(const QString&);
 	InfoType   cmd2(const QString&);
 	InfoType   cmd5(const QString&);
 	InfoType   cmd7(const QString&);
 	InfoType   cmd8(const QString&);
-	InfoType   cmd9(QString&);
+	InfoType   cmd9(const QString&);
 	InfoType   cmd11(const QString&);
 	InfoType   cmd14(const QString&);
 	InfoType   cmd15(const QString&);
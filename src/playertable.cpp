@@ -4,170 +4,380 @@
 
 #include <QHeaderView>
 #include <QMouseEvent>
+#include <QBrush>
 
 #include "playertable.h"
 #include "misc.h"
 #include "setting.h"
 
+static const int n_player_columns = 12;
 
-PlayerTable::PlayerTable(QWidget *parent)
-	: QTreeWidget (parent)
+/*
+ *   PlayerTableModel
+ */
+
+void PlayerTableModel::fill_row (row &r, const Player &p)
 {
-	setColumnCount (12);
+	r.name = p.name;
+	r.extInfo = p.extInfo;
+	r.info = m_pool.intern (p.info);
+	r.rank = m_pool.intern (p.rank);
+	r.idle = m_pool.intern (p.idle);
+	r.play = m_pool.intern (p.play_str);
+	r.obs = m_pool.intern (p.obs_str);
+	r.won = m_pool.intern (p.won);
+	r.lost = m_pool.intern (p.lost);
+	r.country = m_pool.intern (p.country);
+	r.nmatch_text = m_pool.intern (p.nmatch_settings);
+	r.mark = m_pool.intern (p.mark);
+	r.rank_key = rkToSortKey (p.rank);
+	r.nmatch = p.nmatch;
 
-	QStringList headers;
-	headers <<  tr ("Stat") << tr ("Name") << tr ("Rk") << tr ("pl") << tr ("ob") << tr ("Idle") << tr ("X") << tr ("Info") << tr ("Won") << tr ("Lost") << tr ("Country") << tr ("Match prefs");
-	setHeaderLabels (headers);
-	for (int i = 0; i < 12; i++)
-		header()->setSectionResizeMode(i, QHeaderView::ResizeToContents);
+	if (!p.nmatch) {
+		m_nmatch.remove (p.name);
+		return;
+	}
+	nmatch_prefs &n = m_nmatch[p.name];
+	n.black = p.nmatch_black;
+	n.white = p.nmatch_white;
+	n.nigiri = p.nmatch_nigiri;
+	n.handicapMin = p.nmatch_handicapMin;
+	n.handicapMax = p.nmatch_handicapMax;
+	n.timeMin = p.nmatch_timeMin;
+	n.timeMax = p.nmatch_timeMax;
+	n.BYMin = p.nmatch_BYMin;
+	n.BYMax = p.nmatch_BYMax;
+	n.stonesMin = p.nmatch_stonesMin;
+	n.stonesMax = p.nmatch_stonesMax;
+	n.KoryoMin = p.nmatch_KoryoMin;
+	n.KoryoMax = p.nmatch_KoryoMax;
+}
 
-	setFocusPolicy (Qt::NoFocus);
-	setContextMenuPolicy (Qt::CustomContextMenu);
+bool PlayerTableModel::find_player (const QString &name, Player &p) const
+{
+	auto it = m_index.constFind (name);
+	if (it == m_index.constEnd ())
+		return false;
 
-	setUniformRowHeights (true);
-	setAlternatingRowColors (true);
+	const row &r = m_rows[*it];
+	p.name = r.name;
+	p.extInfo = r.extInfo;
+	p.info = m_pool.str (r.info);
+	p.rank = m_pool.str (r.rank);
+	p.idle = m_pool.str (r.idle);
+	p.play_str = m_pool.str (r.play);
+	p.obs_str = m_pool.str (r.obs);
+	p.won = m_pool.str (r.won);
+	p.lost = m_pool.str (r.lost);
+	p.country = m_pool.str (r.country);
+	p.nmatch_settings = m_pool.str (r.nmatch_text);
+	p.mark = m_pool.str (r.mark);
+	p.nmatch = r.nmatch;
+	p.online = true;
 
-	// set sorting order for players by rank
-	setAllColumnsShowFocus (true);
-	sortItems (2, Qt::AscendingOrder);
+	auto n = m_nmatch.constFind (name);
+	if (n != m_nmatch.constEnd ()) {
+		p.nmatch_black = n->black;
+		p.nmatch_white = n->white;
+		p.nmatch_nigiri = n->nigiri;
+		p.nmatch_handicapMin = n->handicapMin;
+		p.nmatch_handicapMax = n->handicapMax;
+		p.nmatch_timeMin = n->timeMin;
+		p.nmatch_timeMax = n->timeMax;
+		p.nmatch_BYMin = n->BYMin;
+		p.nmatch_BYMax = n->BYMax;
+		p.nmatch_stonesMin = n->stonesMin;
+		p.nmatch_stonesMax = n->stonesMax;
+		p.nmatch_KoryoMin = n->KoryoMin;
+		p.nmatch_KoryoMax = n->KoryoMax;
+	}
+	return true;
 }
 
-void PlayerTable::mouseDoubleClickEvent(QMouseEvent *e)
+// let the views know about rows added during a batch
+void PlayerTableModel::show_pending ()
 {
-	printf ("doubleclick\n");
-	if (e->button () == Qt::LeftButton) {
-		QTreeWidgetItem *item = itemAt (e->pos ());
-		printf ("item %p\n", item);
-		if (item)
-			emit signal_doubleClicked (item);
+	int n = m_rows.size ();
+	if (n == m_n_shown)
+		return;
+	beginInsertRows (QModelIndex (), m_n_shown, n - 1);
+	m_n_shown = n;
+	endInsertRows ();
+}
+
+void PlayerTableModel::set_player (const Player &p)
+{
+	auto it = m_index.constFind (p.name);
+	if (it != m_index.constEnd ()) {
+		int r = *it;
+		fill_row (m_rows[r], p);
+		if (r < m_n_shown)
+			emit dataChanged (index (r, 0), index (r, n_player_columns - 1));
+		return;
 	}
+
+	row r;
+	fill_row (r, p);
+	m_index.insert (p.name, m_rows.size ());
+	m_rows.push_back (r);
+	if (!m_batching)
+		show_pending ();
 }
 
-void PlayerTable::showOpen(bool checked)
+void PlayerTableModel::set_game (const QString &name, const QString &game)
 {
-	QTreeWidgetItemIterator lv(this);
+	auto it = m_index.constFind (name);
+	if (it == m_index.constEnd ())
+		return;
+	int r = *it;
+	m_rows[r].play = m_pool.intern (game);
+	if (r < m_n_shown)
+		emit dataChanged (index (r, 3), index (r, 3));
+}
 
-	for (; *lv; lv++)
-	{
-		// player is not open or is playing a match
-		if ((*lv)->text(0).contains('X') || !(*lv)->text(3).contains('-'))
-			(*lv)->setHidden (checked);
-		else
-			(*lv)->setHidden (false);
+// the last row takes the place of the removed one, so that nothing needs to
+// be renumbered
+bool PlayerTableModel::remove_player (const QString &name)
+{
+	auto it = m_index.find (name);
+	if (it == m_index.end ())
+		return false;
+
+	show_pending ();
+	int r = *it;
+	m_index.erase (it);
+	m_nmatch.remove (name);
+
+	int last = m_rows.size () - 1;
+	if (r != last) {
+		m_rows[r] = m_rows[last];
+		m_index[m_rows[r].name] = r;
+		emit dataChanged (index (r, 0), index (r, n_player_columns - 1));
 	}
+	beginRemoveRows (QModelIndex (), last, last);
+	m_rows.pop_back ();
+	m_n_shown = last;
+	endRemoveRows ();
+	return true;
 }
 
-/*
- *   PlayerTableItem
- */
-#if 0
-PlayerTableItem::PlayerTableItem(PlayerTable *parent, const char* name)
-	: QTreeWidgetItem(parent, name)
+void PlayerTableModel::clear_players ()
+{
+	beginResetModel ();
+	m_rows.clear ();
+	m_index.clear ();
+	m_nmatch.clear ();
+	m_pool.clear ();
+	m_n_shown = 0;
+	endResetModel ();
+}
+
+// collect new rows until end_batch instead of inserting them one by one
+void PlayerTableModel::begin_batch ()
+{
+	m_batching = true;
+}
+
+void PlayerTableModel::end_batch ()
 {
-;
+	m_batching = false;
+	show_pending ();
 }
 
-PlayerTableItem::PlayerTableItem(PlayerTableItem *parent, const char* name)
-	: QTreeWidgetItem(parent, name)
+bool PlayerTableModel::row_open (int r) const
 {
-;
+	const row &pr = m_rows[r];
+	// player is not open or is playing a match
+	return !m_pool.str (pr.info).contains ('X') && m_pool.str (pr.play).contains ('-');
 }
-#endif
 
-PlayerTableItem::PlayerTableItem(PlayerTable *parent, const Player &p)
-	: QTreeWidgetItem(parent), m_p (p)
+bool PlayerTableModel::row_less (int r1, int r2, int column) const
 {
-	setTextAlignment(3, Qt::AlignRight);
-	setTextAlignment(4, Qt::AlignRight);
-	setTextAlignment(5, Qt::AlignRight);
-	setTextAlignment(6, Qt::AlignRight);
-	setTextAlignment(7, Qt::AlignRight);
-	setTextAlignment(8, Qt::AlignRight);
-	setTextAlignment(9, Qt::AlignRight);
+	const row &a = m_rows[r1];
+	const row &b = m_rows[r2];
 
-	ownRepaint ();
-	seeking = false;
+	int num1 = 0, num2 = 0;
+	int str1 = -1, str2 = -1;
+	switch (column) {
+	case 1: break;
+	// strongest players first
+	case 2: num1 = b.rank_key; num2 = a.rank_key; break;
+	case 3: num1 = m_pool.number (a.play); num2 = m_pool.number (b.play); break;
+	case 4: num1 = m_pool.number (a.obs); num2 = m_pool.number (b.obs); break;
+	case 8: num1 = m_pool.number (a.won); num2 = m_pool.number (b.won); break;
+	case 9: num1 = m_pool.number (a.lost); num2 = m_pool.number (b.lost); break;
+	case 7:
+	{
+		int c = QString::compare (a.extInfo, b.extInfo);
+		if (c != 0)
+			return c < 0;
+		break;
+	}
+	case 0: str1 = a.info; str2 = b.info; break;
+	case 5: str1 = a.idle; str2 = b.idle; break;
+	case 6: str1 = a.mark; str2 = b.mark; break;
+	case 10: str1 = a.country; str2 = b.country; break;
+	case 11: str1 = a.nmatch_text; str2 = b.nmatch_text; break;
+	}
+	if (num1 != num2)
+		return num1 < num2;
+	if (str1 != str2) {
+		int c = QString::compare (m_pool.str (str1), m_pool.str (str2));
+		if (c != 0)
+			return c < 0;
+	}
+	return QString::compare (a.name, b.name, Qt::CaseInsensitive) < 0;
 }
 
-PlayerTableItem::~PlayerTableItem()
+int PlayerTableModel::rowCount (const QModelIndex &parent) const
 {
+	return parent.isValid () ? 0 : m_n_shown;
 }
 
-QVariant PlayerTableItem::data (int column, int role) const
+int PlayerTableModel::columnCount (const QModelIndex &parent) const
 {
+	return parent.isValid () ? 0 : n_player_columns;
+}
+
+QVariant PlayerTableModel::data (const QModelIndex &index, int role) const
+{
+	if (!index.isValid () || index.row () >= m_n_shown)
+		return QVariant ();
+
+	const row &r = m_rows[index.row ()];
 	if (role == Qt::ForegroundRole) {
-		if (its_me)
+		const QString &mark = m_pool.str (r.mark);
+		if (mark.contains ('M'))
 			return QBrush (Qt::blue);
-		else if (watched)
+		else if (mark.contains ('W'))
 			return QBrush (Qt::darkGreen);
-		else if (!open)
+		else if (m_pool.str (r.info).contains ('X'))
 			return QBrush (Qt::gray);
-		else if (exclude)
+		else if (mark.contains ('X'))
 			return QBrush (Qt::red);
-		else if (seeking)
-			return QBrush (Qt::magenta);
 		return QVariant ();
 	} else if (role == Qt::TextAlignmentRole) {
-		return column < 3 ? Qt::AlignLeft : Qt::AlignRight;
+		return index.column () < 3 ? Qt::AlignLeft : Qt::AlignRight;
 	}
 
 	if (role != Qt::DisplayRole)
 		return QVariant ();
-	switch (column) {
-	case 0: return m_p.info;
-	case 1: return m_p.name;
-	case 2: return m_p.rank;
-	case 3: return m_p.play_str;
-	case 4: return m_p.obs_str;
-	case 5: return m_p.idle;
-	case 6: return m_p.mark;
-	case 7: return m_p.extInfo;
-	case 8: return m_p.won;
-	case 9: return m_p.lost;
-	case 10: return m_p.country;
-	case 11: return m_p.nmatch_settings;
-	case 12: return m_p.sort_rk;
+	switch (index.column ()) {
+	case 0: return m_pool.str (r.info);
+	case 1: return r.name;
+	case 2: return m_pool.str (r.rank);
+	case 3: return m_pool.str (r.play);
+	case 4: return m_pool.str (r.obs);
+	case 5: return m_pool.str (r.idle);
+	case 6: return m_pool.str (r.mark);
+	case 7: return r.extInfo;
+	case 8: return m_pool.str (r.won);
+	case 9: return m_pool.str (r.lost);
+	case 10: return m_pool.str (r.country);
+	case 11: return m_pool.str (r.nmatch_text);
 	default: return QVariant ();
 	}
 }
 
-void PlayerTableItem::ownRepaint()
+QVariant PlayerTableModel::headerData (int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QVariant ();
+
+	switch (section) {
+	case 0: return tr ("Stat");
+	case 1: return tr ("Name");
+	case 2: return tr ("Rk");
+	case 3: return tr ("pl");
+	case 4: return tr ("ob");
+	case 5: return tr ("Idle");
+	case 6: return tr ("X");
+	case 7: return tr ("Info");
+	case 8: return tr ("Won");
+	case 9: return tr ("Lost");
+	case 10: return tr ("Country");
+	case 11: return tr ("Match prefs");
+	default: return QVariant ();
+	}
+}
+
+/*
+ *   PlayerTableProxy
+ */
+
+PlayerTableProxy::PlayerTableProxy (PlayerTableModel *m, QObject *parent)
+	: QSortFilterProxyModel (parent), m_model (m)
+{
+	setSourceModel (m);
+	setDynamicSortFilter (true);
+}
+
+void PlayerTableProxy::set_only_open (bool on)
+{
+	if (m_only_open == on)
+		return;
+	m_only_open = on;
+	invalidateFilter ();
+}
+
+bool PlayerTableProxy::filterAcceptsRow (int row, const QModelIndex &) const
 {
-	open = m_p.info.contains('X') == 0;
-	watched = m_p.mark.contains ('W');
-	its_me = m_p.mark.contains ('M');
-	exclude = m_p.mark.contains ('X');
+	return !m_only_open || m_model->row_open (row);
 }
 
-bool PlayerTableItem::operator<(const QTreeWidgetItem &other) const
+bool PlayerTableProxy::lessThan (const QModelIndex &left, const QModelIndex &right) const
+{
+	return m_model->row_less (left.row (), right.row (), left.column ());
+}
+
+/*
+ *   PlayerTable
+ */
+
+PlayerTable::PlayerTable(QWidget *parent)
+	: QTreeView (parent), m_proxy (&m_model)
 {
-	int column = treeWidget()->sortColumn();
-	int col_adj = column == 2 ? 12 : column;
-	const QString &t1 = text (col_adj);
-	const QString &t2 = other.text (col_adj);
+	setModel (&m_proxy);
+	for (int i = 0; i < n_player_columns; i++)
+		header()->setSectionResizeMode(i, QHeaderView::ResizeToContents);
+
+	setFocusPolicy (Qt::NoFocus);
+	setContextMenuPolicy (Qt::CustomContextMenu);
+
+	setRootIsDecorated (false);
+	setUniformRowHeights (true);
+	setAlternatingRowColors (true);
+
+	// set sorting order for players by rank
+	setAllColumnsShowFocus (true);
+	setSortingEnabled (true);
+	sortByColumn (2, Qt::AscendingOrder);
+}
 
-	return t1 < t2;
+PlayerTable::~PlayerTable()
+{
+	// the view must let go of the proxy before the members are destroyed
+	setModel (nullptr);
 }
 
-#if 0
-void PlayerTableItem::set_nmatchSettings(Player *p)
+QString PlayerTable::player_at (const QPoint &p) const
 {
-	nmatch = p->nmatch;
+	QModelIndex idx = indexAt (p);
+	if (!idx.isValid ())
+		return QString ();
+	return m_model.name_at (m_proxy.mapToSource (idx).row ());
+}
 
-	nmatch_black = 		p->nmatch_black ;
-	nmatch_white = 		p->nmatch_white;
-	nmatch_nigiri = 	p->nmatch_nigiri ;
-	nmatch_handicapMin = 	p->nmatch_handicapMin;
-	nmatch_handicapMax  = 	p->nmatch_handicapMax;
-	nmatch_timeMin = 	p->nmatch_timeMin;
-	nmatch_timeMax  = 	p->nmatch_timeMax;
-	nmatch_BYMin = 		p->nmatch_BYMin;
-	nmatch_BYMax = 		p->nmatch_BYMax;
-	nmatch_stonesMin = 	p->nmatch_stonesMin;
-	nmatch_stonesMax = 	p->nmatch_stonesMax;
-	nmatch_KoryoMin = 	p->nmatch_KoryoMin;
-	nmatch_KoryoMax = 	p->nmatch_KoryoMax ;
+void PlayerTable::mouseDoubleClickEvent(QMouseEvent *e)
+{
+	if (e->button () == Qt::LeftButton) {
+		QString name = player_at (e->pos ());
+		if (!name.isNull ())
+			emit signal_doubleClicked (name);
+	}
+}
 
-	nmatch_settings =  !(p->nmatch_settings == "No match conditions");
+void PlayerTable::showOpen(bool checked)
+{
+	m_proxy.set_only_open (checked);
 }
-#endif
@@ -6,45 +6,22 @@
 #define PLAYERTABLE_H
 
 #include "tables.h"
+#include "misc.h"
 
-#include <QVariant>
-#include <QTreeWidget>
-
-
-class PlayerTable : public QTreeWidget
-{
-	Q_OBJECT
-
-public:
-	PlayerTable(QWidget* parent = 0);
-	~PlayerTable() {};
-//	virtual void setSorting ( int column, bool ascending = TRUE );
-	void showOpen(bool show);
-
-	void resize_columns ()
-	{
-#if 0
-		for (int i = 0; i < columnCount (); i++)
-			resizeColumnToContents (i);
-#endif
-	}
-
-private:
-	void mouseDoubleClickEvent(QMouseEvent *e);
-
-public slots:
-	virtual void slot_mouse_players(const QPoint&) {};
+#include <vector>
 
- signals:
-	void signal_doubleClicked (QTreeWidgetItem *);
-};
+#include <QVariant>
+#include <QTreeView>
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QHash>
 
 class Player
 {
 public:
 	Player() {};
 	~Player() {};
-	// #> Info Name Idle Rank | Info Name Idle Rank 
+	// #> Info Name Idle Rank | Info Name Idle Rank
 	QString info;
 	QString name;
 	QString idle;
@@ -59,7 +36,6 @@ public:
   	QString rated;
 	QString address;
 	QString mark;
-	QString sort_rk;
 
 	int     playing;
 	int     observing;
@@ -67,49 +43,130 @@ public:
 	bool    online;
 	// BWN 0-9 19-19 60-60 600-600 25-25 0-0 0-0 0-0
 	bool nmatch_black, nmatch_white, nmatch_nigiri;
-	int 	nmatch_handicapMin, nmatch_handicapMax, 
-		nmatch_timeMin, nmatch_timeMax, 
-		nmatch_BYMin, nmatch_BYMax, 
+	int 	nmatch_handicapMin, nmatch_handicapMax,
+		nmatch_timeMin, nmatch_timeMax,
+		nmatch_BYMin, nmatch_BYMax,
 		nmatch_stonesMin, nmatch_stonesMax,
 		nmatch_KoryoMin, nmatch_KoryoMax;
 
 	bool has_nmatch_settings () { return nmatch_settings != "No match conditions"; }
 };
 
-class PlayerTableItem : public QTreeWidgetItem
+// the players known to the client; one compact row per player, with
+// everything but the name and the extended info interned
+class PlayerTableModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+	struct row
+	{
+		QString name;
+		QString extInfo;
+		int info, rank, idle, play, obs, won, lost, country, nmatch_text, mark;
+		// computed once from the rank, see rkToSortKey
+		int rank_key;
+		bool nmatch;
+	};
+	struct nmatch_prefs
+	{
+		bool black, white, nigiri;
+		int handicapMin, handicapMax, timeMin, timeMax, BYMin, BYMax;
+		int stonesMin, stonesMax, KoryoMin, KoryoMax;
+	};
+
+	string_pool m_pool;
+	std::vector<row> m_rows;
+	// row numbers by player name
+	QHash<QString, int> m_index;
+	// match preferences of the players who have them
+	QHash<QString, nmatch_prefs> m_nmatch;
+	// rows beyond this one were added during a batch and are not yet known to views
+	int m_n_shown = 0;
+	bool m_batching = false;
+
+	void fill_row (row &, const Player &);
+	void show_pending ();
+
+public:
+	PlayerTableModel (QObject *parent = 0) : QAbstractTableModel (parent) { }
+
+	bool find_player (const QString &name, Player &) const;
+	bool contains (const QString &name) const { return m_index.contains (name); }
+	void set_player (const Player &);
+	void set_game (const QString &name, const QString &game);
+	bool remove_player (const QString &name);
+	void clear_players ();
+	void begin_batch ();
+	void end_batch ();
+
+	QString name_at (int r) const { return m_rows[r].name; }
+	bool row_open (int r) const;
+	bool row_less (int r1, int r2, int column) const;
+
+	virtual int rowCount (const QModelIndex &parent = QModelIndex ()) const override;
+	virtual int columnCount (const QModelIndex &parent = QModelIndex ()) const override;
+	virtual QVariant data (const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	virtual QVariant headerData (int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+};
+
+// sorts with the precomputed keys of the model, and hides closed or
+// playing players if asked to
+class PlayerTableProxy : public QSortFilterProxyModel
 {
-	Player m_p;
-	QString m_rk;
+	PlayerTableModel *m_model;
+	bool m_only_open = false;
+
 public:
+	PlayerTableProxy (PlayerTableModel *m, QObject *parent = 0);
+	void set_only_open (bool);
 
-	PlayerTableItem(PlayerTable *parent, const Player &);
-	~PlayerTableItem();
+protected:
+	virtual bool filterAcceptsRow (int row, const QModelIndex &parent) const override;
+	virtual bool lessThan (const QModelIndex &left, const QModelIndex &right) const override;
+};
 
-	void update_player (const Player &p) { m_p = p; ownRepaint (); emitDataChanged (); }
-	Player get_player () const { return m_p; }
-	void ownRepaint();
-	void replace() ;
+class PlayerTable : public QTreeView
+{
+	Q_OBJECT
 
-	virtual QVariant data (int column, int role) const override;
-	virtual bool operator< (const QTreeWidgetItem &other) const override;
-private:
-	void set_foreground (const QBrush &col)
+	PlayerTableModel m_model;
+	PlayerTableProxy m_proxy;
+
+public:
+	PlayerTable(QWidget* parent = 0);
+	~PlayerTable();
+	void showOpen(bool show);
+
+	bool find_player (const QString &name, Player &p) const { return m_model.find_player (name, p); }
+	bool contains (const QString &name) const { return m_model.contains (name); }
+	// add a new player, or replace the entry of a known one
+	void set_player (const Player &p) { m_model.set_player (p); }
+	// record the game a player is playing in, "-" for none
+	void set_game (const QString &name, const QString &game) { m_model.set_game (name, game); }
+	bool remove_player (const QString &name) { return m_model.remove_player (name); }
+	void clear_players () { m_model.clear_players (); }
+	void begin_batch () { m_model.begin_batch (); }
+	void end_batch () { m_model.end_batch (); }
+
+	// name of the player shown at point P, or a null string
+	QString player_at (const QPoint &p) const;
+
+	void resize_columns ()
 	{
-		QBrush b (col);
+#if 0
 		for (int i = 0; i < columnCount (); i++)
-			setForeground (i, b);
+			resizeColumnToContents (i);
+#endif
 	}
 
-protected:
-//	virtual QString key(int, bool) const;
-//	virtual bool operator<(const QListWidgetItem *other) const;
-//	virtual void paintCell(QPainter *p, const QColorGroup &cg, int column, int width, int alignment);
-
-	bool open;
-	bool watched;
-	bool exclude;
-	bool its_me;
-	bool seeking;
+private:
+	void mouseDoubleClickEvent(QMouseEvent *e);
+
+public slots:
+	virtual void slot_mouse_players(const QPoint&) {};
+
+ signals:
+	void signal_doubleClicked (const QString &);
 };
 
 #endif // PLAYERTABLE_H
@@ -175,6 +175,8 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 	LineEdit_port->setValidator (new QIntValidator (0, 9999, this));
 	anMaxMovesEdit->setValidator (new QIntValidator (0, 999, this));
 	anDepthEdit->setValidator (new QIntValidator (0, 999, this));
+	anCacheVisitsEdit->setValidator (new QIntValidator (0, 10000000, this));
+	anUpdateEdit->setValidator (new QIntValidator (0, 5000, this));
 	slideXEdit->setValidator (new QIntValidator (100, 9999, this));
 	slideYEdit->setValidator (new QIntValidator (100, 9999, this));
 
@@ -194,7 +196,6 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 	int w = stoneView->width ();
 	int h = stoneView->height ();
 	m_stone_size = std::min (w / 2, h);
-	m_ih->init (5);
 	m_stone_canvas = new QGraphicsScene(0, 0, w, h, stoneView);
 	stoneView->setScene (m_stone_canvas);
 	m_b_stone = new QGraphicsPixmapItem;
@@ -233,6 +234,7 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 
 	connect (GobanPicturePathButton, &QToolButton::clicked, this, &PreferencesDialog::slot_getGobanPicturePath);
 	connect (TablePicturePathButton, &QToolButton::clicked, this, &PreferencesDialog::slot_getTablePicturePath);
+	connect (ArchiveDirButton, &QPushButton::clicked, this, &PreferencesDialog::slot_getArchiveDir);
 
 	update_dbpaths (setting->m_dbpaths);
 	dbPathsListView->setModel (&m_dbpath_model);
@@ -478,6 +480,8 @@ void PreferencesDialog::init_from_settings ()
 	LineEdit_watch->setText(setting->readEntry("WATCH"));
 	LineEdit_exclude->setText(setting->readEntry("EXCLUDE"));
 	CheckBox_extUserInfo->setChecked(setting->readBoolEntry("EXTUSERINFO"));
+	CheckBox_incrementalLists->setChecked(setting->readBoolEntry("INCREMENTAL_LISTS"));
+	CheckBox_observeDashboard->setChecked(setting->readBoolEntry("OBSERVE_DASHBOARD"));
 //	CheckBox_useNmatch->setChecked(setting->readBoolEntry("USE_NMATCH"));
 	checkBox_Nmatch_Black->setChecked(setting->readBoolEntry("NMATCH_BLACK"));
 	checkBox_Nmatch_White->setChecked(setting->readBoolEntry("NMATCH_WHITE"));
@@ -498,6 +502,9 @@ void PreferencesDialog::init_from_settings ()
 	winrateComboBox->setCurrentIndex (setting->readIntEntry ("ANALYSIS_WINRATE"));
 	anDepthEdit->setText (QString::number (setting->readIntEntry ("ANALYSIS_DEPTH")));
 	anMaxMovesEdit->setText (QString::number (setting->readIntEntry ("ANALYSIS_MAXMOVES")));
+	anCacheCheckBox->setChecked (setting->readBoolEntry ("ANALYSIS_CACHE"));
+	anCacheVisitsEdit->setText (QString::number (setting->readIntEntry ("ANALYSIS_CACHE_VISITS")));
+	anUpdateEdit->setText (QString::number (setting->readIntEntry ("ANALYSIS_UPDATE_MS")));
 
 	// Go Server tab
 	boardSizeSpin->setValue(setting->readIntEntry("DEFAULT_SIZE"));
@@ -507,6 +514,7 @@ void PreferencesDialog::init_from_settings ()
 	automaticNegotiationCheckBox->setChecked(setting->readBoolEntry("DEFAULT_AUTONEGO"));
 	CheckBox_autoSave->setChecked(setting->readBoolEntry("AUTOSAVE"));
 	CheckBox_autoSave_Played->setChecked(setting->readBoolEntry("AUTOSAVE_PLAYED"));
+	LineEdit_archiveDir->setText(setting->readEntry("ARCHIVE_DIR"));
 
 	toroidDupsSpin->setValue (setting->readIntEntry("TOROID_DUPS"));
 
@@ -763,6 +771,8 @@ void PreferencesDialog::slot_apply()
 	setting->writeEntry("WATCH", LineEdit_watch->text());
 	setting->writeEntry("EXCLUDE", LineEdit_exclude->text());
 	setting->writeBoolEntry("EXTUSERINFO", CheckBox_extUserInfo->isChecked());
+	setting->writeBoolEntry("INCREMENTAL_LISTS", CheckBox_incrementalLists->isChecked());
+	setting->writeBoolEntry("OBSERVE_DASHBOARD", CheckBox_observeDashboard->isChecked());
 //	setting->writeBoolEntry("USE_NMATCH", CheckBox_useNmatch->isChecked());
 
 	//Checks wether the nmatch parameters have been modified, in order to send a new nmatchrange command
@@ -791,6 +801,7 @@ void PreferencesDialog::slot_apply()
 	setting->writeBoolEntry("DEFAULT_AUTONEGO", automaticNegotiationCheckBox->isChecked());
 	setting->writeBoolEntry("AUTOSAVE", CheckBox_autoSave->isChecked());
 	setting->writeBoolEntry("AUTOSAVE_PLAYED", CheckBox_autoSave_Played->isChecked());
+	setting->writeEntry("ARCHIVE_DIR", LineEdit_archiveDir->text());
 
 	// Computer Tab
 	setting->writeBoolEntry("COMPUTER_WHITE", computerWhiteButton->isChecked());
@@ -806,6 +817,9 @@ void PreferencesDialog::slot_apply()
 
 	setting->writeIntEntry ("ANALYSIS_DEPTH", anDepthEdit->text().toInt());
 	setting->writeIntEntry ("ANALYSIS_MAXMOVES", anMaxMovesEdit->text().toInt());
+	setting->writeBoolEntry ("ANALYSIS_CACHE", anCacheCheckBox->isChecked ());
+	setting->writeIntEntry ("ANALYSIS_CACHE_VISITS", anCacheVisitsEdit->text().toInt());
+	setting->writeIntEntry ("ANALYSIS_UPDATE_MS", anUpdateEdit->text().toInt());
 
 	setting->writeIntEntry("GAMETREE_SIZE", gameTreeSizeSlider->value());
 	setting->writeIntEntry("BOARD_DIAGMODE", diagShowComboBox->currentIndex());
@@ -1141,6 +1155,18 @@ void PreferencesDialog::slot_getComputerPath()
   	enginePath->setText(fileName);
 }
 
+void PreferencesDialog::slot_getArchiveDir()
+{
+	QString dir = LineEdit_archiveDir->text ();
+	if (dir.isEmpty ())
+		dir = setting->readEntry ("LAST_DIR");
+	dir = QFileDialog::getExistingDirectory (this, tr ("Choose a directory for saved games"), dir);
+	if (dir.isEmpty ())
+		return;
+
+	LineEdit_archiveDir->setText (dir);
+}
+
 void PreferencesDialog::slot_getGobanPicturePath()
 {
 #if defined(Q_OS_MACX)
@@ -113,6 +113,7 @@ public slots:
 	void slot_serverChanged (const QString &);
 	void slot_engineChanged (const QString &);
 	void slot_getComputerPath ();
+	void slot_getArchiveDir ();
 	void slot_getGobanPicturePath ();
 	void slot_getTablePicturePath ();
 	void slot_main_time_changed (int);
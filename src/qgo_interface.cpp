@@ -14,6 +14,8 @@
 #include "config.h"
 #include "clientwin.h"
 #include "ui_helpers.h"
+#include "dashboard.h"
+#include "gamearchive.h"
 
 #include <qstring.h>
 #include <qtimer.h>
@@ -91,20 +93,35 @@ qGoIF::qGoIF(QWidget *p) : QObject()
 	qgobrd = 0;
 	gsName = GS_UNKNOWN;
 	localBoardCounter = 10000;
+
+	// archive the games a crashed client could not finish
+	GameArchive::instance ()->recover (GameArchive::archive_dir ());
 }
 
 qGoIF::~qGoIF()
 {
+	delete m_dashboard;
 	delete qgo;
 }
 
 qGoBoard *qGoIF::find_game_id (int id)
 {
-	for (auto qb: boardlist)
-		if (qb->get_id() == id) {
-			return qb;
-		}
-	return nullptr;
+	return board_ids.value (id, nullptr);
+}
+
+// keep board_ids in step with a board's game number
+void qGoIF::board_renumbered (qGoBoard *qb, int old_id)
+{
+	if (board_ids.remove (old_id, qb) > 0)
+		board_ids.insert (qb->get_id (), qb);
+}
+
+// the window showing thumbnails of observed games, created when first needed
+ObserveDashboard *qGoIF::dashboard ()
+{
+	if (m_dashboard == nullptr)
+		m_dashboard = new ObserveDashboard ();
+	return m_dashboard;
 }
 
 qGoBoard *qGoIF::find_game_players (const QString &pl1, const QString &pl2)
@@ -378,13 +395,7 @@ bool qGoIF::parse_move(int src, GameInfo* gi, Game* g, QString txt)
 	if (!qgobrd || qgobrd->get_id() != game_id)
 	{
 		// seek dialog
-		qgobrd = nullptr;
-		for (auto b: boardlist) {
-			if (b->get_id () == game_id) {
-				qgobrd = b;
-				break;
-			}
-		}
+		qgobrd = find_game_id (game_id);
 		// not found -> create new dialog
 		if (!qgobrd)
 		{
@@ -397,6 +408,7 @@ bool qGoIF::parse_move(int src, GameInfo* gi, Game* g, QString txt)
 
 			qgobrd = new qGoBoard (this, game_id);
 			boardlist.append(qgobrd);
+			board_ids.insert (game_id, qgobrd);
 
 //			qgobrd->get_win()->setOnlineMenu(true);
 
@@ -577,6 +589,7 @@ void qGoIF::set_initIF()
 		b->disconnected (false);
 	}
 	boardlist.clear ();
+	board_ids.clear ();
 
 	// set number of observed games to 0
 	emit signal_addToObservationList(0);
@@ -595,12 +608,12 @@ void qGoIF::slot_matchcreate(const QString &gameno, const QString &opponent)
 void qGoIF::slot_matchsettings(const QString &id, const QString &handicap, const QString &komi, assessType kt)
 {
 	// seek board
-	for (auto b: boardlist)
-		if (b->get_id() == id.toInt()) {
-			b->set_requests(handicap, komi, kt);
-			qDebug() << QString("qGoIF::slot_matchsettings: h=%1, k=%2, kt=%3").arg(handicap).arg(komi).arg(kt);
-			return;
-		}
+	qGoBoard *b = find_game_id (id.toInt ());
+	if (b) {
+		b->set_requests(handicap, komi, kt);
+		qDebug() << QString("qGoIF::slot_matchsettings: h=%1, k=%2, kt=%3").arg(handicap).arg(komi).arg(kt);
+		return;
+	}
 
 	qWarning("BOARD CORRESPONDING TO GAME SETTINGS NOT FOUND !!!");
 }
@@ -680,11 +693,9 @@ void qGoIF::slot_komi(const QString &nr, const QString &komi, bool isrequest)
 	else
 	{
 		// title message follows to move message
-		for (auto b: boardlist)
-			if (b->get_id () == nr.toInt ()) {
-				b->set_komi (komi);
-				break;
-			}
+		qb = find_game_id (nr.toInt ());
+		if (qb)
+			qb->set_komi (komi);
 	}
 
 }
@@ -706,6 +717,7 @@ void qGoIF::slot_freegame(bool freegame)
 void qGoIF::remove_board (qGoBoard *qb)
 {
 	boardlist.removeOne (qb);
+	board_ids.remove (qb->get_id (), qb);
 }
 
 // board window closed...
@@ -905,12 +917,9 @@ void qGoIF::slot_removestones(const QString &pt, const QString &game_id)
 	{
 qDebug("slot_removestones(): game_id");
 		// multi match mode, e.g. IGS
-		for (auto b: boardlist)
-			if (b->get_id () == game_id.toInt ()) {
-				qb = b;
-				qb->enter_scoring_mode (false);
-				break;
-			}
+		qb = find_game_id (game_id.toInt ());
+		if (qb)
+			qb->enter_scoring_mode (false);
 	}
 
 	if (!qb)
@@ -979,6 +988,8 @@ void qGoBoard::remote_undo (const QString &)
 	{
 		dec_mv_counter();
 		win->getBoard ()->deleteNode ();
+		if (m_journal != nullptr)
+			m_journal->add_undo ();
 		return;
 	}
 
@@ -1108,11 +1119,23 @@ qGoBoard::~qGoBoard()
 	qDebug("~qGoBoard()");
 	if (m_connected)
 		m_qgoif->remove_board (this);
+	delete m_thumb;
+	if (m_journal != nullptr && m_game != nullptr)
+		m_journal->archive (*m_game);
+	delete m_journal;
 	delete win;
 	delete m_title;
 	delete m_scoring_board;
 }
 
+void qGoBoard::set_id (int i)
+{
+	int old_id = id;
+	id = i;
+	if (m_connected)
+		m_qgoif->board_renumbered (this, old_id);
+}
+
 void qGoBoard::observer_list_start ()
 {
 	if (win) {
@@ -1152,6 +1175,7 @@ void qGoBoard::observer_list_end ()
 
 void qGoBoard::receive_score_begin ()
 {
+	flush_moves ();
 	m_scoring_board = new go_board (m_state->get_board ());
 }
 
@@ -1191,15 +1215,24 @@ void qGoBoard::receive_score_line (int n, const QString &line)
 /* Called when we have game info and all the moves up to this point.  */
 void qGoBoard::game_startup ()
 {
+	flush_moves ();
 	bool am_black = m_own_color == black;
 	bool am_white = m_own_color == white;
+	// observed games can go to the dashboard instead; their windows follow the
+	// game without drawing anything until the user opens them from there
+	bool to_dashboard = gameMode == modeObserve && setting->readBoolEntry ("OBSERVE_DASHBOARD");
 	win = new MainWindow_IGS (0, m_game, screen_key (client_window), this, am_white, am_black, gameMode);
-	win->show ();
+	if (to_dashboard)
+		win->getBoard ()->set_defer_while_hidden (true);
+	else
+		win->show ();
 	win->set_observer_model (&m_observers);
 
 	game_state *root = m_game->get_root ();
 	if (root != m_state)
 		root->transfer_observers (m_state);
+	if (to_dashboard)
+		m_thumb = m_qgoif->dashboard ()->add_game (m_game, m_state, win);
 
 	// disable some Menu items
 //	win->setOnlineMenu(true);
@@ -1308,6 +1341,12 @@ void qGoBoard::set_game(Game *g, GameMode mode, stone_color own_color)
 	set_Mode_real (mode);
 	m_own_color = own_color;
 
+	if (setting->readBoolEntry (gameMode == modeObserve ? "AUTOSAVE" : "AUTOSAVE_PLAYED"))
+	{
+		delete m_journal;
+		m_journal = new GameJournal (*m_game, GameArchive::archive_dir ());
+	}
+
 	if (stated_mv_count == 0)
 		game_startup ();
 }
@@ -1550,6 +1589,8 @@ void qGoBoard::set_move(stone_color sc, QString pt, QString mv_nr)
 			go_board new_root = new_handicap_board (m_game->boardsize (), 0);
 			m_game->replace_root (new_root, black);
 			m_game->set_handicap (0);
+			if (m_journal != nullptr)
+				m_journal->set_handicap (0);
 			qDebug("set Handicap to 0");
 		}
 
@@ -1571,6 +1612,7 @@ void qGoBoard::set_move(stone_color sc, QString pt, QString mv_nr)
 
 	if (pt.contains("Handicap"))
 	{
+		flush_moves ();
 		QString handi = pt.simplified();
 		int h = handi.section(' ', 1, 1).toInt();
 
@@ -1581,17 +1623,26 @@ void qGoBoard::set_move(stone_color sc, QString pt, QString mv_nr)
 			m_game->set_handicap (QString::number(h).toStdString());
 			go_board new_root = new_handicap_board (m_game->boardsize (), h);
 			m_game->replace_root (new_root, h > 1 ? white : black);
+			if (m_journal != nullptr)
+				m_journal->set_handicap (h);
 			qDebug("corrected Handicap");
 		}
 	}
 	else if (pt.contains("Pass", Qt::CaseInsensitive))
 	{
 		qDebug () << "pass found\n";
-		game_state *st = m_state;
-		game_state *new_st = m_state->add_child_pass ();
-		st->transfer_observers (new_st);
-		if (win != nullptr)
-			win->playPassSound();
+		if (replaying_move_list ())
+			m_pending_moves.push_back ({ sc, -1, -1 });
+		else {
+			flush_moves ();
+			game_state *st = m_state;
+			game_state *new_st = m_state->add_child_pass ();
+			st->transfer_observers (new_st);
+			if (m_journal != nullptr)
+				m_journal->add_pass (sc);
+			if (win != nullptr)
+				win->playPassSound();
+		}
 	}
 	else
 	{
@@ -1617,12 +1668,27 @@ void qGoBoard::set_move(stone_color sc, QString pt, QString mv_nr)
 		else
 			j = m_game->boardsize () + 1 - pt[1].digitValue();
 
+		if (replaying_move_list ())
+		{
+			m_pending_moves.push_back ({ sc, i - 1, j - 1 });
+			return;
+		}
+		flush_moves ();
+
 		game_state *st = m_state;
 		game_state *st_new = st->add_child_move (i - 1, j - 1, sc, game_state::add_mode::set_main);
 		if (st_new != nullptr) {
 			st->transfer_observers (st_new);
+			if (m_journal != nullptr)
+				m_journal->add_move (sc, i - 1, j - 1);
 			if (win != nullptr)
 				win->playClick ();
+		} else if (st->was_move_p () && st->get_move_color () == sc
+			   && st->get_move_x () == i - 1 && st->get_move_y () == j - 1) {
+			/* The server's echo of our own move, which the board already added
+			   before sending it.  */
+			if (m_journal != nullptr)
+				m_journal->add_move (sc, i - 1, j - 1);
 		} else {
 			/* @@@ do something sensible.  */
 		}
@@ -1635,6 +1701,40 @@ void qGoBoard::set_move(stone_color sc, QString pt, QString mv_nr)
 		game_startup ();
 }
 
+/* Add the collected moves of a move list to the main line.  They were checked
+   by the server, so they are played on one working board and appended without
+   the validity, ko and duplicate checks of add_child_move; the observers of
+   the old position (this board, and its window if there is one) are moved
+   once, to the last position.  */
+void qGoBoard::flush_moves ()
+{
+	if (m_pending_moves.empty ())
+		return;
+
+	game_state *st = m_state;
+	go_board b (st->get_board (), mark::none);
+	QByteArray journal;
+	for (auto &m: m_pending_moves) {
+		if (m.x < 0) {
+			st = st->add_child_pass_nochecks (b, game_state::add_mode::set_main);
+			journal += GameJournal::pass_line (m.col);
+			continue;
+		}
+		if (b.stone_at (m.x, m.y) != none) {
+			qWarning ("*** move list does not match the board, dropping the rest ***");
+			break;
+		}
+		b.add_stone (m.x, m.y, m.col);
+		st = st->add_child_move_nochecks (b, m.col, m.x, m.y, game_state::add_mode::set_main);
+		journal += GameJournal::move_line (m.col, m.x, m.y);
+	}
+	m_pending_moves.clear ();
+	if (m_journal != nullptr)
+		m_journal->append (journal);
+	if (st != m_state)
+		m_state->transfer_observers (st);
+}
+
 // board window closed
 void qGoBoard::slot_closeevent()
 {
@@ -1642,7 +1742,7 @@ void qGoBoard::slot_closeevent()
 	win = 0;
 	if (id > 0)
 	{
-		id = -id;
+		set_id (-id);
 		m_qgoif->window_closing (this);
 //		emit signal_closeevent(id);
 	}
@@ -1652,6 +1752,12 @@ void qGoBoard::slot_closeevent()
 
 void qGoBoard::disconnected (bool remove_from_list)
 {
+	flush_moves ();
+	// no more moves will come; archive what was seen of the game
+	if (m_journal != nullptr)
+		m_journal->archive (*m_game);
+	delete m_journal;
+	m_journal = nullptr;
 	if (remove_from_list && m_connected)
 		m_qgoif->remove_board (this);
 	m_connected = false;
@@ -1822,20 +1928,18 @@ void qGoBoard::move_played (int x, int y)
 
 void qGoBoard::game_result (const QString &rs, const QString &extended_rs)
 {
+	flush_moves ();
 	m_game->set_result (rs.toStdString ());
 	send_kibitz(rs);
-	bool autosave = setting->readBoolEntry (gameMode == modeObserve ? "AUTOSAVE" : "AUTOSAVE_PLAYED");
 
-	/* Note that win can be null - observing a game just as it ends may cause the
+	/* The game is archived when disconnected below closes its journal.
+	   Note that win can be null - observing a game just as it ends may cause the
 	   server to send a result without moves (or maybe before, but that is still unclear).  */
-	if (autosave && win)
-	{
-		win->doSave("", true);
-		qDebug("Game saved");
-	}
+	if (m_journal != nullptr)
+		m_journal->set_result (rs.toStdString ());
 
 	GameMode prev_mode = gameMode;
-	id = -id;
+	set_id (-id);
 
 	disconnected (true);
 
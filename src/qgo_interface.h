@@ -13,6 +13,10 @@
 #include <QString>
 #include <QTimerEvent>
 #include <QStandardItemModel>
+#include <QMultiHash>
+#include <QPointer>
+
+#include <vector>
 
 #include "tables.h"
 #include "defines.h"
@@ -54,6 +58,9 @@ public:
 
 class MainWindow_IGS;
 class qGoIF;
+class DashboardEntry;
+class ObserveDashboard;
+class GameJournal;
 
 class qGoBoard : public QObject, public game_state::observer
 {
@@ -70,6 +77,18 @@ class qGoBoard : public QObject, public game_state::observer
 	/* State used while receiving a game result.  */
 	go_board *m_scoring_board = nullptr;
 
+	/* Moves from the move list of a game we just joined, collected until the
+	   list is complete and then added in one go by flush_moves.  X is -1 for
+	   a pass.  */
+	struct pending_move
+	{
+		stone_color col;
+		int x, y;
+	};
+	std::vector<pending_move> m_pending_moves;
+	void flush_moves ();
+	bool replaying_move_list () { return win == nullptr && mv_counter + 1 < stated_mv_count; }
+
 	QStandardItemModel m_observers;
 
 	virtual void observed_changed () override { }
@@ -83,7 +102,7 @@ public:
 	void game_startup ();
 	void disconnected (bool remove_from_list);
 	int get_id() const { return id; }
-	void set_id(int i) { id = i; }
+	void set_id(int i);
 	void set_title(const QString&);
 	void set_komi(const QString&);
 	void set_freegame(bool);
@@ -187,6 +206,10 @@ private:
 	GameMode gameMode;
 	int id;
 	MainWindow_IGS *win;
+	// thumbnail in the observation dashboard, if the game is shown there
+	QPointer<DashboardEntry> m_thumb;
+	// written while the game runs and archived when it ends, if autosave is on
+	GameJournal *m_journal = nullptr;
 
 	int mv_counter;
 	int stated_mv_count;
@@ -229,6 +252,8 @@ public:
 
 	void window_closing (qGoBoard *);
 	void remove_board (qGoBoard *);
+	void board_renumbered (qGoBoard *, int old_id);
+	ObserveDashboard *dashboard ();
 
 	/* Called by parser.cpp.  */
 	void observer_list_start (int);
@@ -276,6 +301,9 @@ private:
 	qGoBoard *qgobrd;
 	QString  myName;
 	QList<qGoBoard *> boardlist;
+	// the boards in boardlist by game number; adjourned games may share one
+	QMultiHash<int, qGoBoard *> board_ids;
+	ObserveDashboard *m_dashboard = nullptr;
 	GSName   gsName;
 	int      localBoardCounter;
 //	int      lockObserveCmd;
@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include <QProcess>
+#include <QTimer>
 
 #include "qgo.h"
 #include "setting.h"
@@ -239,6 +242,8 @@ void GTP_Process::undo_move ()
 	game_state *st = m_last_move;
 	if (st != nullptr) {
 		m_last_move = st->prev_move ();
+		if (st == m_moves)
+			m_moves = nullptr;
 		delete st;
 	}
 }
@@ -250,35 +255,69 @@ static stone_color maybe_flip (stone_color col, bool flip)
 	return flip_color (col);
 }
 
+/* Compare a board from our mirror of the engine state against a requested position,
+   taking into account that the requested position may have its colors swapped.  */
+static bool engine_position_equal_p (const go_board &ours, const go_board &req, bool flip)
+{
+	if (!flip)
+		return ours.position_equal_p (req);
+	if (ours.size_x () != req.size_x () || ours.size_y () != req.size_y ())
+		return false;
+	return ours.get_stones_b () == req.get_stones_w () && ours.get_stones_w () == req.get_stones_b ();
+}
+
 void GTP_Process::dup_move (game_state *from, bool flip)
 {
 	stone_color c = maybe_flip (from->get_move_color (), flip);
 	played_move (c, from->get_move_x (), from->get_move_y ());
 }
 
-void GTP_Process::setup_board (game_state *st, double km, bool flip)
+/* Try to bring the engine to the requested position by undoing the moves that
+   differ from it and playing the new ones, which is much cheaper than a full setup
+   when stepping through a game.  MOVES holds the moves leading from STARTPOS to the
+   requested position in reverse order.
+   Returns false if the engine state is unrelated to the requested position, or if
+   a full setup would be cheaper.  */
+bool GTP_Process::sync_incremental (const go_board &startpos, stone_color to_move,
+				    const std::vector<game_state *> &moves, bool flip)
 {
-	const go_board &b = st->get_board ();
+	if (m_moves == nullptr || m_last_move == nullptr)
+		return false;
+	if (m_moves->to_move () != to_move || !engine_position_equal_p (m_moves->get_board (), startpos, flip))
+		return false;
 
-	/* Check for shortcuts.
-	   @@@ Should handle flip as well, but need to do something about position_equal_p.  */
-	if (m_last_move != nullptr && !flip) {
-		game_state *st_parent = st->prev_move ();
-		if (st->was_move_p () && st_parent->get_board ().position_equal_p (m_last_move->get_board ())) {
-			dup_move (st, flip);
-			return;
-		}
-		game_state *our_parent = m_last_move->prev_move ();
-		if (our_parent != nullptr && our_parent->get_board ().position_equal_p (st->get_board ())) {
-			undo_move ();
-			return;
-		}
+	std::vector<game_state *> ours;
+	for (game_state *st = m_last_move; st != m_moves; st = st->prev_move ())
+		ours.push_back (st);
+
+	size_t common = 0;
+	while (common < ours.size () && common < moves.size ()) {
+		game_state *a = ours[ours.size () - 1 - common];
+		game_state *b = moves[moves.size () - 1 - common];
+		if (a->get_move_x () != b->get_move_x () || a->get_move_y () != b->get_move_y ()
+		    || a->get_move_color () != maybe_flip (b->get_move_color (), flip))
+			break;
+		common++;
 	}
+	size_t n_undo = ours.size () - common;
+	size_t n_play = moves.size () - common;
+	size_t full_cost = startpos.get_stones_b ().popcnt () + startpos.get_stones_w ().popcnt () + moves.size () + 1;
+	if (n_undo + n_play > full_cost)
+		return false;
 
-	/* Must clear this before doing played_move calls for the initial setup.  */
-	delete m_moves;
-	m_moves = nullptr;
-	m_last_move = nullptr;
+	while (n_undo-- > 0)
+		undo_move ();
+	for (size_t i = n_play; i-- > 0;) {
+		if (stopped ())
+			return true;
+		dup_move (moves[i], flip);
+	}
+	return true;
+}
+
+void GTP_Process::setup_board (game_state *st, double km, bool flip)
+{
+	const go_board &b = st->get_board ();
 
 	std::vector<game_state *> moves;
 	while (st->was_move_p () && !st->root_node_p ()) {
@@ -286,23 +325,40 @@ void GTP_Process::setup_board (game_state *st, double km, bool flip)
 		st = st->prev_move ();
 	}
 	const go_board &startpos = st->get_board ();
+	stone_color start_to_move = maybe_flip (st->to_move (), flip);
+
+	if (sync_incremental (startpos, start_to_move, moves, flip)) {
+		komi (km);
+		return;
+	}
+
+	/* Must clear this before doing played_move calls for the initial setup.  */
+	delete m_moves;
+	m_moves = nullptr;
+	m_last_move = nullptr;
 
 	clear_board ();
 	komi (km);
 
+	go_board engine_start (startpos, none);
 	for (int i = 0; i < b.size_x (); i++)
 		for (int j = 0; j < b.size_y (); j++) {
 			/* This gives better behavior if the GTP process dies or misbehaves.  */
 			if (stopped ())
 				return;
 			stone_color c = maybe_flip (startpos.stone_at (i, j), flip);
-			if (c != none)
+			if (c != none) {
 				played_move (c, i, j);
+				engine_start.set_stone (i, j, c);
+			}
 		}
+	engine_start.identify_units ();
 
 	/* Allocate this here so that m_last_move is nullptr during previous calls to
-	   played_move and they don't try to track the position.  */
-	m_moves = new game_state (startpos, maybe_flip (st->to_move (), flip));
+	   played_move and they don't try to track the position.
+	   The tree mirrors the engine, so it holds the position with colors swapped
+	   if we are flipping.  */
+	m_moves = new game_state (engine_start, start_to_move);
 	m_last_move = m_moves;
 
 	while (!moves.empty ()) {
@@ -497,29 +553,83 @@ analyzer GTP_Eval_Controller::analyzer_state ()
 	return analyzer::running;
 }
 
-void GTP_Eval_Controller::request_analysis (go_game_ptr gr, game_state *st, bool flip)
+void GTP_Eval_Controller::request_analysis (go_game_ptr gr, game_state *st, bool flip, int job_visits)
 {
 	if (analyzer_state () != analyzer::running)
 		return;
 
 	initiate_switch ();
+	store_cached_eval ();
 
 	const go_board &b = st->get_board ();
 	stone_color to_move = st->to_move ();
 	delete m_eval_state;
 	m_eval_state = new game_state (b, to_move);
 
-	m_analyzer->setup_board (st, QString::fromStdString(gr->komi ()).toDouble(), flip);
+	double km = QString::fromStdString(gr->komi ()).toDouble();
+	m_last_request_flipped = flip;
+	m_request_serial++;
+
+	/* Find the komi the engine will actually use, as seen from the requested
+	   position rather than the possibly flipped one we send.  */
+	m_cache_id = m_id;
+	if (flip)
+		m_cache_id.komi = -m_cache_id.komi;
+	double eff_komi = m_id.komi_set ? m_cache_id.komi : flip ? -km : km;
+	m_cache_key = eval_cache::make_key (st, eff_komi, gr->rules (), m_id.engine);
+	m_cache_store = analysis_cache != nullptr && setting->readBoolEntry ("ANALYSIS_CACHE");
+	m_cached_result = false;
+
+	eval_cache::result res;
+	int min_visits = std::max ({ 1, job_visits, setting->readIntEntry ("ANALYSIS_CACHE_VISITS") });
+	if (m_cache_store && analysis_cache->lookup (m_cache_key, min_visits, m_eval_state, m_cache_id, res)) {
+		m_cached_result = true;
+		/* Deliver the result from the event loop, as callers do not expect to be
+		   called back recursively.  Using the analyzer as context ensures nothing
+		   happens if it is deleted in the meantime.  */
+		int serial = m_request_serial;
+		QTimer::singleShot (0, m_analyzer, [this, serial, res] () { deliver_cached_eval (serial, res); });
+		return;
+	}
+
+	m_analyzer->setup_board (st, km, flip);
 
 	if (flip)
 		to_move = flip_color (to_move);
 
-	m_last_request_flipped = flip;
-	m_analyzer->analyze (to_move, 100);
+	m_analyzer->analyze (to_move, m_analysis_interval);
+}
+
+void GTP_Eval_Controller::deliver_cached_eval (int serial, const eval_cache::result &res)
+{
+	if (serial != m_request_serial || m_eval_state == nullptr || !m_cached_result)
+		return;
+
+	const go_board &b = m_eval_state->get_board ();
+	QString move = "pass";
+	if (res.x >= 0) {
+		auto cname = b.coords_name (res.x, res.y, false);
+		move = QString::fromStdString (cname.first + cname.second);
+	}
+	eval ev = m_eval_state->eval_from (m_cache_id, true);
+	m_primary_eval = m_eval_state->to_move () == white ? 1 - ev.wr_black : ev.wr_black;
+	notice_analyzer_id (m_cache_id, res.have_score);
+	eval_received (move, res.visits, res.have_score);
+}
+
+/* Called before discarding the current evaluation data, to remember it in the
+   analysis cache.  */
+void GTP_Eval_Controller::store_cached_eval ()
+{
+	if (m_eval_state == nullptr || !m_cache_store || m_cached_result)
+		return;
+	analysis_cache->store (m_cache_key, m_eval_state, m_cache_id);
+	m_cache_store = false;
 }
 
 void GTP_Eval_Controller::clear_eval_data ()
 {
+	store_cached_eval ();
 	delete m_eval_state;
 	m_eval_state = nullptr;
 }
@@ -5,6 +5,7 @@
 
 #include "goboard.h"
 #include "goeval.h"
+#include "evalcache.h"
 #include "setting.h"
 #include "textview.h"
 
@@ -65,6 +66,24 @@ protected:
 	double m_primary_eval;
 	game_state *m_eval_state {};
 
+	/* Interval between analysis updates requested from the engine, in centiseconds.  */
+	int m_analysis_interval = 100;
+
+	/* Describes where the analysis of m_eval_state should be stored in the
+	   analysis cache.  */
+	eval_cache::key m_cache_key;
+	analyzer_id m_cache_id;
+	bool m_cache_store = false;
+	/* Set if the current evaluation was taken from the cache rather than
+	   produced by the engine.  */
+	bool m_cached_result = false;
+	/* Incremented for every request, so that we can discard delayed delivery
+	   of cached results for positions that are no longer wanted.  */
+	int m_request_serial = 0;
+
+	void store_cached_eval ();
+	void deliver_cached_eval (int serial, const eval_cache::result &);
+
 	void clear_eval_data ();
 
 	void start_analyzer (const Engine &engine, int size, double komi, bool show_dialog = true);
@@ -72,7 +91,9 @@ protected:
 	void pause_eval_updates (bool on) { m_pause_updates = on; }
 	bool pause_analyzer (bool on, go_game_ptr, game_state *);
 	void initiate_switch ();
-	void request_analysis (go_game_ptr, game_state *, bool flip = false);
+	/* A cached result is used only if it has at least JOB_VISITS visits, and at least
+	   as many as ANALYSIS_CACHE_VISITS asks for.  */
+	void request_analysis (go_game_ptr, game_state *, bool flip = false, int job_visits = 0);
 	virtual void eval_received (const QString &, int, bool) = 0;
 	virtual void analyzer_state_changed () { }
 	virtual void notice_analyzer_id (const analyzer_id &, bool) { }
@@ -136,6 +157,7 @@ class GTP_Process : public QProcess
 	void internal_quit ();
 	void default_err_receiver (const QString &);
 	void dup_move (game_state *, bool);
+	bool sync_incremental (const go_board &, stone_color, const std::vector<game_state *> &, bool);
 	void append_text (const QString &, const QColor &col);
 
 public slots:
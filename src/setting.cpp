@@ -124,6 +124,9 @@ Setting::Setting()
 	writeBoolEntry("ANALYSIS_PRUNE", 1);
 	writeBoolEntry("ANALYSIS_CHILDREN", 1);
 	writeBoolEntry("ANALYSIS_HIDEOTHER", 1);
+	writeBoolEntry("ANALYSIS_CACHE", 1);
+	writeIntEntry("ANALYSIS_CACHE_VISITS", 1000);
+	writeIntEntry("ANALYSIS_UPDATE_MS", 100);
 
 	writeIntEntry ("GAMETREE_SIZE", 30);
 	writeBoolEntry ("GAMETREE_DIAGHIDE", 1);
@@ -484,6 +487,7 @@ void Setting::extract_frequent_settings ()
 	values.analysis_children = readBoolEntry ("ANALYSIS_CHILDREN");
 	values.analysis_vartype = readIntEntry ("ANALYSIS_VARTYPE");
 	values.analysis_winrate = readIntEntry ("ANALYSIS_WINRATE");
+	values.analysis_update_ms = readIntEntry ("ANALYSIS_UPDATE_MS");
 
 	values.gametree_diaghide = readBoolEntry ("GAMETREE_DIAGHIDE");
 	values.gametree_size = readIntEntry ("GAMETREE_SIZE");
@@ -68,6 +68,7 @@ struct setting_vals
 	bool analysis_children;
 	int analysis_vartype;
 	int analysis_winrate;
+	int analysis_update_ms;
 
 	int gametree_diaghide;
 	int gametree_size;
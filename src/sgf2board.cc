@@ -814,12 +814,13 @@ void game_state::append_to_sgf (std::string &s) const
 				s += "[" + std::to_string (it.visits) + ":" + std::to_string (it.wr_black);
 				if (have_scores)
 					s += ":" + std::to_string (it.score_mean) + ":" + std::to_string (it.score_stddev);
-				if (it.id.komi_set) {
-					s += ":" + std::to_string (it.id.komi);
-					if (it.id.engine.length () > 0)
-						s += ":" + it.id.engine;
-				} else if (it.id.engine.length () > 0)
-					s += "::" + it.id.engine;
+				const analyzer_id &id = interned_analyzer_id (it.id);
+				if (id.komi_set) {
+					s += ":" + std::to_string (id.komi);
+					if (id.engine.length () > 0)
+						s += ":" + id.engine;
+				} else if (id.engine.length () > 0)
+					s += "::" + id.engine;
 				s += "]";
 				linecount++;
 			}
@@ -25,13 +25,19 @@ FORMS	      = gui_dialog.ui \
                 nthmove_gui.ui
 
 HEADERS		      = analyzedlg.h \
+			analysisjob.h \
+			batchanalysis.h \
 		        autodiagsdlg.h \
                         config.h \
                         clickableviews.h \
                         clockview.h \
+                        dashboard.h \
                         dbdialog.h \
 			evalgraph.h \
+			evalcache.h \
+			markpainter.h \
                         figuredlg.h \
+                        gamearchive.h \
                         gamedialog.h \
 			gamestable.h \
 			gametree.h \
@@ -78,12 +84,18 @@ HEADERS		      = analyzedlg.h \
     archivehandlerfactory.h
 
 SOURCES		      = analyzedlg.cpp \
+			analysisjob.cpp \
+			batchanalysis.cpp \
 			autodiagsdlg.cpp \
 			clientwin.cpp \
                         clockview.cpp \
+                        dashboard.cpp \
                         dbdialog.cpp \
 			evalgraph.cpp \
+			evalcache.cpp \
+			markpainter.cpp \
 			figuredlg.cpp \
+			gamearchive.cpp \
 			gamedialog.cpp \
 			gamestable.cpp \
 			gametree.cpp \
@@ -16,7 +16,7 @@ void ClientWindow::prepare_tables(InfoType cmd)
 	{
 		case WHO: // delete player table
 		{
-			ListView_players->clear ();
+			ListView_players->clear_players ();
 
 			// set number of players to 0
 			myAccount->num_players = 0;
@@ -29,13 +29,7 @@ void ClientWindow::prepare_tables(InfoType cmd)
 
 		case GAMES: // delete games table
 		{
-			ListView_games->clear ();
-			QTreeWidgetItemIterator lv(ListView_games);
-			for (QTreeWidgetItem *lvi; (lvi = *lv);)
-			{
-				lv++;
-				delete lvi;
-			}
+			ListView_games->clear_games ();
 
 			// set number of games to 0
 			myAccount->num_games = 0;
@@ -65,35 +59,74 @@ void ClientWindow::prepare_tables(InfoType cmd)
 	}
 }
 
-// return the rank of a given name
-QString ClientWindow::getPlayerRk(QString player)
+// incremental mode: the tables are kept current from the server's notices and
+// only fetched again when they turn out to be out of date
+void ClientWindow::resync_tables(InfoType cmd)
 {
-	QTreeWidgetItemIterator lvp(ListView_players);
-	QTreeWidgetItem *lvpi;
+	if (!setting->readBoolEntry("INCREMENTAL_LISTS"))
+		return;
 
-	// look for players in playerlist
-	for (; (lvpi = *lvp); lvp++)
+	switch (cmd)
 	{
-		// check if names are identical
-		if (lvpi->text(1) == player)
-		{
-			return lvpi->text(2);
-		}
+		case WHO:
+			// a listing is already on its way
+			if (playerListEmpty)
+				return;
+			qDebug() << "player list out of date, fetching it again";
+			slot_refresh(10);
+			break;
+
+		case GAMES:
+			if (gamesResyncPending)
+				return;
+			gamesResyncPending = true;
+			qDebug() << "games list out of date, fetching it again";
+			slot_refresh(11);
+			break;
+
+		default:
+			break;
+	}
+}
+
+// a player entered or left the room
+void ClientWindow::slot_roomnotice(const QString &name)
+{
+	if (!setting->readBoolEntry("INCREMENTAL_LISTS"))
+	{
+		slot_refresh(10);
+		return;
 	}
 
+	// the connect and disconnect notices should have told us about the player,
+	// unless the listing left them out
+	if (!playerListFiltered && !ListView_players->contains(name))
+		resync_tables(WHO);
+}
+
+// moves were sent for a game
+void ClientWindow::slot_gameseen(const QString &nr)
+{
+	if (!ListView_games->contains(nr) && !playerListEmpty)
+		resync_tables(GAMES);
+}
+
+// return the rank of a given name
+QString ClientWindow::getPlayerRk(QString player)
+{
+	Player p;
+	if (ListView_players->find_player(player, p))
+		return p.rank;
+
 	return QString::null;
 }
 
 // check for exclude list entry of a given name
 QString ClientWindow::getPlayerExcludeListEntry(QString player)
 {
-	QTreeWidgetItemIterator lvp(ListView_players);
-	QTreeWidgetItem *lvpi;
-
-	// look for players in playerlist
-	for (; (lvpi = *lvp); lvp++)
-		if (lvpi->text(1) == player)
-			return lvpi->text(6);
+	Player p;
+	if (ListView_players->find_player(player, p))
+		return p.mark;
 
 	return QString::null;
 }
@@ -101,38 +134,19 @@ QString ClientWindow::getPlayerExcludeListEntry(QString player)
 // take a new game from parser
 void ClientWindow::slot_game(Game* g)
 {
-	// insert into ListView
-	QTreeWidgetItemIterator lv(ListView_games);
-
 	if (g->running)
 	{
-		bool found = false;
-		GamesTableItem *lvi_mem = nullptr;
-
 		// check if game already exists
-		if (!playerListEmpty)
-		{
-			QTreeWidgetItemIterator lvii = lv;
-			for (GamesTableItem *lvi; (lvi = static_cast<GamesTableItem*>(*lvii)) && !found;)
-			{
-				lvii++;
-				// compare game id
-				if (lvi->text(0) == g->nr)
-				{
-					found = true;
-					lvi_mem = lvi;
-				}
-			}
-		}
-		else if (g->H.isEmpty() && !myAccount->num_games)
+		Game old_game;
+		bool known = ListView_games->find_game(g->nr, old_game);
+		if (!known && playerListEmpty && g->H.isEmpty() && !myAccount->num_games)
 		{
 			// skip games until initial table has loaded
 			qDebug() << "game skipped because no init table";
 			return;
 		}
 
-		QString excludeMark = "";
-		QString myMark = "B";
+		bool own_game = false;
 
 		// check if exclude entry is done later
 		if (!g->H.isEmpty()) //g->status.length() > 1)
@@ -147,8 +161,7 @@ void ClientWindow::slot_game(Game* g)
 			// ensure that my game is listed first
 			if (emw == "M" || emb == "M")
 			{
-				myMark = "A";
-				excludeMark = "M";
+				own_game = true;
 
 				// I'm playing, thus I'm open, except teaching games
 				if (emw != "M" || emb != "M")
@@ -157,55 +170,29 @@ void ClientWindow::slot_game(Game* g)
 					slot_checkbox(0, true);
 				}
 			}
-			else if (emw == "W" || emb == "W")
-			{
-				excludeMark = "W";
-			}
 		}
 
 		// update player info if this is not a 'who'-result or if it's me
-		if (g->H.isEmpty() || myMark == "A") //g->status.length() < 2)
+		if (g->H.isEmpty() || own_game) //g->status.length() < 2)
 		{
-			QTreeWidgetItemIterator lvp(ListView_players);
-			PlayerTableItem *lvpi;
-			int pl_found = 0;
-
-			// look for players in playerlist
-			for (; (lvpi = static_cast<PlayerTableItem *>(*lvp)) && pl_found < 2;) {
-				// check if names are identical
-				if (lvpi->text(1) == g->wname || lvpi->text(1) == g->bname) {
-					pl_found++;
-					Player pl = lvpi->get_player ();
-					pl.play_str = g->nr;
-					lvpi->update_player (pl);
-
-					// check if players has a rank
-					if (g->wrank == "??" || g->brank == "??")
-					{
-						// no rank given in case of continued game -> set rank in games table
-						if (lvpi->text(1) == g->wname)
-							g->wrank = lvpi->text(2);
-
-						// no else case! bplayer could be identical to wplayer!
-						if (lvpi->text(1) == g->bname)
-							g->brank = lvpi->text(2);
-					}
-				}
+			ListView_players->set_game(g->wname, g->nr);
+			ListView_players->set_game(g->bname, g->nr);
 
-				lvp++;
+			// check if players has a rank
+			if (g->wrank == "??" || g->brank == "??")
+			{
+				// no rank given in case of continued game -> set rank in games table
+				Player pl;
+				if (g->wrank == "??" && ListView_players->find_player(g->wname, pl))
+					g->wrank = pl.rank;
+				if (g->brank == "??" && ListView_players->find_player(g->bname, pl))
+					g->brank = pl.rank;
 			}
-
-//			ListView_games->sortItems (3, Qt::AscendingOrder);
 		}
-		QString rkw = myMark + rkToKey(g->wrank) + g->wname.toLower() + ":" + excludeMark;
-		QString rkb = myMark + rkToKey(g->brank) + g->bname.toLower() + ":" + excludeMark;
-		g->sort_rk_w = rkw;
-		g->sort_rk_b = rkb;
-		if (found) {
-			lvi_mem->update_game (*g);
-		} else {
+		g->own_game = own_game;
+		if (ListView_games->set_game(*g))
+		{
 			// from GAMES command or game info{...}
-			new GamesTableItem(ListView_games, *g);
 
 			// increase number of games
 			myAccount->num_games++;
@@ -214,65 +201,33 @@ void ClientWindow::slot_game(Game* g)
 
 	} else {
 		// from game info {...}
-		bool found = false;
-		QString game_id;
+		Game old_game;
+		bool found;
 
-		if (g->nr != "@") {
-			for (QTreeWidgetItem *lvi; (lvi = *lv) && !found;)
-			{
-				lv++;
-				// compare game id
-				if (lvi->text(0) == g->nr)
-				{
-					lv++;
-					delete lvi;
-					found = true;
-				}
-			}
-
-			// used for player update below
-			game_id = g->nr;
-		} else {
-			for (QTreeWidgetItem *lvi; (lvi = *lv) && !found;) {
-				lv++;
-				// look for name
-				if (lvi->text(1) == myAccount->acc_name ||
-				    lvi->text(3) == myAccount->acc_name)
-				{
-					// used for player update below
-					game_id = lvi->text(0);
-
-					lv++;
-					delete lvi;
-					found = true;
-				}
-			}
-		}
+		if (g->nr != "@")
+			found = ListView_games->find_game(g->nr, old_game);
+		else
+			// look for my own game
+			found = ListView_games->find_own_game(myAccount->acc_name, old_game);
 
 		if (!found)
-			qWarning("game not found");
-		else
 		{
-			// decrease number of games
-			myAccount->num_games--;
-			statusGames->setText(" G: " + QString::number(myAccount->num_games) + " / " + QString::number(myAccount->num_observedgames) + " ");
+			qWarning("game not found");
+			resync_tables(GAMES);
+			return;
+		}
 
-			QTreeWidgetItemIterator lvp(ListView_players);
-			PlayerTableItem *lvpi;
-			int pl_found = 0;
-
-			// look for players in playerlist
-			for (; (lvpi = static_cast<PlayerTableItem *>(*lvp)) && pl_found < 2;) {
-				// check if numbers are identical
-				if (lvpi->text(3) == game_id) {
-					pl_found++;
-					Player pl = lvpi->get_player ();
-					pl.play_str = "-";
-					lvpi->update_player (pl);
-				}
+		ListView_games->remove_game(old_game.nr);
 
-				lvp++;
-			}
+		// decrease number of games
+		myAccount->num_games--;
+		statusGames->setText(" G: " + QString::number(myAccount->num_games) + " / " + QString::number(myAccount->num_observedgames) + " ");
+
+		for (const QString &name: { old_game.wname, old_game.bname }) {
+			Player pl;
+			// check if numbers are identical
+			if (ListView_players->find_player(name, pl) && pl.play_str == old_game.nr)
+				ListView_players->set_game(name, "-");
 		}
 	}
 }
@@ -282,66 +237,48 @@ void ClientWindow::slot_player(Player *p, bool cmdplayers)
 {
 	// insert into ListView
 
-  	QTreeWidgetItemIterator lv(ListView_players);
-#if 0
-	QPoint pp(0,0);
-	QTreeWidgetItem *topViewItem = ListView_players->itemAt(pp);
-  	bool deleted_topViewItem = false;
-#endif
 	if (p->online)
 	{
 		// check if it's an empty list, i.e. all items deleted before
 		if (cmdplayers && !playerListEmpty)
 		{
-			for (PlayerTableItem *lvi; (lvi = static_cast<PlayerTableItem*>(*lv));)
+			Player old_player;
+			if (ListView_players->find_player(p->name, old_player))
 			{
-				lv++;
-				// compare names
-				if (lvi->text(1) == p->name)
+				// check if new player info is less than old
+				if (p->info != "??")
 				{
-					// check if new player info is less than old
-					if (p->info != "??")
-					{
-						// new entry has more info
-						p->mark = lvi->text (6);
-						p->sort_rk = rkToKey(p->rank) + p->name.toLower();
-						lvi->update_player (*p);
-
-#if 0
-						lvi->set_nmatchSettings(p);
-						//lvi->nmatch = p->nmatch;
-
-						lvi->ownRepaint();
-#endif
-					}
-
-					if (p->name == myAccount->acc_name)
-					{
-						qDebug() << "updating my account info... (1)";
-						// checkbox open
-						bool b = (p->info.contains('X') == 0);
-						slot_checkbox(0, b);
-						// checkbox looking - don't set if closed
-						if (p->info.contains('!') != 0)
-							// "!" found
-							slot_checkbox(1, true);
-						else if (b)
-							// "!" not found && open
-							slot_checkbox(1, false);
-						// checkbox quiet
-						// NOT CORRECT REPORTED BY SERVER!
-						//b = (p->info.contains('Q') != 0);
-						//slot_checkbox(2, b);
-						// -> WORKAROUND
-						if (p->info.contains('Q') != 0)
-							slot_checkbox(2, true);
-
-						// get rank to calc handicap when matching
-						myAccount->set_rank(p->rank);
-					}
-
-					return;
+					// new entry has more info
+					p->mark = old_player.mark;
+					ListView_players->set_player(*p);
 				}
+
+				if (p->name == myAccount->acc_name)
+				{
+					qDebug() << "updating my account info... (1)";
+					// checkbox open
+					bool b = (p->info.contains('X') == 0);
+					slot_checkbox(0, b);
+					// checkbox looking - don't set if closed
+					if (p->info.contains('!') != 0)
+						// "!" found
+						slot_checkbox(1, true);
+					else if (b)
+						// "!" not found && open
+						slot_checkbox(1, false);
+					// checkbox quiet
+					// NOT CORRECT REPORTED BY SERVER!
+					//b = (p->info.contains('Q') != 0);
+					//slot_checkbox(2, b);
+					// -> WORKAROUND
+					if (p->info.contains('Q') != 0)
+						slot_checkbox(2, true);
+
+					// get rank to calc handicap when matching
+					myAccount->set_rank(p->rank);
+				}
+
+				return;
 			}
 		}
 		else if (!cmdplayers && !myAccount->num_players)
@@ -350,7 +287,13 @@ void ClientWindow::slot_player(Player *p, bool cmdplayers)
 			// skip players until initial table has loaded
 			return;
 		}
-
+		else if (!cmdplayers && ListView_players->contains(p->name))
+		{
+			// connected again without having disconnected
+			qWarning() << "connected player already known: " << p->name;
+			resync_tables(WHO);
+			return;
+		}
 
 		QString mark;
 
@@ -403,61 +346,40 @@ void ClientWindow::slot_player(Player *p, bool cmdplayers)
 			}
 		}
 		p->mark = mark;
-		p->sort_rk = rkToKey(p->rank) + p->name.toLower();
-		new PlayerTableItem(ListView_players, *p);
-#if 0
-		lv1->set_nmatchSettings(p);
-#endif
+		ListView_players->set_player(*p);
+
 		// increase number of players
 		myAccount->num_players++;
 		statusUsers->setText(" P: " + QString::number(myAccount->num_players) + " / " + QString::number(myAccount->num_watchedplayers) + " ");
-
-		//if (!cmdplayers)
-		//	ListView_players->sort() ;
-
 	}
 	else
 	{
 		// {... has disconnected}
-		bool found = false;
-		for (QTreeWidgetItem *lvi; (lvi = *lv) && !found;)
+		Player old_player;
+		if (!ListView_players->find_player(p->name, old_player))
 		{
-			lv++;
-			// compare names
-			if (lvi->text(1) == p->name)
+			// a filtered listing leaves out players who may well disconnect
+			if (!playerListFiltered)
 			{
-				// check if it was a watched player
-				if (lvi->text(6) == "W")
-				{
-					qgo->playLeaveSound();
-					myAccount->num_watchedplayers--;
-				}
-
-				lv++;
-#if 0
-				if (lvi == topViewItem)     // are we trying to delete the 'anchor' of the list viewport ?
-					deleted_topViewItem = true  ;
-#endif
-				delete lvi;
-				found = true;;
-
-				// decrease number of players
-				myAccount->num_players--;
-				statusUsers->setText(" P: " + QString::number(myAccount->num_players) + " / " + QString::number(myAccount->num_watchedplayers) + " ");
+				qWarning() << "disconnected player not found: " << p->name;
+				resync_tables(WHO);
 			}
+			return;
 		}
 
-		if (!found)
-			qWarning() << "disconnected player not found: " << p->name;
-	}
+		// check if it was a watched player
+		if (old_player.mark == "W")
+		{
+			qgo->playLeaveSound();
+			myAccount->num_watchedplayers--;
+		}
 
-#if 0
-	if (! deleted_topViewItem) //don't try to refer to a deleted element ...
-	{
-		int ip = topViewItem->itemPos();
-		ListView_players->setContentsPos(0,ip);
+		ListView_players->remove_player(p->name);
+
+		// decrease number of players
+		myAccount->num_players--;
+		statusUsers->setText(" P: " + QString::number(myAccount->num_players) + " / " + QString::number(myAccount->num_watchedplayers) + " ");
 	}
-#endif
 }
 
 
@@ -16,6 +16,7 @@ TelnetConnection::TelnetConnection(ClientWindow *parent, QWidget *lv_p, QWidget
 	// Create IGSConnection instance
 	igsInterface = new IGSConnection (lv_p, lv_g);
 	connect (igsInterface, &IGSConnection::signal_text_to_app, parent, &ClientWindow::sendTextToApp);
+	connect (igsInterface, &IGSConnection::signal_replay_done, parent, &ClientWindow::slot_replay_done);
 }
 
 TelnetConnection::~TelnetConnection ()
@@ -42,6 +43,21 @@ void TelnetConnection::connect_host (const Host &h)
 		qDebug("Connected");
 }
 
+// play back a recorded session instead of connecting to a server
+bool TelnetConnection::replay (const QString &path, int lines_per_second)
+{
+	if (igsInterface->isConnected ()) {
+		qDebug("Already connected!");
+		return false;
+	}
+	return igsInterface->openReplay (path, lines_per_second);
+}
+
+bool TelnetConnection::record (const QString &path)
+{
+	return igsInterface->recordSession (path);
+}
+
 void TelnetConnection::slotHostDisconnect()
 {
 	if (!igsInterface->closeConnection())
@@ -57,6 +73,6 @@ void TelnetConnection::sendTextFromApp(const QString &txt)
 void TelnetConnection::slotHostQuit()
 {
 	// TODO: Timeout for connection termination, if still data has to be written
-	if (igsInterface->isConnected())
+	if (igsInterface->isConnected() || igsInterface->isReplaying ())
 		slotHostDisconnect();
 }
@@ -25,6 +25,8 @@ public:
 
 	void sendTextFromApp (const QString&);
 	void connect_host (const Host &);
+	bool replay (const QString &path, int lines_per_second);
+	bool record (const QString &path);
 
 public slots:
 	void slotHostDisconnect();